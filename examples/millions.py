@@ -85,6 +85,17 @@ class big_view:
       self.calc_recnos()
     return self.recnos[-1] + v[-1].data.append(record)
     
+  def extend(self, records):
+    v = self.view
+    records = list(records)
+    while records:
+      if not self.recnos or len(v[-1].data) >= self.blocksize:
+        v.append()
+        self.calc_recnos()
+      room = self.blocksize - len(v[-1].data)
+      v[-1].data.extend(records[:room])
+      del records[:room]
+
   def insert(self, idx, rec=None):
     main, sub = self._seek(idx)
     view = self.view[main].data
@@ -191,9 +202,8 @@ def make_rec(idx):
   return random_ints[idx:idx+n_fields]
   
 def add_recs(n=1000):
-  for i in range(n):
-    idx = len(ds) % rand_len
-    ds.append(make_rec(idx))
+  base = len(ds)
+  ds.extend([make_rec((base + i) % rand_len) for i in range(n)])
 
 if __name__ == '__main__':
     # expect this to take hours (1000..2000 recs/sec on modern PII)
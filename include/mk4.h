@@ -55,6 +55,7 @@ class c4_View; // a view on underlying data
 class c4_Cursor; // an index into a view
 class c4_RowRef; // a reference to a row
 class c4_Row; // one row in a view
+class c4_Expr; // a predicate on the rows of a view
 class c4_Bytes; // used to pass around generic data
 class c4_Storage; // manages view persistence
 class c4_CustomViewer; // used for customizable views
@@ -84,6 +85,7 @@ class c4_StringRef;
 class c4_ViewRef;
 
 class c4_Dependencies; // not defined here
+class c4_ExprNode; // not defined here
 class c4_Handler; // not defined here
 class c4_Notifier; // not defined here
 class c4_Persist; // not defined here
@@ -249,31 +251,44 @@ class c4_View {
     bool IsCompatibleWith(const c4_View &)const;
     void RelocateRows(int, int, c4_View &, int);
 
+    /* Batching change notifications */
+    void BeginBulk();
+    void EndBulk();
+
     /* Dealing with the properties of this view */
     int NumProperties()const;
     const c4_Property &NthProperty(int)const;
     int FindProperty(int);
     int FindPropIndexByName(const char*)const;
     c4_View Duplicate()const;
+    c4_View Materialize()const;
+    bool GetColumn(const c4_Property &, c4_Bytes &)const;
     c4_View Clone()const;
     int AddProperty(const c4_Property &);
     c4_View operator, (const c4_Property &)const;
 
     const char *Description()const;
+    const char *Describe()const;
 
     /* Derived views */
     c4_View Sort()const;
     c4_View SortOn(const c4_View &)const;
     c4_View SortOnReverse(const c4_View &, const c4_View &)const;
+    c4_View SortTop(const c4_View &, int, int = 0)const;
+    c4_View SortTopReverse(const c4_View &, const c4_View &, int, int = 0)const;
+    c4_View SortOnExternal(const c4_View &, t4_i32)const;
 
     c4_View Select(const c4_RowRef &)const;
     c4_View SelectRange(const c4_RowRef &, const c4_RowRef &)const;
+    c4_View Select(const c4_Expr &)const;
+    c4_View Fuse()const;
 
     c4_View Project(const c4_View &)const;
     c4_View ProjectWithout(const c4_View &)const;
 
     int GetIndexOf(const c4_RowRef &)const;
     int RestrictSearch(const c4_RowRef &, int &, int &);
+    int RestrictSelect(const c4_RowRef &, const c4_RowRef &, c4_Bytes &);
 
     /* Custom views */
     c4_View Slice(int, int =  - 1, int = 1)const;
@@ -283,8 +298,8 @@ class c4_View {
     c4_View Concat(const c4_View &)const;
     c4_View Rename(const c4_Property &, const c4_Property &)const;
 
-    c4_View GroupBy(const c4_View &, const c4_ViewProp &)const;
-    c4_View Counts(const c4_View &, const c4_IntProp &)const;
+    c4_View GroupBy(const c4_View &, const c4_ViewProp &, t4_i32 = 0)const;
+    c4_View Counts(const c4_View &, const c4_IntProp &, t4_i32 = 0)const;
     c4_View Unique()const;
 
     c4_View Union(const c4_View &)const;
@@ -300,11 +315,13 @@ class c4_View {
     c4_View Blocked()const;
     c4_View Ordered(int = 1)const;
     c4_View Indexed(const c4_View &, const c4_View &, bool = false)const;
+    c4_View Bitmap(const c4_View &)const;
 
     /* Searching */
     int Find(const c4_RowRef &, int = 0)const;
     int Search(const c4_RowRef &)const;
     int Locate(const c4_RowRef &, int * = 0)const;
+    void Prefetch(const c4_View & = c4_View())const;
 
     /* Comparing view contents */
     int Compare(const c4_View &)const;
@@ -466,6 +483,51 @@ class c4_Row: public c4_RowRef {
     static void Release(c4_Cursor);
 };
 
+//---------------------------------------------------------------------------
+/// A predicate on rows, built from comparisons and logical operators.
+//
+//  Expressions are cheap to copy, the tree is shared and never modified.
+//  Pass them to c4_View::Select to get a derived view with matching rows.
+
+class c4_Expr {
+    c4_ExprNode *_node;
+
+  public:
+    /// The comparisons which can be used in an expression (case-insensitive
+    /// on strings, including the text matches kPrefix, kContains and kGlob)
+    enum {
+        kEQ, kNE, kLT, kLE, kGT, kGE, kPrefix, kContains, kGlob
+    };
+
+    /// Construct an expression which matches every row
+    c4_Expr();
+    /// Compare each property of a row with its value, all must match
+    explicit c4_Expr(const c4_RowRef &, int = kEQ);
+    /// Compare two properties of the same type in each row
+    c4_Expr(const c4_Property &, int, const c4_Property &);
+    /// Match if the first property is equal to one of the values in a view
+    explicit c4_Expr(const c4_View &);
+    /// Construct an expression from another one
+    c4_Expr(const c4_Expr &);
+    /// Destructor
+    ~c4_Expr();
+
+    /// Assign another expression to this one
+    c4_Expr &operator = (const c4_Expr &);
+
+    /// Return an expression which matches if both expressions match
+    friend c4_Expr operator && (const c4_Expr &, const c4_Expr &);
+    /// Return an expression which matches if either expression matches
+    friend c4_Expr operator || (const c4_Expr &, const c4_Expr &);
+    /// Return an expression which matches if this one does not
+    friend c4_Expr operator !(const c4_Expr &);
+
+  private:
+    c4_Expr(c4_ExprNode*);
+
+    friend class c4_ExprSeq;
+};
+
 //---------------------------------------------------------------------------
 
 class c4_Bytes {
@@ -519,6 +581,7 @@ class c4_Storage: public c4_View {
 
     void SetStructure(const char*);
     bool AutoCommit(bool = true);
+    bool SaveZoneMaps(bool = true);
     c4_Strategy &Strategy()const;
     const char *Description(const char * = 0);
 
@@ -536,6 +599,9 @@ class c4_Storage: public c4_View {
 
     t4_i32 FreeSpace(t4_i32 *bytes_ = 0);
 
+    static void SetSegmentCache(t4_i32);
+    static t4_i32 SegmentCacheStats(t4_i64 * = 0, t4_i64 * = 0, t4_i64 * = 0);
+
     //DROPPED: c4_Storage (const char* filename_, const char* description_);
     //DROPPED: c4_View Store(const char* name_, const c4_View& view_);
     //DROPPED: c4_HandlerSeq& RootTable() const;
@@ -747,6 +813,8 @@ class c4_CustomViewer {
     bool InsertRows(int, const c4_RowRef &, int = 1);
     virtual bool InsertRows(int, c4_Cursor, int = 1);
     virtual bool RemoveRows(int, int = 1);
+    virtual int SelectRows(c4_Cursor, c4_Cursor, c4_Bytes &);
+    virtual bool PickRows(c4_View &, c4_Bytes &);
 };
 
 //---------------------------------------------------------------------------
@@ -777,6 +845,14 @@ class c4_Strategy {
     virtual void ResetFileMapping();
     virtual t4_i32 FileSize();
     virtual t4_i32 FreshGeneration();
+    virtual void DataAdvise(t4_i32, t4_i32, int);
+    virtual int DataReadv(t4_i32, void *const *, const t4_i32 *, int);
+    virtual void DataWritev(t4_i32, const void *const *, const t4_i32 *, int);
+
+    /// Access patterns which can be passed to DataAdvise
+    enum {
+        kAdviseNormal, kAdviseWillNeed, kAdviseRandom
+    };
 
     void SetBase(t4_i32);
     t4_i32 EndOfData(t4_i32 =  - 1);
@@ -809,6 +885,10 @@ class c4_Sequence {
     int _refCount;
     /// Pointer to dependency list, or null if nothing depends on this
     c4_Dependencies *_dependencies;
+    /// Nesting level of BeginBulk calls, changes are deferred while > 0
+    int _bulkLevel;
+    /// First row changed while deferring notifications, or -1
+    int _bulkFirst;
 
   protected:
     /// Optimization: cached property index
@@ -825,6 +905,8 @@ class c4_Sequence {
 
     virtual int Compare(int, c4_Cursor)const;
     virtual bool RestrictSearch(c4_Cursor, int &, int &);
+    virtual int RestrictSelect(c4_Cursor, c4_Cursor, c4_Bytes &);
+    virtual bool PickRows(c4_View &, c4_Bytes &);
     void SetAt(int, c4_Cursor);
     virtual int RemapIndex(int, const c4_Sequence*)const;
 
@@ -839,6 +921,7 @@ class c4_Sequence {
     void Resize(int, int =  - 1);
 
     virtual void InsertAt(int, c4_Cursor, int = 1);
+    virtual void InsertFrom(int, c4_Sequence &);
     virtual void RemoveAt(int, int = 1);
     virtual void Move(int, int);
 
@@ -859,6 +942,7 @@ class c4_Sequence {
     virtual c4_Handler *CreateHandler(const c4_Property &) = 0;
 
     virtual const char *Description();
+    virtual const char *Describe();
 
     /* Element access */
     /// Return width of specified data item
@@ -877,12 +961,16 @@ class c4_Sequence {
     virtual c4_Notifier *PreChange(c4_Notifier &);
     virtual void PostChange(c4_Notifier &);
 
+    void BeginBulk();
+    void EndBulk();
+
     const char *UseTempBuffer(const char*);
 
   protected:
     virtual ~c4_Sequence();
 
     void ClearCache();
+    bool DeferChange(int);
 
   public:
     //! for c4_Table::Sequence setup
@@ -51,12 +51,26 @@ class c4_FileStrategy: public c4_Strategy {
     virtual t4_i32 FileSize();
     /// Return a good value to use as fresh generation counter
     virtual t4_i32 FreshGeneration();
+    /// Pass on a hint about how a range of the file will be accessed
+    virtual void DataAdvise(t4_i32 pos_, t4_i32 length_, int how_);
+    /// Read consecutive bytes into several buffers
+    virtual int DataReadv(t4_i32 pos_, void *const *buffers_, const t4_i32
+      *lengths_, int count_);
+    /// Write several buffers as consecutive bytes
+    virtual void DataWritev(t4_i32 pos_, const void *const *buffers_, const
+      t4_i32 *lengths_, int count_);
 
   protected:
     /// Pointer to file object
     FILE *_file;
     /// Pointer to same file object, if it must be deleted at end
     FILE *_cleanup;
+    /// Start of the address range reserved for the map, zero if none
+    t4_byte *_mapBase;
+    /// Size of that reserved address range
+    t4_i32 _mapReserve;
+    /// Number of bytes of the file currently mapped into that range
+    t4_i32 _mapLength;
 };
 
 /////////////////////////////////////////////////////////////////////////////
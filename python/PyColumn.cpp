@@ -0,0 +1,135 @@
+// PyColumn.cpp --
+// $Id$
+// This is part of MetaKit, the homepage is http://www.equi4.com/metakit.html
+// Copyright (C) 1999-2004 Gordon McMillan and Jean-Claude Wippler.
+//
+//  Column class implementation, whole columns through the buffer protocol
+
+#include "PyColumn.h"
+#include <PWONumber.h>
+#include <PWOSequence.h>
+
+#if PY_VERSION_HEX < 0x02050000
+#define readbufferproc getreadbufferproc
+#define segcountproc getsegcountproc
+#endif 
+
+static PyMethodDef ColumnMethods[] =  {
+   {
+    0, 0, 0, 0
+  }
+};
+
+static void PyColumn_dealloc(PyColumn *o) {
+  PyMkLock lock;
+  delete o;
+}
+
+static PyObject *PyColumn_getattr(PyColumn *o, char *nm) {
+  try {
+    if (nm[0] == 'f' && strcmp(nm, "format") == 0) {
+      PWOString rslt(o->_format);
+      return rslt.disOwn();
+    }
+    if (nm[0] == 'i' && strcmp(nm, "itemsize") == 0) {
+      PWONumber rslt(o->_itemsize);
+      return rslt.disOwn();
+    }
+    return Py_FindMethod(ColumnMethods, o, nm);
+  } catch (...) {
+    return 0;
+  }
+}
+
+static Py_ssize_t PyColumn_length(PyObject *_o) {
+  return ((PyColumn*)_o)->_count;
+}
+
+static PySequenceMethods ColumnAsSeq =  {
+  PyColumn_length,  //sq_length
+  0,  //sq_concat
+  0,  //sq_repeat
+  0,  //sq_item
+  0,  //sq_slice
+  0,  //sq_ass_item
+  0,  //sq_ass_slice
+};
+
+// the old protocol, one read-only segment
+
+static Py_ssize_t PyColumn_getreadbuf(PyColumn *o, Py_ssize_t seg, void **ptr)
+  {
+  if (seg != 0) {
+    PyErr_SetString(PyExc_SystemError, "accessing non-existent segment");
+    return  - 1;
+  }
+  *ptr = (void*)o->_data.Contents();
+  return o->_data.Size();
+}
+
+static Py_ssize_t PyColumn_getsegcount(PyColumn *o, Py_ssize_t *lenp) {
+  if (lenp != 0)
+    *lenp = o->_data.Size();
+  return 1;
+}
+
+#if PY_VERSION_HEX >= 0x02060000
+
+// the new protocol also describes the items, as used by memoryview
+
+static int PyColumn_getbuffer(PyColumn *o, Py_buffer *view, int flags) {
+  if (flags &PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "column data is read-only");
+    return  - 1;
+  }
+
+  Py_INCREF(o);
+  view->obj = o;
+  view->buf = (void*)o->_data.Contents();
+  view->len = o->_data.Size();
+  view->readonly = 1;
+  view->itemsize = o->_itemsize;
+  view->format = flags &PyBUF_FORMAT ? o->_format : 0;
+  view->ndim = 1;
+  view->shape = flags &PyBUF_ND ? &o->_count : 0;
+  view->strides = flags &PyBUF_STRIDES ? &view->itemsize : 0;
+  view->suboffsets = 0;
+  view->internal = 0;
+  return 0;
+}
+
+#define PyColumn_BufferFlags Py_TPFLAGS_HAVE_NEWBUFFER
+#else 
+#define PyColumn_BufferFlags 0
+#endif 
+
+static PyBufferProcs ColumnAsBuffer =  {
+  (readbufferproc)PyColumn_getreadbuf,  //bf_getreadbuffer
+  0,  //bf_getwritebuffer
+  (segcountproc)PyColumn_getsegcount,  //bf_getsegcount
+  0,  //bf_getcharbuffer
+#if PY_VERSION_HEX >= 0x02060000
+  (getbufferproc)PyColumn_getbuffer,  //bf_getbuffer
+  0,  //bf_releasebuffer
+#endif 
+};
+
+PyTypeObject PyColumntype =  {
+  PyObject_HEAD_INIT(&PyType_Type)0, "PyColumn", sizeof(PyColumn), 0, 
+    (destructor)PyColumn_dealloc,  /*tp_dealloc*/
+  0,  /*tp_print*/
+  (getattrfunc)PyColumn_getattr,  /*tp_getattr*/
+  0,  /*tp_setattr*/
+  (cmpfunc)0,  /*tp_compare*/
+  (reprfunc)0,  /*tp_repr*/
+  0,  /*tp_as_number*/
+  &ColumnAsSeq,  /*tp_as_sequence*/
+  0,  /*tp_as_mapping*/
+  0,  /*tp_hash*/
+  0,  /*tp_call*/
+  0,  /*tp_str*/
+  0,  /*tp_getattro*/
+  0,  /*tp_setattro*/
+  &ColumnAsBuffer,  /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT | PyColumn_BufferFlags,  /*tp_flags*/
+};
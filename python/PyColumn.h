@@ -0,0 +1,43 @@
+// PyColumn.h --
+// $Id$
+// This is part of MetaKit, see http://www.equi4.com/metakit.html
+// Copyright (C) 1999-2004 Gordon McMillan and Jean-Claude Wippler.
+//
+//  Column class header
+
+#if !defined INCLUDE_PYCOLUMN_H
+#define INCLUDE_PYCOLUMN_H
+
+#include <mk4.h>
+#include "PyHead.h"
+
+// see pep 353 at http://www.python.org/dev/peps/pep-0353/
+#if PY_VERSION_HEX < 0x02050000
+typedef int Py_ssize_t;
+#endif 
+
+#define PyColumn_Check(ob) ((ob)->ob_type == &PyColumntype)
+
+extern PyTypeObject PyColumntype;
+
+class PyColumn: public PyHead {
+  public:
+    c4_View _view; // keeps the storage and its file mapping alive
+    c4_Bytes _data; // refers to the file mapping, or holds a copy
+    char _format[2]; // struct module code of one item
+    int _itemsize;
+    Py_ssize_t _count;
+
+    PyColumn(const c4_View &view, char format, int itemsize): PyHead
+      (PyColumntype), _view(view), _itemsize(itemsize), _count(0) {
+        _format[0] = format;
+        _format[1] = 0;
+    }
+    ~PyColumn(){}
+
+    void setCount() {
+        _count = _data.Size() / _itemsize;
+    }
+};
+
+#endif
@@ -0,0 +1,92 @@
+// PyExpr.cpp --
+// $Id$
+// This is part of MetaKit, the homepage is http://www.equi4.com/metakit.html
+// Copyright (C) 1999-2004 Gordon McMillan and Jean-Claude Wippler.
+//
+//  Expression class implementation, predicates built from properties
+
+#include "PyExpr.h"
+
+static void PyExpr_dealloc(PyExpr *o) {
+  PyMkLock lock;
+  delete o;
+}
+
+static PyObject *PyExpr_and(PyObject *a, PyObject *b) {
+  if (!PyExpr_Check(a) || !PyExpr_Check(b)) {
+    Py_INCREF(Py_NotImplemented);
+    return Py_NotImplemented;
+  }
+  PyMkLock lock;
+  return new PyExpr(((PyExpr*)a)->_expr && ((PyExpr*)b)->_expr);
+}
+
+static PyObject *PyExpr_or(PyObject *a, PyObject *b) {
+  if (!PyExpr_Check(a) || !PyExpr_Check(b)) {
+    Py_INCREF(Py_NotImplemented);
+    return Py_NotImplemented;
+  }
+  PyMkLock lock;
+  return new PyExpr(((PyExpr*)a)->_expr || ((PyExpr*)b)->_expr);
+}
+
+static PyObject *PyExpr_invert(PyExpr *o) {
+  PyMkLock lock;
+  return new PyExpr(!o->_expr);
+}
+
+/*
+ *  Comparing a property with anything but a property used to be false, and
+ *  still is for == and != in a boolean context, so that "prop in list" and
+ *  the like keep working.  Other expressions only make sense in where(),
+ *  and Python's "and" and "or" can't be used to combine them.
+ */
+
+static int PyExpr_nonzero(PyExpr *o) {
+  if (o->_truth < 0) {
+    PyErr_SetString(PyExc_TypeError, 
+      "expression has no truth value, combine with &, | and ~");
+    return  - 1;
+  }
+  return o->_truth;
+}
+
+static PyNumberMethods ExprAsNum =  {
+  0,  //nb_add
+  0,  //nb_subtract
+  0,  //nb_multiply
+  0,  //nb_divide
+  0,  //nb_remainder
+  0,  //nb_divmod
+  0,  //nb_power
+  0,  //nb_negative
+  0,  //nb_positive
+  0,  //nb_absolute
+  (inquiry)PyExpr_nonzero,  //nb_nonzero
+  (unaryfunc)PyExpr_invert,  //nb_invert
+  0,  //nb_lshift
+  0,  //nb_rshift
+  (binaryfunc)PyExpr_and,  //nb_and
+  0,  //nb_xor
+  (binaryfunc)PyExpr_or,  //nb_or
+};
+
+PyTypeObject PyExprtype =  {
+  PyObject_HEAD_INIT(&PyType_Type)0, "PyExpr", sizeof(PyExpr), 0, 
+    (destructor)PyExpr_dealloc,  /*tp_dealloc*/
+  0,  /*tp_print*/
+  0,  /*tp_getattr*/
+  0,  /*tp_setattr*/
+  (cmpfunc)0,  /*tp_compare*/
+  (reprfunc)0,  /*tp_repr*/
+  &ExprAsNum,  /*tp_as_number*/
+  0,  /*tp_as_sequence*/
+  0,  /*tp_as_mapping*/
+  0,  /*tp_hash*/
+  0,  /*tp_call*/
+  0,  /*tp_str*/
+  0,  /*tp_getattro*/
+  0,  /*tp_setattro*/
+  0,  /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_CHECKTYPES,  /*tp_flags*/
+};
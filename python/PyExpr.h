@@ -0,0 +1,28 @@
+// PyExpr.h --
+// $Id$
+// This is part of MetaKit, see http://www.equi4.com/metakit.html
+// Copyright (C) 1999-2004 Gordon McMillan and Jean-Claude Wippler.
+//
+//  Expression class header
+
+#if !defined INCLUDE_PYEXPR_H
+#define INCLUDE_PYEXPR_H
+
+#include <mk4.h>
+#include "PyHead.h"
+
+#define PyExpr_Check(ob) ((ob)->ob_type == &PyExprtype)
+
+extern PyTypeObject PyExprtype;
+
+class PyExpr: public PyHead {
+  public:
+    c4_Expr _expr;
+    int _truth; // value in a boolean context, or -1 if there is none
+
+    PyExpr(const c4_Expr &expr, int truth =  - 1): PyHead(PyExprtype), _expr
+      (expr), _truth(truth){}
+    ~PyExpr(){}
+};
+
+#endif
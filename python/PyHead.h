@@ -23,4 +23,59 @@ class PyHead: public PyObject {
     }
 };
 
+//  Long-running Metakit calls release the GIL, so Metakit objects need a
+//  lock of their own.  Every call which touches them holds PyMkLock, which
+//  the holding thread may take again.  While it is held, PyAllowThreads
+//  lets other threads run Python code, and Metakit callbacks into Python
+//  (such as wrapped sequences) must use PyEnsureGIL.  This needs a core
+//  built with q4_MULTI, otherwise these do nothing and the GIL is kept.
+
+#if q4_MULTI && defined(WITH_THREAD)
+
+class PyMkLock {
+  public:
+    PyMkLock();
+    ~PyMkLock();
+
+    static void init();
+};
+
+class PyAllowThreads {
+    PyThreadState *_save;
+  public:
+    PyAllowThreads(): _save(PyEval_SaveThread()){}
+    ~PyAllowThreads() {
+        PyEval_RestoreThread(_save);
+    }
+};
+
+class PyEnsureGIL {
+    PyGILState_STATE _state;
+  public:
+    PyEnsureGIL(): _state(PyGILState_Ensure()){}
+    ~PyEnsureGIL() {
+        PyGILState_Release(_state);
+    }
+};
+
+#else 
+
+class PyMkLock {
+  public:
+    PyMkLock(){}
+    static void init(){}
+};
+
+class PyAllowThreads {
+  public:
+    PyAllowThreads(){}
+};
+
+class PyEnsureGIL {
+  public:
+    PyEnsureGIL(){}
+};
+
+#endif 
+
 #endif
@@ -6,26 +6,138 @@
 //  Property class implementation
 
 #include "PyProperty.h"
+#include "PyExpr.h"
+#include "PyRowRef.h"
 #include <PWONumber.h>
 #include <PWOSequence.h>
 
+static PyObject *MakeExpr(PyProperty *o, PyObject *value, int op) {
+  c4_Row row;
+  PyRowRef::setFromPython(row,  *o, value);
+  return new PyExpr(c4_Expr(row, op));
+}
+
+static char *startswith__doc = 
+  "startswith(prefix) -- expression for where(), true if the value starts with prefix";
+
+static PyObject *PyProperty_startswith(PyProperty *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() != 1)
+      Fail(PyExc_TypeError, "startswith() takes exactly one argument");
+    return MakeExpr(o, args[0], c4_Expr::kPrefix);
+  } catch (...) {
+    return 0;
+  }
+}
+
+static char *contains__doc = 
+  "contains(text) -- expression for where(), true if the value contains text";
+
+static PyObject *PyProperty_contains(PyProperty *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() != 1)
+      Fail(PyExc_TypeError, "contains() takes exactly one argument");
+    return MakeExpr(o, args[0], c4_Expr::kContains);
+  } catch (...) {
+    return 0;
+  }
+}
+
+static char *glob__doc = 
+  "glob(pattern) -- expression for where(), true if the value matches pattern";
+
+static PyObject *PyProperty_glob(PyProperty *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() != 1)
+      Fail(PyExc_TypeError, "glob() takes exactly one argument");
+    return MakeExpr(o, args[0], c4_Expr::kGlob);
+  } catch (...) {
+    return 0;
+  }
+}
+
+static char *between__doc = 
+  "between(low, high) -- expression for where(), true if low <= value <= high";
+
+static PyObject *PyProperty_between(PyProperty *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() != 2)
+      Fail(PyExc_TypeError, "between() takes exactly two arguments");
+    c4_Row low, high;
+    PyRowRef::setFromPython(low,  *o, args[0]);
+    PyRowRef::setFromPython(high,  *o, args[1]);
+    return new PyExpr(c4_Expr(low, c4_Expr::kGE) && c4_Expr(high, c4_Expr::kLE));
+  } catch (...) {
+    return 0;
+  }
+}
+
+static char *isin__doc = 
+  "isin(values) -- expression for where(), true if the value is one of values";
+
+static PyObject *PyProperty_isin(PyProperty *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() != 1)
+      Fail(PyExc_TypeError, "isin() takes exactly one argument");
+    PWOSequence values(args[0]);
+    c4_View list =  *o;
+    c4_Row row;
+    for (int i = 0; i < values.len(); ++i) {
+      PyRowRef::setFromPython(row,  *o, values[i]);
+      list.Add(row);
+    }
+    return new PyExpr(c4_Expr(list));
+  } catch (...) {
+    return 0;
+  }
+}
+
 static PyMethodDef PropertyMethods[] =  {
    {
+    "startswith", (PyCFunction)PyProperty_startswith, METH_VARARGS,
+      startswith__doc
+  }
+  ,  {
+    "contains", (PyCFunction)PyProperty_contains, METH_VARARGS, contains__doc
+  }
+  ,  {
+    "glob", (PyCFunction)PyProperty_glob, METH_VARARGS, glob__doc
+  }
+  ,  {
+    "between", (PyCFunction)PyProperty_between, METH_VARARGS, between__doc
+  }
+  ,  {
+    "isin", (PyCFunction)PyProperty_isin, METH_VARARGS, isin__doc
+  }
+  ,  {
     0, 0, 0, 0
   }
 };
 
 static void PyProperty_dealloc(PyProperty *o) {
+  PyMkLock lock;
   delete o;
 }
 
 static int PyProperty_print(PyProperty *o, FILE *f, int) {
+  PyMkLock lock;
   fprintf(f, "Property('%c', '%s')", o->Type(), o->Name());
   return 0;
 }
 
 static PyObject *PyProperty_getattr(PyProperty *o, char *nm) {
   try {
+    PyMkLock lock;
     if (nm[0] == 'n' && strcmp(nm, "name") == 0) {
       PWOString rslt(o->Name());
       return rslt.disOwn();
@@ -49,6 +161,7 @@ static int PyProperty_compare(PyProperty *o, PyObject *ob) {
   PyProperty *other;
   int myid, hisid;
   try {
+    PyMkLock lock;
     if (!PyProperty_Check(ob))
       return  - 1;
     other = (PyProperty*)ob;
@@ -64,6 +177,34 @@ static int PyProperty_compare(PyProperty *o, PyObject *ob) {
   }
 }
 
+/*
+ *  Comparing a property with a value returns an expression for where(),
+ *  with the truth value of the old comparison for == and !=.  Properties
+ *  themselves, None, and values which don't fit the property fall back to
+ *  PyProperty_compare, as before.
+ */
+
+static PyObject *PyProperty_richcompare(PyProperty *o, PyObject *ob, int op) {
+  static int ops[] =  {
+    c4_Expr::kLT, c4_Expr::kLE, c4_Expr::kEQ, c4_Expr::kNE, c4_Expr::kGT,
+      c4_Expr::kGE
+  }; // same order as Py_LT .. Py_GE
+
+  if (!PyProperty_Check(ob) && ob != Py_None)
+  try {
+    PyMkLock lock;
+    c4_Row row;
+    PyRowRef::setFromPython(row,  *o, ob);
+    return new PyExpr(c4_Expr(row, ops[op]), op == Py_EQ ? 0 : op == Py_NE ?
+      1 :  - 1);
+  } catch (...) {
+    PyErr_Clear();
+  }
+
+  Py_INCREF(Py_NotImplemented);
+  return Py_NotImplemented;
+}
+
 PyTypeObject PyPropertytype =  {
   PyObject_HEAD_INIT(&PyType_Type)0, "PyProperty", sizeof(PyProperty), 0, 
     (destructor)PyProperty_dealloc,  /*tp_dealloc*/
@@ -75,10 +216,22 @@ PyTypeObject PyPropertytype =  {
   0,  /*tp_as_number*/
   0,  /*tp_as_sequence*/
   0,  /*tp_as_mapping*/
+  0,  /*tp_hash*/
+  0,  /*tp_call*/
+  0,  /*tp_str*/
+  0,  /*tp_getattro*/
+  0,  /*tp_setattro*/
+  0,  /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT,  /*tp_flags*/
+  0,  /*tp_doc*/
+  0,  /*tp_traverse*/
+  0,  /*tp_clear*/
+  (richcmpfunc)PyProperty_richcompare,  /*tp_richcompare*/
 };
 
 PyObject *PyProperty_new(PyObject *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOString typ(args[0]);
     PWOString nam(args[1]);
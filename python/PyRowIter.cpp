@@ -0,0 +1,138 @@
+// PyRowIter.cpp --
+// $Id$
+// This is part of MetaKit, the homepage is http://www.equi4.com/metakit.html
+// Copyright (C) 1999-2004 Gordon McMillan and Jean-Claude Wippler.
+//
+//  Row iterator class implementation, plain tuples without row objects
+
+#include "PyRowIter.h"
+#include "PyView.h"
+
+PyRowIter::PyRowIter(PyView *view, const c4_View &props, int batch): PyHead
+  (PyRowItertype), _view(view), _props(props), _pos(0), _batch(batch) {
+  Py_INCREF(_view);
+}
+
+PyRowIter::~PyRowIter() {
+  Py_DECREF(_view);
+}
+
+PyObject *PyRowIter::makeTuple(int row) {
+  int n = _props.NumProperties();
+  PyObject *tuple = PyTuple_New(n);
+  if (tuple == 0)
+    return 0;
+
+  c4_RowRef r = (*_view)[row];
+  c4_Bytes buf;
+
+  for (int k = 0; k < n; ++k) {
+    const c4_Property &prop = _props.NthProperty(k);
+    PyObject *item;
+    switch (prop.Type()) {
+      case 'I':
+        item = PyInt_FromLong(((const c4_IntProp &)prop)(r));
+        break;
+#ifdef HAVE_LONG_LONG
+      case 'L':
+        item = PyLong_FromLongLong((LONG_LONG)((const c4_LongProp &)prop)(r));
+        break;
+#endif 
+      case 'F':
+        item = PyFloat_FromDouble(((const c4_FloatProp &)prop)(r));
+        break;
+      case 'D':
+        item = PyFloat_FromDouble(((const c4_DoubleProp &)prop)(r));
+        break;
+      case 'S':
+      case 'B':
+      case 'M':
+         {
+          prop(r).GetData(buf);
+          int size = buf.Size();
+          // strings usually carry a trailing null byte, which is left out
+          if (prop.Type() == 'S' && size > 0 && buf.Contents()[size - 1] == 0)
+            --size;
+          item = PyString_FromStringAndSize((const char*)buf.Contents(), size);
+        }
+        break;
+      case 'V':
+        item = new PyView(((const c4_ViewProp &)prop)(r), _view);
+        break;
+      default:
+        item = PyErr_Format(PyExc_TypeError, "unknown property type '%c'",
+          prop.Type());
+    }
+
+    if (item == 0) {
+      Py_DECREF(tuple);
+      return 0;
+    }
+    PyTuple_SET_ITEM(tuple, k, item);
+  }
+
+  return tuple;
+}
+
+PyObject *PyRowIter::next() {
+  // rows may have been added or removed since the last call
+  int n = _view->GetSize();
+  if (_pos >= n)
+    return 0;
+
+  if (_batch <= 0)
+    return makeTuple(_pos++);
+
+  int count = n - _pos < _batch ? n - _pos : _batch;
+  PyObject *list = PyList_New(count);
+  if (list == 0)
+    return 0;
+
+  for (int i = 0; i < count; ++i) {
+    PyObject *tuple = makeTuple(_pos++);
+    if (tuple == 0) {
+      Py_DECREF(list);
+      return 0;
+    }
+    PyList_SET_ITEM(list, i, tuple);
+  }
+
+  return list;
+}
+
+static void PyRowIter_dealloc(PyRowIter *o) {
+  PyMkLock lock;
+  delete o;
+}
+
+static PyObject *PyRowIter_iternext(PyRowIter *o) {
+  PyMkLock lock;
+  return o->next();
+}
+
+PyTypeObject PyRowItertype =  {
+  PyObject_HEAD_INIT(&PyType_Type)0, "PyRowIter", sizeof(PyRowIter), 0,
+    (destructor)PyRowIter_dealloc,  /*tp_dealloc*/
+  0,  /*tp_print*/
+  0,  /*tp_getattr*/
+  0,  /*tp_setattr*/
+  (cmpfunc)0,  /*tp_compare*/
+  (reprfunc)0,  /*tp_repr*/
+  0,  /*tp_as_number*/
+  0,  /*tp_as_sequence*/
+  0,  /*tp_as_mapping*/
+  0,  /*tp_hash*/
+  0,  /*tp_call*/
+  0,  /*tp_str*/
+  0,  /*tp_getattro*/
+  0,  /*tp_setattro*/
+  0,  /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT,  /*tp_flags*/
+  0,  /*tp_doc*/
+  0,  /*tp_traverse*/
+  0,  /*tp_clear*/
+  0,  /*tp_richcompare*/
+  0,  /*tp_weaklistoffset*/
+  PyObject_SelfIter,  /*tp_iter*/
+  (iternextfunc)PyRowIter_iternext,  /*tp_iternext*/
+};
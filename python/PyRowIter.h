@@ -0,0 +1,34 @@
+// PyRowIter.h --
+// $Id$
+// This is part of MetaKit, see http://www.equi4.com/metakit.html
+// Copyright (C) 1999-2004 Gordon McMillan and Jean-Claude Wippler.
+//
+//  Row iterator class header
+
+#if !defined INCLUDE_PYROWITER_H
+#define INCLUDE_PYROWITER_H
+
+#include <mk4.h>
+#include "PyHead.h"
+
+#define PyRowIter_Check(ob) ((ob)->ob_type == &PyRowItertype)
+
+extern PyTypeObject PyRowItertype;
+
+class PyView;
+
+class PyRowIter: public PyHead {
+  public:
+    PyView *_view; // owned, keeps the storage alive and owns subviews
+    c4_View _props; // the properties to return, in order
+    int _pos; // next row to return
+    int _batch; // rows per list of tuples, or zero for one tuple at a time
+
+    PyRowIter(PyView *view, const c4_View &props, int batch);
+    ~PyRowIter();
+
+    PyObject *makeTuple(int row); // zero on errors
+    PyObject *next(); // zero when done, or on errors
+};
+
+#endif
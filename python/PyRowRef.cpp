@@ -22,21 +22,25 @@ static PyMethodDef RowRefMethods[] =  {
 
 static void PyRowRef_dealloc(PyRowRef *o) {
   //o->~PyRowRef();
+  PyMkLock lock;
   delete o;
 }
 
 static int PyRowRef_print(PyRowRef *o, FILE *f, int) {
+  PyMkLock lock;
   fprintf(f, "<PyRowRef object at %p>", (void*)o);
   return 0;
 }
 
 static int PyRORowRef_print(PyRowRef *o, FILE *f, int) {
+  PyMkLock lock;
   fprintf(f, "<PyRORowRef object at %p>", (void*)o);
   return 0;
 }
 
 static PyObject *PyRowRef_getattr(PyRowRef *o, char *nm) {
   try {
+    PyMkLock lock;
     if (nm[0] == '_' && nm[1] == '_') {
       if (strcmp(nm, "__attrs__") == 0) {
         c4_View parent = o->Container();
@@ -65,13 +69,14 @@ static PyObject *PyRowRef_getattr(PyRowRef *o, char *nm) {
 
 static int PyRowRef_setattr(PyRowRef *o, char *nm, PyObject *v) {
   try {
-    PyProperty *p = o->getProperty(nm);
+    PyMkLock lock;
+    c4_View cntr = o->Container();
+    const c4_Property *p = o->findProperty(cntr, nm);
     if (p) {
       if (v)
         PyRowRef::setFromPython(*o,  *p, v);
       else
         PyRowRef::setDefault(*o,  *p);
-      Py_DECREF(p);
       return 0;
     }
     PyErr_SetString(PyExc_AttributeError, "delete of nonexistent attribute");
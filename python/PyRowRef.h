@@ -39,14 +39,16 @@ class PyRowRef: public PyHead, public c4_RowRef {
         return 0;
     };
 
+    const c4_Property *findProperty(const c4_View &cntr, char *nm) {
+        // no PyProperty needed, the handler keeps the property alive
+        int ndx = cntr.FindPropIndexByName(nm);
+        return ndx >  - 1 ? &cntr.NthProperty(ndx): 0;
+    };
+
     PyObject *getPropertyValue(char *nm) {
-        PyProperty *prop = getProperty(nm);
-        if (prop) {
-            PyObject *result = asPython(*prop);
-            Py_DECREF(prop);
-            return result;
-        }
-        return 0;
+        c4_View cntr = Container();
+        const c4_Property *prop = findProperty(cntr, nm);
+        return prop ? asPython(*prop): 0;
     };
 
     static void setFromPython(const c4_RowRef &row, const c4_Property &prop,
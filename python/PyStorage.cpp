@@ -6,12 +6,14 @@
 //  Storage class implementation and main entry point
 
 #include <Python.h>
+#include <pythread.h>
 #include "PyStorage.h"
 #include <PWOSequence.h>
 #include <PWONumber.h>
 #include "PyView.h"
 #include "PyProperty.h"
 #include "PyRowRef.h"
+#include "PyExpr.h"
 #include "mk4str.h"
 #include "mk4io.h"
 
@@ -131,6 +133,7 @@ static char *autocommit__doc =
 
 static PyObject *PyStorage_Autocommit(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     o->AutoCommit();
     Py_INCREF(Py_None);
     return Py_None;
@@ -144,6 +147,7 @@ static char *contents__doc =
 
 static PyObject *PyStorage_Contents(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     return new PyView(*o, o);
   } catch (...) {
     return 0;
@@ -155,6 +159,7 @@ static char *description__doc =
 
 static PyObject *PyStorage_Description(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOString nm("");
     if (args.len() > 0)
@@ -174,11 +179,17 @@ static char *commit__doc =
 
 static PyObject *PyStorage_Commit(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWONumber flag(0);
     if (args.len() > 0)
       flag = args[0];
-    if (!o->Commit((int)flag != 0))
+    bool ok;
+    {
+      PyAllowThreads nogil;
+      ok = o->Commit((int)flag != 0);
+    }
+    if (!ok)
       Fail(PyExc_IOError, "commit failed");
     Py_INCREF(Py_None);
     return Py_None;
@@ -192,11 +203,17 @@ static char *rollback__doc =
 
 static PyObject *PyStorage_Rollback(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWONumber flag(0);
     if (args.len() > 0)
       flag = args[0];
-    if (!o->Rollback((int)flag != 0))
+    bool ok;
+    {
+      PyAllowThreads nogil;
+      ok = o->Rollback((int)flag != 0);
+    }
+    if (!ok)
       Fail(PyExc_IOError, "rollback failed");
     Py_INCREF(Py_None);
     return Py_None;
@@ -210,6 +227,7 @@ static char *aside__doc =
 
 static PyObject *PyStorage_Aside(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (!PyStorage_Check((PyObject*)args[0]))
       Fail(PyExc_TypeError, "First arg must be a storage");
@@ -228,6 +246,7 @@ static char *view__doc =
 
 static PyObject *PyStorage_View(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOString nm(args[0]);
     return new PyView(o->View(nm), o);
@@ -241,9 +260,16 @@ static char *getas__doc =
 
 static PyObject *PyStorage_GetAs(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOString descr(args[0]);
-    return new PyView(o->GetAs(descr), o);
+    const char *text = descr;
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->GetAs(text);
+    }
+    return new PyView(result, o);
   } catch (...) {
     return 0;
   }
@@ -254,6 +280,7 @@ static char *load__doc =
 
 static PyObject *PyStorage_load(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (args.len() != 1)
       Fail(PyExc_ValueError, "load requires a file-like object");
@@ -273,6 +300,7 @@ static char *save__doc =
 
 static PyObject *PyStorage_save(PyStorage *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (args.len() != 1)
       Fail(PyExc_ValueError, "save requires a file-like object");
@@ -327,10 +355,12 @@ static PyMethodDef StorageMethods[] =  {
 
 static void PyStorage_dealloc(PyStorage *o) {
   //o->~PyStorage();
+  PyMkLock lock;
   delete o;
 }
 
 static PyObject *PyStorage_getattr(PyStorage *o, char *nm) {
+  PyMkLock lock;
   return Py_FindMethod(StorageMethods, o, nm);
 }
 
@@ -352,6 +382,7 @@ static char *storage__doc =
 
 static PyObject *PyStorage_new(PyObject *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PyStorage *ps = 0;
     switch (args.len()) {
@@ -391,7 +422,12 @@ static PyObject *PyStorage_new(PyObject *o, PyObject *_args) {
           int mode;
           if (!PyArg_ParseTuple(args, "esi", "utf_8", &fnm, &mode))
             Fail(PyExc_TypeError, "bad argument type");
-          ps = new PyStorage(fnm, mode);
+          c4_View root;
+          {
+            PyAllowThreads nogil;
+            root = c4_Storage(fnm, mode);
+          }
+          ps = new PyStorage(root);
           PyMem_Free(fnm);
           if (!ps->Strategy().IsValid()) {
             delete ps;
@@ -435,10 +471,12 @@ c4_View PyViewer::GetTemplate() {
 }
 
 int PyViewer::GetSize() {
+  PyEnsureGIL gil; // may be called while the GIL is released
   return _data.len();
 }
 
 bool PyViewer::GetItem(int row_, int col_, c4_Bytes &buf_) {
+  PyEnsureGIL gil;
   const c4_Property &prop = _template.NthProperty(col_);
   if (_byPos) {
     PWOSequence item(_data[row_]);
@@ -471,6 +509,7 @@ bool PyViewer::GetItem(int row_, int col_, c4_Bytes &buf_) {
 }
 
 bool PyViewer::SetItem(int row_, int col_, const c4_Bytes &buf_) {
+  PyEnsureGIL gil;
   const c4_Property &prop = _template.NthProperty(col_);
   c4_Row one;
   prop(one).SetData(buf_);
@@ -492,6 +531,7 @@ bool PyViewer::SetItem(int row_, int col_, const c4_Bytes &buf_) {
 
 static PyObject *PyView_wrap(PyObject *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOSequence seq(args[0]);
     PWOSequence types(args[1]);
@@ -512,6 +552,57 @@ static PyObject *PyView_wrap(PyObject *o, PyObject *_args) {
   }
 }
 
+#if q4_MULTI && defined(WITH_THREAD)
+
+static PyThread_type_lock sMkLock = 0;
+static int sMkDepthKey = 0; // how often each thread holds the lock, if at all
+
+static int MkDepth() {
+  return (int)(Py_intptr_t)PyThread_get_key_value(sMkDepthKey);
+}
+
+static void SetMkDepth(int depth_) {
+  // some Python versions never replace a value which is already set
+  PyThread_delete_key_value(sMkDepthKey);
+  if (depth_ > 0)
+    PyThread_set_key_value(sMkDepthKey, (void*)(Py_intptr_t)depth_);
+}
+
+void PyMkLock::init() {
+  if (sMkLock == 0) {
+    PyEval_InitThreads();
+    sMkLock = PyThread_allocate_lock();
+    sMkDepthKey = PyThread_create_key();
+  }
+}
+
+PyMkLock::PyMkLock() {
+  // the depth is per thread, so this check needs no lock of its own
+  int depth = MkDepth();
+  if (depth > 0) {
+    SetMkDepth(depth + 1);
+    return ;
+  }
+
+  // never wait for the lock with the GIL held, its owner may need the GIL
+  if (!PyThread_acquire_lock(sMkLock, NOWAIT_LOCK)) {
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(sMkLock, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+  }
+
+  SetMkDepth(1);
+}
+
+PyMkLock::~PyMkLock() {
+  int depth = MkDepth() - 1;
+  SetMkDepth(depth);
+  if (depth == 0)
+    PyThread_release_lock(sMkLock);
+}
+
+#endif 
+
 static PyMethodDef Mk4Methods[] =  {
    {
     "view", PyView_new, METH_VARARGS, "view() - create a new unattached view"
@@ -536,10 +627,12 @@ extern "C"__declspec(dllexport)
 void initMk4py() {
   PyObject *m = Py_InitModule4("Mk4py", Mk4Methods, mk4py_module_documentation,
     0, PYTHON_API_VERSION);
+  PyMkLock::init();
   PyObject_SetAttrString(m, "version", PyString_FromString("2.4.9.7"));
   PyObject_SetAttrString(m, "ViewType", (PyObject*) &PyViewtype);
   PyObject_SetAttrString(m, "ViewerType", (PyObject*) &PyViewertype);
   PyObject_SetAttrString(m, "ROViewerType", (PyObject*) &PyROViewertype);
   PyObject_SetAttrString(m, "RowRefType", (PyObject*) &PyRowReftype);
   PyObject_SetAttrString(m, "RORowRefType", (PyObject*) &PyRORowReftype);
+  PyObject_SetAttrString(m, "ExprType", (PyObject*) &PyExprtype);
 }
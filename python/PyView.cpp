@@ -9,6 +9,9 @@
 #include "PyView.h"
 #include "PyProperty.h"
 #include "PyRowRef.h"
+#include "PyColumn.h"
+#include "PyExpr.h"
+#include "PyRowIter.h"
 #include <PWOMSequence.h>
 #include <PWONumber.h>
 #include <PWOMapping.h>
@@ -31,6 +34,7 @@ static char *setsize__doc =
 
 static PyObject *PyView_setsize(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (args.len() != 1)
       Fail(PyExc_TypeError, "setsize() takes exactly one argument");
@@ -46,6 +50,7 @@ static char *structure__doc = "structure() -- return list of properties";
 
 static PyObject *PyView_structure(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (args.len() != 0)
       Fail(PyExc_TypeError, "method takes no arguments");
@@ -60,6 +65,7 @@ static char *properties__doc =
 
 static PyObject *PyView_properties(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (args.len() != 0)
       Fail(PyExc_TypeError, "method takes no arguments");
@@ -74,6 +80,7 @@ static char *insert__doc =
 
 static PyObject *PyView_insert(PyView *o, PyObject *_args, PyObject *kwargs) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     int argcount = args.len();
     if (argcount == 0 || argcount > 2) {
@@ -105,6 +112,7 @@ static char *append__doc =
 
 static PyObject *PyView_append(PyView *o, PyObject *_args, PyObject *kwargs) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWONumber ndx(o->GetSize());
     int argcount = args.len();
@@ -121,11 +129,48 @@ static PyObject *PyView_append(PyView *o, PyObject *_args, PyObject *kwargs) {
   }
 }
 
+static char *extend__doc = 
+  "extend(iterable) -- coerce each item to a row and append them all at once\n"
+  "if an item fails, the rows of all items before it have still been added";
+
+static PyObject *PyView_extend(PyView *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() != 1)
+      Fail(PyExc_TypeError, "extend() takes exactly one argument");
+    o->extend(args[0]);
+    Py_INCREF(Py_None);
+    return Py_None;
+  } catch (...) {
+    return 0;
+  }
+}
+
+static char *from_columns__doc = 
+  "from_columns(dict) -- append rows given as one sequence per property name\n"
+  "all sequences must have the same length, missing properties get defaults";
+
+static PyObject *PyView_from_columns(PyView *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() != 1)
+      Fail(PyExc_TypeError, "from_columns() takes exactly one argument");
+    o->fromColumns(args[0]);
+    Py_INCREF(Py_None);
+    return Py_None;
+  } catch (...) {
+    return 0;
+  }
+}
+
 static char *delete__doc = 
   "delete(position) -- delete row at specified position";
 
 static PyObject *PyView_delete(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     int ndx = PWONumber(args[0]);
     PWOTuple seq;
@@ -142,6 +187,7 @@ static char *addproperty__doc =
 
 static PyObject *PyView_addproperty(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOBase prop(args[0]);
     if (!PyProperty_Check((PyObject*)prop))
@@ -160,15 +206,20 @@ static char *select__doc =
 
 static PyObject *PyView_select(PyView *o, PyObject *_args, PyObject *kwargs) {
   try {
+    PyMkLock lock;
     c4_Row temp;
+    c4_View result;
     PWOSequence args(_args);
-    if (args.len() == 0) {
-      o->makeRow(temp, kwargs, false);
-      return new PyView(o->Select(temp), o, o, o->computeState(NOTIFIABLE));
-    }
-    if (args.len() == 1) {
-      o->makeRow(temp, args[0], false);
-      return new PyView(o->Select(temp), o, o, o->computeState(NOTIFIABLE));
+    if (args.len() <= 1) {
+      if (args.len() == 0)
+        o->makeRow(temp, kwargs, false);
+      else
+        o->makeRow(temp, args[0], false);
+      {
+        PyAllowThreads nogil;
+        result = o->Select(temp);
+      }
+      return new PyView(result, o, o, o->computeState(NOTIFIABLE));
     }
 
     if (PyObject_Length(args[0]) > 0)
@@ -178,8 +229,39 @@ static PyObject *PyView_select(PyView *o, PyObject *_args, PyObject *kwargs) {
     if (temp.Container().NumProperties() == 0 || PyObject_Length(args[1]) > 0)
       o->makeRow(temp2, args[1], false);
 
-    return new PyView(o->SelectRange(temp, temp2), o, o, o->computeState
-      (NOTIFIABLE));
+    {
+      PyAllowThreads nogil;
+      result = o->SelectRange(temp, temp2);
+    }
+    return new PyView(result, o, o, o->computeState(NOTIFIABLE));
+  } catch (...) {
+    return 0;
+  }
+}
+
+static char *where__doc = 
+  "where(expr...) -- return virtual view with the rows for which all exprs hold\n"
+  "  expr is built from properties, as in (p.a > 5) & p.b.startswith('x'),\n"
+  "  or a tuple such as (op, prop, value), with op one of '==', '!=',\n"
+  "  '<', '<=', '>', '>=', 'prefix', 'contains', or 'glob', ('in', prop, seq),\n"
+  "  ('cmp', op, prop, prop), ('and', expr...), ('or', expr...), ('not', expr)";
+
+static PyObject *PyView_where(PyView *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() == 0)
+      Fail(PyExc_TypeError, "where() takes at least one argument");
+
+    c4_Expr expr = o->makeExpr(args[0]);
+    for (int i = 1; i < args.len(); ++i)
+      expr = expr && o->makeExpr(args[i]);
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Select(expr);
+    }
+    return new PyView(result, o, o, o->computeState(NOTIFIABLE));
   } catch (...) {
     return 0;
   }
@@ -191,13 +273,16 @@ static char *sort__doc =
 
 static PyObject *PyView_sort(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
-    if (args.len()) {
-      PyView crit;
-      crit.addProperties(args);
-      return new PyView(o->SortOn(crit), o, o, o->computeState(FINALNOTIFIABLE));
+    PyView crit;
+    crit.addProperties(args);
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = args.len() ? o->SortOn(crit): o->Sort();
     }
-    return new PyView(o->Sort(), o, o, o->computeState(FINALNOTIFIABLE));
+    return new PyView(result, o, o, o->computeState(FINALNOTIFIABLE));
   } catch (...) {
     return 0;
   }
@@ -208,6 +293,7 @@ static char *sortrev__doc =
 
 static PyObject *PyView_sortrev(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
 
     PWOSequence all(args[0]);
@@ -218,8 +304,12 @@ static PyObject *PyView_sortrev(PyView *o, PyObject *_args) {
     PyView propsDown;
     propsDown.addProperties(down);
 
-    return new PyView(o->SortOnReverse(propsAll, propsDown), o, 0, o->computeState
-      (FINALNOTIFIABLE));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->SortOnReverse(propsAll, propsDown);
+    }
+    return new PyView(result, o, 0, o->computeState(FINALNOTIFIABLE));
   } catch (...) {
     return 0;
   }
@@ -230,6 +320,7 @@ static char *project__doc =
 
 static PyObject *PyView_project(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PyView crit;
     crit.addProperties(args);
@@ -245,6 +336,7 @@ static char *flatten__doc =
 
 static PyObject *PyView_flatten(PyView *o, PyObject *_args, PyObject *_kwargs) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOMapping kwargs;
     if (_kwargs)
@@ -263,8 +355,12 @@ static PyObject *PyView_flatten(PyView *o, PyObject *_args, PyObject *_kwargs) {
       if (int(PWONumber(kwargs["outer"])))
         outer = true;
     }
-    return new PyView(o->JoinProp((const c4_ViewProp &)subview, outer), o, 0, o
-      ->computeState(ROVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->JoinProp((const c4_ViewProp &)subview, outer);
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -276,6 +372,7 @@ static char *join__doc =
 static PyObject *PyView_join(PyView *o, PyObject *_args, PyObject *_kwargs) {
   PWOMapping kwargs;
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (_kwargs)
       kwargs = PWOBase(_kwargs);
@@ -294,8 +391,12 @@ static PyObject *PyView_join(PyView *o, PyObject *_args, PyObject *_kwargs) {
     }
     PyView crit;
     crit.addProperties(args.getSlice(1, last));
-    return new PyView(o->Join(crit,  *other, outer), o, 0, o->computeState
-      (ROVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Join(crit,  *other, outer);
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -306,13 +407,19 @@ static char *groupby__doc =
 
 static PyObject *PyView_groupby(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     int last = args.len();
     PWOString subname(args[--last]);
     PyView crit;
     crit.addProperties(args.getSlice(0, last));
     c4_ViewProp sub(subname);
-    return new PyView(o->GroupBy(crit, sub), o, 0, o->computeState(ROVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->GroupBy(crit, sub);
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -323,13 +430,19 @@ static char *counts__doc =
 
 static PyObject *PyView_counts(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     int last = args.len();
     PWOString name(args[--last]);
     PyView crit;
     crit.addProperties(args.getSlice(0, last));
     c4_IntProp count(name);
-    return new PyView(o->Counts(crit, count), o, 0, o->computeState(ROVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Counts(crit, count);
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -340,6 +453,7 @@ static char *rename__doc =
 
 static PyObject *PyView_rename(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
 
     PWOString oldName(args[0]);
@@ -362,7 +476,13 @@ static char *unique__doc =
 
 static PyObject *PyView_unique(PyView *o, PyObject *_args) {
   try {
-    return new PyView(o->Unique(), o, 0, o->computeState(ROVIEWER));
+    PyMkLock lock;
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Unique();
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -373,6 +493,7 @@ static char *product__doc =
 
 static PyObject *PyView_product(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
     return new PyView(o->Product(*(PyView*)(PyObject*)args[0]), o, 0, o
@@ -386,10 +507,15 @@ static char *union__doc = "union(view2) -- produce the set union of both views";
 
 static PyObject *PyView_union(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
-    return new PyView(o->Union(*(PyView*)(PyObject*)args[0]), o, 0, o
-      ->computeState(ROVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Union(*(PyView*)(PyObject*)args[0]);
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -400,10 +526,15 @@ static char *intersect__doc =
 
 static PyObject *PyView_intersect(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
-    return new PyView(o->Intersect(*(PyView*)(PyObject*)args[0]), o, 0, o
-      ->computeState(ROVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Intersect(*(PyView*)(PyObject*)args[0]);
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -414,10 +545,15 @@ static char *different__doc =
 
 static PyObject *PyView_different(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
-    return new PyView(o->Different(*(PyView*)(PyObject*)args[0]), o, 0, o
-      ->computeState(ROVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Different(*(PyView*)(PyObject*)args[0]);
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -427,10 +563,15 @@ static char *minus__doc = "minus(view2) -- all rows in view, but not in view2";
 
 static PyObject *PyView_minus(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
-    return new PyView(o->Minus(*(PyView*)(PyObject*)args[0]), o, 0, o
-      ->computeState(ROVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Minus(*(PyView*)(PyObject*)args[0]);
+    }
+    return new PyView(result, o, 0, o->computeState(ROVIEWER));
   } catch (...) {
     return 0;
   }
@@ -441,6 +582,7 @@ static char *remapwith__doc =
 
 static PyObject *PyView_remapwith(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
     return new PyView(o->RemapWith(*(PyView*)(PyObject*)args[0]), o, 0, o
@@ -455,6 +597,7 @@ static char *pair__doc =
 
 static PyObject *PyView_pair(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
     return new PyView(o->Pair(*(PyView*)(PyObject*)args[0]), o, 0, o->computeState
@@ -471,6 +614,7 @@ static char *hash__doc =
 
 static PyObject *PyView_hash(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
 
     c4_View map;
@@ -479,7 +623,12 @@ static PyObject *PyView_hash(PyView *o, PyObject *_args) {
       map = *(PyView*)(PyObject*)args[0];
     }
     int numkeys = args.len() <= 1 ? 1 : (int)PWONumber(args[1]);
-    return new PyView(o->Hash(map, numkeys), o, 0, o->computeState(MVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Hash(map, numkeys);
+    }
+    return new PyView(result, o, 0, o->computeState(MVIEWER));
   } catch (...) {
     return 0;
   }
@@ -490,7 +639,13 @@ static char *blocked__doc =
 
 static PyObject *PyView_blocked(PyView *o, PyObject *_args) {
   try {
-    return new PyView(o->Blocked(), o, 0, o->computeState(MVIEWER));
+    PyMkLock lock;
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Blocked();
+    }
+    return new PyView(result, o, 0, o->computeState(MVIEWER));
   } catch (...) {
     return 0;
   }
@@ -502,9 +657,15 @@ static char *ordered__doc =
 
 static PyObject *PyView_ordered(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     int numkeys = args.len() <= 0 ? 1 : (int)PWONumber(args[0]);
-    return new PyView(o->Ordered(numkeys), o, 0, o->computeState(MVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Ordered(numkeys);
+    }
+    return new PyView(result, o, 0, o->computeState(MVIEWER));
   } catch (...) {
     return 0;
   }
@@ -515,6 +676,7 @@ static char *indexed__doc =
 
 static PyObject *PyView_indexed(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
     PyView *other = (PyView*)(PyObject*)args[0];
@@ -527,8 +689,12 @@ static PyObject *PyView_indexed(PyView *o, PyObject *_args) {
     }
     PyView crit;
     crit.addProperties(args.getSlice(1, last));
-    return new PyView(o->Indexed(crit,  *other, unique), o, 0, o->computeState
-      (MVIEWER));
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Indexed(crit,  *other, unique);
+    }
+    return new PyView(result, o, 0, o->computeState(MVIEWER));
   } catch (...) {
     return 0;
   }
@@ -542,6 +708,7 @@ static PyObject *PyView_find(PyView *o, PyObject *_args, PyObject *_kwargs) {
   PWONumber start(0);
   PWOMapping crit;
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (_kwargs) {
       PWOMapping kwargs(_kwargs);
@@ -560,7 +727,12 @@ static PyObject *PyView_find(PyView *o, PyObject *_args, PyObject *_kwargs) {
     }
     c4_Row temp;
     o->makeRow(temp, crit, false);
-    return PWONumber(o->Find(temp, start)).disOwn();
+    int pos = start;
+    {
+      PyAllowThreads nogil;
+      pos = o->Find(temp, pos);
+    }
+    return PWONumber(pos).disOwn();
   } catch (...) {
     return 0;
   }
@@ -571,6 +743,7 @@ static char *search__doc =
 
 static PyObject *PyView_search(PyView *o, PyObject *_args, PyObject *kwargs) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (args.len() != 0)
       kwargs = args[0];
@@ -587,6 +760,7 @@ static char *locate__doc =
 
 static PyObject *PyView_locate(PyView *o, PyObject *_args, PyObject *kwargs) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (args.len() != 0)
       kwargs = args[0];
@@ -609,6 +783,7 @@ static char *access__doc =
 
 static PyObject *PyView_access(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (!PyProperty_Check((PyObject*)args[0]))
       Fail(PyExc_TypeError, "First arg must be a property");
@@ -656,6 +831,7 @@ static char *modify__doc =
 
 static PyObject *PyView_modify(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (!PyProperty_Check((PyObject*)args[0]))
       Fail(PyExc_TypeError, "First arg must be a property");
@@ -690,6 +866,7 @@ static char *itemsize__doc =
 
 static PyObject *PyView_itemsize(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (!PyProperty_Check((PyObject*)args[0]))
       Fail(PyExc_TypeError, "First arg must be a property");
@@ -706,11 +883,62 @@ static PyObject *PyView_itemsize(PyView *o, PyObject *_args) {
   }
 }
 
+static char *column__doc = 
+  "column(prop) -- return all values of a column at once, without row objects\n"
+  "I/L/F/D columns return a PyColumn, with the buffer interface of an array\n"
+  "of 'i', 'q', 'f', or 'd' items, S/B/M columns return an (offsets, data)\n"
+  "pair where item i is data[offsets[i]:offsets[i+1]], with 'q' offsets";
+
+static PyObject *PyView_column(PyView *o, PyObject *_args) {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    if (args.len() != 1)
+      Fail(PyExc_TypeError, "column() takes exactly one argument");
+    return o->column(o->exprProp(args[0]));
+  } catch (...) {
+    return 0;
+  }
+}
+
+static char *iterrows__doc = 
+  "iterrows(props=None, batch=0) -- iterate over the values of each row as a tuple\n"
+  "  props lists the properties or names to return, by default all of them,\n"
+  "  with batch > 0 each step returns a list of up to that many tuples";
+
+static PyObject *PyView_iterrows(PyView *o, PyObject *_args, PyObject *_kwargs)
+  {
+  try {
+    PyMkLock lock;
+    PWOSequence args(_args);
+    PWOMapping kwargs;
+    if (_kwargs)
+      kwargs = PWOBase(_kwargs);
+    if (args.len() > 2)
+      Fail(PyExc_TypeError, "iterrows() takes at most two arguments");
+
+    PyObject *props = args.len() > 0 ? (PyObject*)args[0]: Py_None;
+    if (kwargs.hasKey("props"))
+      props = kwargs["props"];
+
+    int batch = 0;
+    if (args.len() > 1)
+      batch = int(PWONumber(args[1]));
+    if (kwargs.hasKey("batch"))
+      batch = int(PWONumber(kwargs["batch"]));
+
+    return o->iterrows(props, batch);
+  } catch (...) {
+    return 0;
+  }
+}
+
 static char *relocrows__doc = 
   "relocrows(from, count, dest, pos) -- relocate rows within views of same storage\n""from is source offset, count is number of rows, pos is destination offset\n""both views must have a compatible structure (field names may differ)";
 
 static PyObject *PyView_relocrows(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     if (!PyView_Check((PyObject*)args[2]))
       Fail(PyExc_TypeError, "Third arg must be a view object");
@@ -751,6 +979,7 @@ static char *map__doc =
 
 static PyObject *PyView_map(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOCallable func(args[0]);
     if (args.len() > 1) {
@@ -771,11 +1000,15 @@ static PyObject *PyView_map(PyView *o, PyObject *_args) {
 }
 
 static char *filter__doc = 
-  "filter(func) -- return a new view containing the indices of those rows satisfying func.\n""  func must have the signature func(row), and should return a false value to omit row.";
+  "filter(func) -- return a new view containing the indices of those rows satisfying func.\n""  func must have the signature func(row), and should return a false value to omit row.\n"
+  "filter(expr) -- same, for an expression as accepted by where(), without calling back";
 
 static PyObject *PyView_filter(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
+    if (PyExpr_Check((PyObject*)args[0]) || PyTuple_Check((PyObject*)args[0]))
+      return o->filter(o->makeExpr(args[0]));
     PWOCallable func(args[0]);
     return o->filter(func);
   } catch (...) {
@@ -788,6 +1021,7 @@ static char *reduce__doc =
 
 static PyObject *PyView_reduce(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     PWOCallable func(args[0]);
     PWONumber start(0);
@@ -805,6 +1039,7 @@ static char *remove__doc =
 
 static PyObject *PyView_remove(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
 
@@ -822,6 +1057,7 @@ static char *indices__doc =
 
 static PyObject *PyView_indices(PyView *o, PyObject *_args) {
   try {
+    PyMkLock lock;
     PWOSequence args(_args);
     MustBeView(args[0]);
 
@@ -836,7 +1072,13 @@ static char *copy__doc = "copy() -- returns a copy of the view\n";
 
 static PyObject *PyView_copy(PyView *o, PyObject *_args) {
   try {
-    return new PyView(o->Duplicate(), o);
+    PyMkLock lock;
+    c4_View result;
+    {
+      PyAllowThreads nogil;
+      result = o->Duplicate();
+    }
+    return new PyView(result, o);
   } catch (...) {
     return 0;
   }
@@ -854,6 +1096,13 @@ static PyMethodDef ViewMethods[] =  {
     "append", (PyCFunction)PyView_append, METH_VARARGS | METH_KEYWORDS,
       append__doc
   }
+  ,  {
+    "extend", (PyCFunction)PyView_extend, METH_VARARGS, extend__doc
+  }
+  ,  {
+    "from_columns", (PyCFunction)PyView_from_columns, METH_VARARGS,
+      from_columns__doc
+  }
   ,  {
     "delete", (PyCFunction)PyView_delete, METH_VARARGS, delete__doc
   }
@@ -864,6 +1113,9 @@ static PyMethodDef ViewMethods[] =  {
     "select", (PyCFunction)PyView_select, METH_VARARGS | METH_KEYWORDS,
       select__doc
   }
+  ,  {
+    "where", (PyCFunction)PyView_where, METH_VARARGS, where__doc
+  }
   ,  {
     "addproperty", (PyCFunction)PyView_addproperty, METH_VARARGS,
       addproperty__doc
@@ -949,6 +1201,13 @@ static PyMethodDef ViewMethods[] =  {
   ,  {
     "itemsize", (PyCFunction)PyView_itemsize, METH_VARARGS, itemsize__doc
   }
+  ,  {
+    "column", (PyCFunction)PyView_column, METH_VARARGS, column__doc
+  }
+  ,  {
+    "iterrows", (PyCFunction)PyView_iterrows, METH_VARARGS | METH_KEYWORDS,
+      iterrows__doc
+  }
   , 
   // {"relocrows", (PyCFunction)PyView_relocrows, METH_VARARGS, relocrows__doc},
    {
@@ -984,6 +1243,9 @@ static PyMethodDef ViewerMethods[] =  {
     "select", (PyCFunction)PyView_select, METH_VARARGS | METH_KEYWORDS,
       select__doc
   }
+  ,  {
+    "where", (PyCFunction)PyView_where, METH_VARARGS, where__doc
+  }
   ,  {
     "addproperty", (PyCFunction)PyView_addproperty, METH_VARARGS,
       addproperty__doc
@@ -1069,6 +1331,13 @@ static PyMethodDef ViewerMethods[] =  {
   ,  {
     "itemsize", (PyCFunction)PyView_itemsize, METH_VARARGS, itemsize__doc
   }
+  ,  {
+    "column", (PyCFunction)PyView_column, METH_VARARGS, column__doc
+  }
+  ,  {
+    "iterrows", (PyCFunction)PyView_iterrows, METH_VARARGS | METH_KEYWORDS,
+      iterrows__doc
+  }
   , 
   //{"map", (PyCFunction)PyView_map, METH_VARARGS, map__doc},
    {
@@ -1099,6 +1368,7 @@ static Py_ssize_t PyView_length(PyObject *_o) {
   PyView *o = (PyView*)_o;
 
   try {
+    PyMkLock lock;
     return o->GetSize();
   } catch (...) {
     return  - 1;
@@ -1110,6 +1380,7 @@ static PyObject *PyView_concat(PyObject *_o, PyObject *_other) {
   PyView *other = (PyView*)_other;
 
   try {
+    PyMkLock lock;
     if (!PyGenericView_Check(other))
       Fail(PyExc_TypeError, "Not a PyView(er)");
     return new PyView(o->Concat(*other), o, 0, o->computeState(RWVIEWER));
@@ -1122,6 +1393,7 @@ static PyObject *PyView_repeat(PyObject *_o, Py_ssize_t n) {
   PyView *o = (PyView*)_o;
 
   try {
+    PyMkLock lock;
     PyView *tmp = new PyView(*o, o, 0, o->computeState(RWVIEWER));
     while (--n > 0) {
       //!! a huge stack of views?
@@ -1139,6 +1411,7 @@ static PyObject *PyView_getitem(PyObject *_o, Py_ssize_t n) {
   PyView *o = (PyView*)_o;
 
   try {
+    PyMkLock lock;
     PyObject *rslt = o->getItem(n);
     if (rslt == 0)
       PyErr_SetString(PyExc_IndexError, "row index out of range");
@@ -1152,6 +1425,7 @@ static PyObject *PyView_getslice(PyObject *_o, Py_ssize_t s, Py_ssize_t e) {
   PyView *o = (PyView*)_o;
 
   try {
+    PyMkLock lock;
     return o->getSlice(s, e);
   } catch (...) {
     return 0;
@@ -1162,6 +1436,7 @@ static int PyView_setitem(PyObject *_o, Py_ssize_t n, PyObject *v) {
   PyView *o = (PyView*)_o;
 
   try {
+    PyMkLock lock;
     if (n < 0)
       n += o->GetSize();
     if (n >= o->GetSize() || n < 0)
@@ -1182,6 +1457,7 @@ static int PyView_setslice(PyObject *_o, Py_ssize_t s, Py_ssize_t e, PyObject
   PyView *o = (PyView*)_o;
 
   try {
+    PyMkLock lock;
     if (v == 0) {
       PWOTuple seq;
       return o->setSlice(s, e, seq);
@@ -1216,20 +1492,24 @@ static PySequenceMethods ViewerAsSeq =  {
 
 static void PyView_dealloc(PyView *o) {
   //o->~PyView();
+  PyMkLock lock;
   delete o;
 }
 
 static int PyView_print(PyView *o, FILE *f, int) {
+  PyMkLock lock;
   fprintf(f, "<PyView object at %p>", (void*)o);
   return 0;
 }
 
 static int PyViewer_print(PyView *o, FILE *f, int) {
+  PyMkLock lock;
   fprintf(f, "<PyViewer object at %p>", (void*)o);
   return 0;
 }
 
 static int PyROViewer_print(PyView *o, FILE *f, int) {
+  PyMkLock lock;
   fprintf(f, "<PyROViewer object at %p>", (void*)o);
   return 0;
 }
@@ -1237,6 +1517,7 @@ static int PyROViewer_print(PyView *o, FILE *f, int) {
 static PyObject *PyView_getattr(PyView *o, char *nm) {
   PyObject *rslt;
   try {
+    PyMkLock lock;
     rslt = Py_FindMethod(ViewMethods, o, nm);
     if (rslt)
       return rslt;
@@ -1254,6 +1535,7 @@ static PyObject *PyView_getattr(PyView *o, char *nm) {
 static PyObject *PyViewer_getattr(PyView *o, char *nm) {
   PyObject *rslt;
   try {
+    PyMkLock lock;
     rslt = Py_FindMethod(ViewerMethods, o, nm);
     if (rslt)
       return rslt;
@@ -1332,6 +1614,7 @@ PyTypeObject *getTypeObject(int type) {
 
 
 PyObject *PyView_new(PyObject *o, PyObject *_args) {
+  PyMkLock lock;
   return new PyView;
 }
 
@@ -1364,6 +1647,199 @@ void PyView::makeRowFromDict(c4_Row &tmp, PyObject *o, bool useDefaults) {
   }
 }
 
+/*
+ *  Numeric columns come straight from the core, which can return them in
+ *  place from a memory-mapped file.  Strings and bytes are gathered into
+ *  one string object, with the offsets of all items in a separate column.
+ */
+
+PyObject *PyView::column(const c4_Property &prop) {
+  int n = GetSize();
+
+  switch (prop.Type()) {
+    case 'I':
+    case 'L':
+    case 'F':
+    case 'D':
+       {
+        static const char *types = "ILFD";
+        static const char *codes = "iqfd";
+        int k = strchr(types, prop.Type()) - types;
+
+        PyColumn *col = new PyColumn(*this, codes[k], k % 2 ? 8 : 4);
+        bool ok;
+        {
+          PyAllowThreads nogil;
+          ok = GetColumn(prop, col->_data);
+        }
+        if (!ok) {
+          Py_DECREF(col);
+          Fail(PyExc_KeyError, prop.Name());
+        }
+        col->setCount();
+        return col;
+      }
+    case 'S':
+    case 'B':
+    case 'M':
+      break;
+    default:
+      Fail(PyExc_TypeError, "column type not supported");
+  }
+
+  if (FindProperty(prop.GetId()) < 0)
+    Fail(PyExc_KeyError, prop.Name());
+
+  PyColumn *offsets = new PyColumn(*this, 'q', sizeof(t4_i64));
+  t4_i64 *off = (t4_i64*)offsets->_data.SetBuffer((n + 1) *sizeof(t4_i64));
+  offsets->setCount();
+
+  // strings usually carry a trailing null byte, which is left out here
+  bool isString = prop.Type() == 'S';
+
+  c4_Bytes temp;
+  off[0] = 0;
+  for (int i = 0; i < n; ++i) {
+    prop(GetAt(i)).GetData(temp);
+    int size = temp.Size();
+    if (isString && size > 0 && temp.Contents()[size - 1] == 0)
+      --size;
+    off[i + 1] = off[i] + size;
+  }
+
+  PyObject *data = PyString_FromStringAndSize(0, (Py_ssize_t)off[n]);
+  if (data == 0) {
+    Py_DECREF(offsets);
+    Fail(PyExc_MemoryError, "column too large");
+  }
+
+  for (int j = 0; j < n; ++j)
+    if (off[j + 1] > off[j]) {
+      prop(GetAt(j)).GetData(temp);
+      memcpy(PyString_AS_STRING(data) + off[j], temp.Contents(), (int)(off[j
+        + 1] - off[j]));
+    }
+
+  PyObject *result = PyTuple_New(2);
+  PyTuple_SET_ITEM(result, 0, offsets);
+  PyTuple_SET_ITEM(result, 1, data);
+  return result;
+}
+
+PyObject *PyView::iterrows(PyObject *props, int batch) {
+  // resolve the properties once, rather than by name in each row
+  c4_View list;
+  if (props == Py_None)
+    for (int i = 0; i < NumProperties(); ++i)
+      list.AddProperty(NthProperty(i));
+  else {
+    PWOSequence seq(props);
+    for (int i = 0; i < seq.len(); ++i) {
+      const c4_Property &prop = exprProp(seq[i]);
+      if (FindProperty(prop.GetId()) < 0)
+        Fail(PyExc_KeyError, prop.Name());
+      list.AddProperty(prop);
+    }
+  }
+
+  return new PyRowIter(this, list, batch);
+}
+
+const c4_Property &PyView::exprProp(PyObject *o) {
+  if (PyProperty_Check(o))
+    return  *(PyProperty*)o;
+
+  PWOString name(o);
+  int ndx = FindPropIndexByName(name);
+  if (ndx < 0)
+    Fail(PyExc_KeyError, name);
+  return NthProperty(ndx);
+}
+
+c4_Expr PyView::makeExpr(PyObject *o) {
+  static const char *ops[] =  {
+    "==", "!=", "<", "<=", ">", ">=", "prefix", "contains", "glob",  
+      // same order as in c4_Expr
+    "and", "or", "not", "in", "cmp", 0
+  };
+
+  if (PyExpr_Check(o))
+    return ((PyExpr*)o)->_expr;
+
+  if (!PyTuple_Check(o) || PyTuple_Size(o) == 0)
+    Fail(PyExc_TypeError, "expression must be a non-empty tuple");
+
+  PWOSequence expr(o);
+  PWOString opname(expr[0]);
+
+  int id = 0;
+  while (ops[id] && strcmp(ops[id], opname) != 0)
+    ++id;
+  if (!ops[id])
+    Fail(PyExc_ValueError, "unknown operator in expression");
+
+  int n = expr.len();
+  switch (id) {
+    case 9:
+    case 10:  {
+      // and / or, with any number of subexpressions
+      c4_Expr result = id == 9 ? c4_Expr(): !c4_Expr();
+      for (int i = 1; i < n; ++i) {
+        c4_Expr sub = makeExpr(expr[i]);
+        if (i == 1)
+          result = sub;
+        else if (id == 9)
+          result = result && sub;
+        else
+          result = result || sub;
+      }
+      return result;
+    }
+
+    case 11:
+      if (n != 2)
+        Fail(PyExc_TypeError, "expected ('not', expr)");
+      return !makeExpr(expr[1]);
+
+    case 12:  {
+      if (n != 3)
+        Fail(PyExc_TypeError, "expected ('in', prop, values)");
+
+      const c4_Property &prop = exprProp(expr[1]);
+      PWOSequence values(expr[2]);
+
+      c4_View list = prop;
+      c4_Row row;
+      for (int i = 0; i < values.len(); ++i) {
+        PyRowRef::setFromPython(row, prop, values[i]);
+        list.Add(row);
+      }
+      return c4_Expr(list);
+    }
+
+    case 13:  {
+      if (n != 4)
+        Fail(PyExc_TypeError, "expected ('cmp', op, prop, prop)");
+
+      PWOString cmpname(expr[1]);
+      int op = 0;
+      while (op <= c4_Expr::kGE && strcmp(ops[op], cmpname) != 0)
+        ++op;
+      if (op > c4_Expr::kGE)
+        Fail(PyExc_ValueError, "unknown comparison in expression");
+
+      return c4_Expr(exprProp(expr[2]), op, exprProp(expr[3]));
+    }
+  }
+
+  if (n != 3)
+    Fail(PyExc_TypeError, "expected (op, prop, value)");
+
+  c4_Row row;
+  PyRowRef::setFromPython(row, exprProp(expr[1]), expr[2]);
+  return c4_Expr(row, id);
+}
+
 void PyView::makeRow(c4_Row &tmp, PyObject *o, bool useDefaults) {
   /* can't just check if mapping type; strings are mappings in Python 2.3
   (but not in 2.2 or earlier) */
@@ -1442,6 +1918,435 @@ void PyView::insertAt(int i, PyObject *o) {
   }
 }
 
+/*
+ *  Bulk inserts convert the values of a batch of rows into one plain buffer
+ *  per column, and then add the whole batch with a single InsertAt.  The core
+ *  copies such a custom view column by column, without calling back into
+ *  Python, so this is done with the GIL released.  Strings are not copied,
+ *  the buffers hold references to the string objects instead.  Subviews and
+ *  values of other types go through setFromPython, same as in append.
+ */
+
+class PyBulkViewer: public c4_CustomViewer {
+    c4_View _template;
+    c4_View _views; // values of subview properties
+    c4_Row _scratch; // values of other types, before copying them
+    c4_Bytes _slots; // a slot of 8 bytes for each value
+    PWOMapping _names; // maps dict keys to property positions
+    int _batch;
+    int _rows;
+    bool _hasViews;
+
+    t4_byte *Slot(int row_, int col_);
+    void ClearRow(int row_);
+
+  public:
+    enum {
+        kBatch = 8192
+    };
+
+    PyBulkViewer(const c4_View &template_, int batch_);
+    virtual ~PyBulkViewer();
+
+    virtual c4_View GetTemplate();
+    virtual int GetSize();
+    virtual bool GetItem(int row_, int col_, c4_Bytes &buf_);
+
+    bool IsFull()const;
+    void SetValue(int col_, PyObject *item_);
+    void NextRow();
+    void UndoRow();
+    void AddRow(PyObject *row_);
+    void Clear();
+};
+
+PyBulkViewer::PyBulkViewer(const c4_View &template_, int batch_): _template
+  (template_), _batch(batch_ < kBatch ? batch_ : kBatch), _rows(0), _hasViews
+  (false) {
+  if (_batch < 1)
+    _batch = 1;
+
+  int n = _template.NumProperties();
+  for (int i = 0; i < n; ++i)
+    if (_template.NthProperty(i).Type() == 'V') {
+      _views.AddProperty(_template.NthProperty(i));
+      _hasViews = true;
+    }
+  _slots.SetBufferClear(n *_batch * 8);
+  if (_hasViews)
+    _views.SetSize(1);
+}
+
+PyBulkViewer::~PyBulkViewer() {
+  Clear();
+}
+
+c4_View PyBulkViewer::GetTemplate() {
+  return _template;
+}
+
+int PyBulkViewer::GetSize() {
+  return _rows;
+}
+
+t4_byte *PyBulkViewer::Slot(int row_, int col_) {
+  return (t4_byte*)_slots.Contents() + (col_ *_batch + row_) * 8;
+}
+
+bool PyBulkViewer::GetItem(int row_, int col_, c4_Bytes &buf_) {
+  const c4_Property &prop = _template.NthProperty(col_);
+  const t4_byte *p = Slot(row_, col_);
+
+  switch (prop.Type()) {
+    case 'I':
+    case 'F':
+      buf_ = c4_Bytes(p, 4, false);
+      return true;
+    case 'L':
+    case 'D':
+      buf_ = c4_Bytes(p, 8, false);
+      return true;
+    case 'S':
+    case 'B':
+    case 'M':
+       {
+        // strings include their trailing null byte, which Python has as well
+        int extra = prop.Type() == 'S' ? 1 : 0;
+        PyObject *s = *(PyObject **)p;
+        if (s == 0)
+          buf_ = c4_Bytes("", extra, false);
+        else
+          buf_ = c4_Bytes(PyString_AS_STRING(s), PyString_GET_SIZE(s) + extra,
+            false);
+      }
+      return true;
+  }
+
+  return prop(_views[row_]).GetData(buf_);
+}
+
+bool PyBulkViewer::IsFull()const {
+  return _rows >= _batch;
+}
+
+void PyBulkViewer::SetValue(int col_, PyObject *item_) {
+  const c4_Property &prop = _template.NthProperty(col_);
+  t4_byte *p = Slot(_rows, col_);
+
+  // the common cases are converted here, the rest as in setFromPython
+  switch (prop.Type()) {
+    case 'I':
+      if (PyInt_Check(item_)) {
+        *(t4_i32*)p = (t4_i32)PyInt_AS_LONG(item_);
+        return ;
+      }
+      break;
+#ifdef HAVE_LONG_LONG
+    case 'L':
+      if (PyInt_Check(item_)) {
+        *(t4_i64*)p = PyInt_AS_LONG(item_);
+        return ;
+      }
+      break;
+#endif 
+    case 'F':
+      if (PyFloat_Check(item_)) {
+        *(float*)p = (float)PyFloat_AS_DOUBLE(item_);
+        return ;
+      }
+      break;
+    case 'D':
+      if (PyFloat_Check(item_)) {
+        *(double*)p = PyFloat_AS_DOUBLE(item_);
+        return ;
+      }
+      break;
+    case 'S':
+      if (PyString_Check(item_)) {
+        if ((size_t)PyString_GET_SIZE(item_) != strlen(PyString_AS_STRING
+          (item_)))
+          Fail(PyExc_ValueError, "string contains embedded nulls; try 'B' type")
+            ;
+        Py_INCREF(item_);
+        Py_XDECREF(*(PyObject **)p);
+        *(PyObject **)p = item_;
+        return ;
+      }
+      break;
+    case 'B':
+    case 'M':
+      if (PyString_Check(item_)) {
+        Py_INCREF(item_);
+        Py_XDECREF(*(PyObject **)p);
+        *(PyObject **)p = item_;
+        return ;
+      }
+      break;
+    case 'V':
+      PyRowRef::setFromPython(_views[_rows], prop, item_);
+      return ;
+  }
+
+  if (item_ == Py_None)
+    return ;
+
+  PyRowRef::setFromPython(_scratch, prop, item_);
+
+  switch (prop.Type()) {
+    case 'I':
+      *(t4_i32*)p = ((const c4_IntProp &)prop)(_scratch);
+      break;
+#ifdef HAVE_LONG_LONG
+    case 'L':
+      *(t4_i64*)p = ((const c4_LongProp &)prop)(_scratch);
+      break;
+#endif 
+    case 'F':
+      *(float*)p = (float)((const c4_FloatProp &)prop)(_scratch);
+      break;
+    case 'D':
+      *(double*)p = ((const c4_DoubleProp &)prop)(_scratch);
+      break;
+    default:
+       {
+        // keep a string object, e.g. with the UTF-8 encoding of unicode
+        c4_Bytes data;
+        prop(_scratch).GetData(data);
+        int n = data.Size();
+        if (prop.Type() == 'S' && n > 0)
+          --n;
+        PyObject *s = PyString_FromStringAndSize((const char*)data.Contents(),
+          n);
+        if (s == 0)
+          throw PWDPyException;
+        Py_XDECREF(*(PyObject **)p);
+        *(PyObject **)p = s;
+      }
+  }
+}
+
+void PyBulkViewer::NextRow() {
+  ++_rows;
+  if (_hasViews)
+    _views.SetSize(_rows + 1);
+}
+
+void PyBulkViewer::ClearRow(int row_) {
+  int n = _template.NumProperties();
+  for (int i = 0; i < n; ++i) {
+    t4_byte *p = Slot(row_, i);
+    switch (_template.NthProperty(i).Type()) {
+      case 'S':
+      case 'B':
+      case 'M':
+        Py_XDECREF(*(PyObject **)p);
+    }
+    memset(p, 0, 8);
+  }
+}
+
+void PyBulkViewer::UndoRow() {
+  ClearRow(_rows);
+  if (_hasViews) {
+    _views.SetSize(_rows);
+    _views.SetSize(_rows + 1);
+  }
+}
+
+/* Rows are coerced as in makeRow, but without a c4_Row for each of them */
+void PyBulkViewer::AddRow(PyObject *row_) {
+  int n = _template.NumProperties();
+
+  try {
+    if (PyDict_Check(row_)) {
+      Py_ssize_t pos = 0;
+      PyObject *key,  *value;
+      while (PyDict_Next(row_, &pos, &key, &value)) {
+        PyObject *col = PyDict_GetItem(_names, key);
+        if (col == 0) {
+          PWOString name(key);
+          col = PyInt_FromLong(_template.FindPropIndexByName(name));
+          PyDict_SetItem(_names, key, col);
+          Py_DECREF(col);
+        }
+        int ndx = PyInt_AS_LONG(col);
+        if (ndx >= 0)
+          SetValue(ndx, value);
+      }
+    } else if (PySequence_Check(row_) && !PyInstance_Check(row_)) {
+      PyObject *seq = PySequence_Fast(row_, "");
+      if (seq == 0)
+        throw PWDPyException;
+      int m = PySequence_Fast_GET_SIZE(seq);
+      if (m > n) {
+        Py_DECREF(seq);
+        PyErr_Format(PyExc_IndexError, 
+          "Sequence has %d elements; view has %d properties", m, n);
+        throw PWDPyException;
+      }
+      try {
+        for (int i = 0; i < m; ++i)
+          SetValue(i, PySequence_Fast_GET_ITEM(seq, i));
+      } catch (...) {
+        Py_DECREF(seq);
+        throw;
+      }
+      Py_DECREF(seq);
+    } else if (PyInstance_Check(row_) || (PyObject_HasAttrString(row_,
+      "__class__") && !PyNumber_Check(row_))) {
+      for (int i = 0; i < n; ++i) {
+        const c4_Property &prop = _template.NthProperty(i);
+        PyObject *attr = PyObject_GetAttrString(row_, (char*)prop.Name());
+        if (attr == 0 && i == 0 && n == 1) {
+          PyErr_Clear();
+          attr = row_;
+          Py_INCREF(attr);
+        }
+        if (attr == 0) {
+          PyErr_Clear();
+          continue;
+        }
+        try {
+          SetValue(i, attr);
+        } catch (...) {
+          Py_DECREF(attr);
+          throw;
+        }
+        Py_DECREF(attr);
+      }
+    } else
+      Fail(PyExc_TypeError, 
+        "Argument is not an instance, sequence or dictionary: cannot be coerced to row");
+  } catch (...) {
+    UndoRow();
+    throw;
+  }
+
+  NextRow();
+}
+
+void PyBulkViewer::Clear() {
+  for (int i = 0; i < _rows; ++i)
+    ClearRow(i);
+  _rows = 0;
+  if (_hasViews) {
+    _views.SetSize(0);
+    _views.SetSize(1);
+  }
+}
+
+static void InsertBatch(PyView &view_, const c4_View &batch_, PyBulkViewer
+  &bulk_) {
+  if (bulk_.GetSize() > 0) {
+    {
+      PyAllowThreads nogil;
+      view_.InsertAt(view_.GetSize(), batch_);
+    }
+    bulk_.Clear();
+  }
+}
+
+void PyView::extend(PyObject *o) {
+  if (PyGenericView_Check(o)) {
+    PyAllowThreads nogil;
+    InsertAt(GetSize(), *(PyView*)o);
+    return ;
+  }
+
+  PyObject *iter = PyObject_GetIter(o);
+  if (iter == 0)
+    throw PWDPyException;
+
+  // size the buffers to fit, if the number of rows is known
+  int n = PyObject_Size(o);
+  if (n < 0) {
+    PyErr_Clear();
+    n = PyBulkViewer::kBatch;
+  }
+
+  PyBulkViewer *bulk = new PyBulkViewer(Clone(), n);
+  c4_View batch(bulk);
+
+  try {
+    PyObject *item;
+    while ((item = PyIter_Next(iter)) != 0) {
+      try {
+        bulk->AddRow(item);
+      } catch (...) {
+        Py_DECREF(item);
+        throw;
+      }
+      Py_DECREF(item);
+      if (bulk->IsFull())
+        InsertBatch(*this, batch,  *bulk);
+    }
+    if (PyErr_Occurred())
+      throw PWDPyException;
+  } catch (...) {
+    Py_DECREF(iter);
+    InsertBatch(*this, batch,  *bulk);
+    throw;
+  }
+
+  Py_DECREF(iter);
+  InsertBatch(*this, batch,  *bulk);
+}
+
+void PyView::fromColumns(PyObject *o) {
+  if (!PyDict_Check(o))
+    Fail(PyExc_TypeError, "from_columns() needs a dictionary of sequences");
+
+  int k = PyDict_Size(o);
+  c4_Bytes buf;
+  int *cols = (int*)buf.SetBufferClear(k *(sizeof(int) + sizeof(PyObject*)));
+  PyObject **seqs = (PyObject **)(cols + k);
+
+  try {
+    int rows = 0;
+    Py_ssize_t pos = 0;
+    PyObject *key,  *value;
+    for (int i = 0; PyDict_Next(o, &pos, &key, &value); ++i) {
+      PWOString name(key);
+      cols[i] = FindPropIndexByName(name);
+      if (cols[i] < 0)
+        Fail(PyExc_KeyError, name);
+      seqs[i] = PySequence_Fast(value, "from_columns() needs sequences");
+      if (seqs[i] == 0)
+        throw PWDPyException;
+      int n = PySequence_Fast_GET_SIZE(seqs[i]);
+      if (i > 0 && n != rows)
+        Fail(PyExc_ValueError, "from_columns() needs sequences of equal length")
+          ;
+      rows = n;
+    }
+
+    PyBulkViewer *bulk = new PyBulkViewer(Clone(), rows);
+    c4_View batch(bulk);
+
+    for (int r = 0; r < rows; ++r) {
+      try {
+        for (int j = 0; j < k; ++j)
+          bulk->SetValue(cols[j], PySequence_Fast_GET_ITEM(seqs[j], r));
+      } catch (...) {
+        bulk->UndoRow();
+        InsertBatch(*this, batch,  *bulk);
+        throw;
+      }
+      bulk->NextRow();
+      if (bulk->IsFull())
+        InsertBatch(*this, batch,  *bulk);
+    }
+    InsertBatch(*this, batch,  *bulk);
+  } catch (...) {
+    for (int j = 0; j < k; ++j)
+      Py_XDECREF(seqs[j]);
+    throw;
+  }
+
+  for (int j = 0; j < k; ++j)
+    Py_DECREF(seqs[j]);
+}
+
 PyObject *PyView::structure() {
   int n = NumProperties();
   //  PyObject* list=PyList_New(n);
@@ -1600,6 +2505,21 @@ PyView *PyView::filter(const PWOCallable &func) {
   return new PyView(indices, this);
 }
 
+PyView *PyView::filter(const c4_Expr &expr) {
+  c4_View indices(_index);
+  {
+    PyAllowThreads nogil;
+    c4_View rows = Select(expr);
+    indices.SetSize(rows.GetSize());
+    c4_Row ndx;
+    for (int i = 0; i < rows.GetSize(); ++i) {
+      _index(ndx) = GetIndexOf(rows[i]);
+      indices.SetAt(i, ndx);
+    }
+  }
+  return new PyView(indices, this);
+}
+
 PyObject *PyView::reduce(const PWOCallable &func, PWONumber &start) {
   PWONumber accum = start;
   PWOTuple tmp(2);
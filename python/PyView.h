@@ -44,6 +44,8 @@ class PyView: public PyHead, public c4_View {
     PyView(const c4_View &o, PyObject *owner, PyView *base = 0, int state = BASE);
     ~PyView();
     void insertAt(int i, PyObject *o);
+    void extend(PyObject *o);
+    void fromColumns(PyObject *o);
     PyRowRef *getItem(int i);
     PyView *getSlice(int s, int e);
     int setItemRow(int i, const c4_RowRef &v) {
@@ -60,9 +62,14 @@ class PyView: public PyHead, public c4_View {
     PyObject *structure();
     void makeRow(c4_Row &temp, PyObject *o, bool useDefaults = true);
     void makeRowFromDict(c4_Row &temp, PyObject *o, bool useDefaults = true);
+    c4_Expr makeExpr(PyObject *o);
+    const c4_Property &exprProp(PyObject *o);
+    PyObject *column(const c4_Property &prop);
+    PyObject *iterrows(PyObject *props, int batch);
     void map(const PWOCallable &func);
     void map(const PWOCallable &func, const PyView &subset);
     PyView *filter(const PWOCallable &func);
+    PyView *filter(const c4_Expr &expr);
     PyObject *reduce(const PWOCallable &func, PWONumber &start);
     void remove(const PyView &indices);
     PyView *indices(const PyView &subset);
@@ -11,6 +11,13 @@ mkobjs = ['column', 'custom', 'derived', 'fileio', 'field',
           'format', 'handler', 'persist', 'remap', 'std',
           'store', 'string', 'table', 'univ', 'view', 'viewx']
 
+# pass --threads if the core library was configured with --enable-threads,
+# Mk4py must then be compiled with q4_MULTI as well
+mkdefines = []
+if '--threads' in sys.argv:
+    sys.argv.remove('--threads')
+    mkdefines.append(('q4_MULTI', '1'))
+
 class config_mk(config):
     
     def run(self):
@@ -180,7 +187,10 @@ setup(name             = "metakit",
       cmdclass         = {'build': build_mk, 'build_ext': build_mkext,
                           'test': test_regrtest, 'config': config_mk},
       ext_modules      = [Extension("Mk4py",
-                                    sources=["PyProperty.cpp",
+                                    sources=["PyColumn.cpp",
+                                             "PyExpr.cpp",
+                                             "PyProperty.cpp",
+                                             "PyRowIter.cpp",
                                              "PyRowRef.cpp",
                                              "PyStorage.cpp",
                                              "PyView.cpp",
@@ -189,6 +199,7 @@ setup(name             = "metakit",
                                     include_dirs=["scxx",
                                                   "../include"],
                                     extra_objects=mkobjs,
+                                    define_macros=mkdefines,
                                     )]
       )
 
@@ -332,9 +332,63 @@ class ViewerTestCase(unittest.TestCase):
         for row in t:
             self.assertNotEqual(self.v0[row.index], 'b')
 
+    def testWhere(self):
+        #where, with expressions built from properties
+        s, i = self.v0.s, self.v0.i
+        t = self.v0.where(i > 1)
+        self.assertEqual([r.s for r in t], ['b', 'c'])
+        t = self.v0.where(i > 1, s.startswith('c'))
+        self.assertEqual([r.s for r in t], ['c'])
+        t = self.v0.where(s.startswith('C') | s.contains('A'))
+        self.assertEqual([r.s for r in t], ['a', 'c'])
+        self.assertEqual([r.s for r in self.v0.where(s.glob('B*'))], ['b'])
+        t = self.v0.where((i == 1) | ~(s <= 'b'))
+        self.assertEqual([r.s for r in t], ['a', 'c'])
+        t = self.v0.where(s.isin(['c', 'a', 'x']) & i.between(2, 3))
+        self.assertEqual([r.s for r in t], ['c'])
+        t = self.v0.filter(s != 'b')
+        self.assertEqual([r.index for r in t], [0, 2])
+        self.assertRaises(TypeError, bool, i > 1)
+        self.assertEqual(i == i, True)
+        self.assertEqual(i != s, True)
+        self.assertEqual(bool(i == 1), False)
+
     def testReduce(self):            
         #reduce
         self.assertEqual(self.v0.reduce(lambda row, last: last+row.i), 6)
+
+    def testColumn(self):
+        #column
+        import array, struct
+        c = self.v0.column('i')
+        self.assertEqual(len(c), 3)
+        self.assertEqual(c.format, 'i')
+        self.assertEqual(array.array('i', str(buffer(c))).tolist(), [1,2,3])
+        c = self.v1.column(self.v1.f)
+        self.assertEqual(c.itemsize, 8)
+        self.assertEqual(array.array(c.format, str(buffer(c))).tolist(),
+                         [v.f for v in self.v1])
+        offsets, data = self.v0.column('s')
+        self.assertEqual(len(offsets), 4)
+        self.assertEqual(data, 'abc')
+        offsets, data = self.v2.column('b')
+        self.assertEqual(offsets.format, 'q')
+        self.assertEqual(struct.unpack('%d%s' % (len(offsets), offsets.format),
+                                       str(buffer(offsets))), (0, 1, 2, 3))
+        self.assertEqual(data, '\2\3\4')
+        self.assertRaises(KeyError, self.v0.column, 'f')
+        self.assertRaises(TypeError, self.p0.groupby(self.p0.t, 'x').column, 'x')
+
+    def testIterrows(self):
+        #iterrows
+        self.assertEqual(list(self.v0.iterrows()), [('a',1),('b',2),('c',3)])
+        self.assertEqual(list(self.v1.iterrows([self.v1.f, 's'])),
+                         [(v.f, v.s) for v in self.v1])
+        self.assertEqual(list(self.v2.iterrows(props=['b'], batch=2)),
+                         [[('\2',),('\3',)], [('\4',)]])
+        t = [x for x in self.g0.iterrows(['t', 'details'])]
+        self.assertEqual([len(d) for s, d in t], [3, 3, 3])
+        self.assertRaises(KeyError, self.v0.iterrows, ['f'])
         
 class ViewTestCase(ViewerTestCase):
     def setUp(self):
@@ -458,6 +512,45 @@ class ViewTestCase(ViewerTestCase):
         
         #access
         #modify
+
+    def testExtend(self):
+        #extend
+        x = self.v0.copy()
+        x.extend([['hi', 2], ('ho', 3), {'S': 'hu', 'i': 4},
+                  Dummy(s='ha', i=5), 'h', []])
+        self.assertEqual([(r.s, r.i) for r in x][3:],
+                         [('hi', 2), ('ho', 3), ('hu', 4), ('ha', 5),
+                          ('h', 0), ('', 0)])
+        x.extend(iter([(str(n), n) for n in range(20000)]))
+        self.assertEqual(len(x), 20009)
+        self.assertEqual(x[-1].s, '19999')
+        self.assertEqual(x[-1].i, 19999)
+        self.assertEqual(x[9].i, 0)
+        x.extend(self.v0)
+        self.assertEqual(x[-1].s, 'c')
+        # the rows before a failing one are still added
+        n = len(x)
+        self.assertRaises(TypeError, x.extend, [('a', 1), ('b', 'c')])
+        self.assertEqual(len(x), n + 1)
+        self.assertRaises(IndexError, x.extend, [('a', 1, 2)])
+        self.assertRaises(ValueError, x.extend, [('a\0b', 1)])
+        self.assertRaises(TypeError, x.extend, 1)
+        self.assertEqual(len(x), n + 1)
+
+        y = self.v2.copy()
+        y.extend([(5, '\0\5'), (6, None)])
+        self.assertEqual([(r.i, r.b) for r in y][3:], [(5, '\0\5'), (6, '')])
+
+        #from_columns
+        x = self.v0.copy()
+        x.from_columns({'s': ['d', 'e'], 'I': (4, 5.0)})
+        self.assertEqual([(r.s, r.i) for r in x][3:], [('d', 4), ('e', 5)])
+        x.from_columns({'i': range(3)})
+        self.assertEqual([(r.s, r.i) for r in x][5:], [('', 0), ('', 1), ('', 2)])
+        self.assertRaises(KeyError, x.from_columns, {'f': [1]})
+        self.assertRaises(ValueError, x.from_columns, {'s': ['a'], 'i': []})
+        self.assertRaises(TypeError, x.from_columns, [('s', ['a'])])
+        self.assertEqual(len(x), 8)
         
    
 class RORowRefTestCase(unittest.TestCase):
@@ -3,7 +3,7 @@
 // This is part of Metakit, the homepage is http://www.equi4.com/metakit.html
 
 /** @file
- * Implements c4_Column, c4_ColOfInts, and c4_ColIter
+ * Implements c4_Column, c4_ColOfInts, c4_ColOfPacked, and c4_ColIter
  */
 
 #include "header.h"
@@ -39,7 +39,7 @@ void f4_memmove(void *to_, const void *from_, int n_) {
 // c4_Column
 
 c4_Column::c4_Column(c4_Persist *persist_): _position(0), _size(0), _persist
-  (persist_), _gap(0), _slack(0), _dirty(false){}
+  (persist_), _gap(0), _slack(0), _dirty(false), _cached(false){}
 
 #if q4_CHECK
 
@@ -61,11 +61,11 @@ void c4_Column::Validate()const {
   if (fSegRest(_size + _slack) == 0)
     d4_assert(p == 0);
   else
-    d4_assert(p != 0);
+    d4_assert(p != 0 || _cached);
 
   while (--n >= 0) {
     t4_byte *p = (t4_byte*)_segments.GetAt(n);
-    d4_assert(p != 0);
+    d4_assert(p != 0 || _cached);
   }
 }
 
@@ -113,6 +113,39 @@ bool c4_Column::RequiresMap()const {
   return false;
 }
 
+void c4_Column::Advise(int how_) {
+  // only unchanged data on file can be advised, and only if it's not tiny
+  if (_position > 1 && !_dirty && _size >= 4 * kSegMax && _persist != 0)
+    Strategy().DataAdvise(_position, _size, how_);
+}
+
+/*
+ *  Data can only be used in place if the map stays put.  A file opened
+ *  read-only is never committed, so its map is only released when the
+ *  storage goes away.  A column which is changed gets its own copy of the
+ *  segments, it is then no longer all in the map.
+ */
+
+const t4_byte *c4_Column::MappedData() {
+  if (_dirty || _size == 0 || _persist == 0 || !_persist->IsReadOnly())
+    return 0;
+
+  if (_segments.GetSize() == 0)
+    SetupSegments();
+
+  if (!IsMapped())
+    return 0;
+
+  const t4_byte *map = Strategy()._mapStart + _position;
+  for (int i = 0; i < _segments.GetSize(); ++i) {
+    const t4_byte *p = (const t4_byte*)_segments.GetAt(i);
+    if (p != 0 && p != map + fSegOffset(i))
+      return 0;
+  }
+
+  return map;
+}
+
 void c4_Column::ReleaseSegment(int index_) {
   t4_byte *p = (t4_byte*)_segments.GetAt(index_);
   if (!UsesMap(p))
@@ -120,6 +153,12 @@ void c4_Column::ReleaseSegment(int index_) {
 }
 
 void c4_Column::ReleaseAllSegments() {
+  if (_cached) {
+    c4_ColCache::Forget(*this);
+    _cached = false;
+    _slots.SetSize(0);
+  }
+
   //for (int i = 0; i < _segments.GetSize(); ++i)
   for (int i = _segments.GetSize(); --i >= 0;)
     ReleaseSegment(i);
@@ -230,23 +269,25 @@ void c4_Column::SetupSegments() {
       _segments.SetAt(i, (t4_byte*)map); // loses const
       map += kSegMax;
     }
+  } else if (_position > 1 && id < 0 && c4_ColCache::IsEnabled()) {
+    // leave all segments empty, they get loaded when first accessed
+    _cached = true;
+    _slots.SetSize(n);
   } else {
-    int chunk = kSegMax;
-    t4_i32 pos = _position;
+    c4_DWordArray lens;
+    lens.SetSize(n);
 
-    // allocate buffers, load them if necessary
+    // allocate buffers, then load them all in one go if necessary
     for (int i = 0; i < n; ++i) {
-      if (i == last)
-        chunk = fSegRest(_size);
-
-      t4_byte *p = d4_new t4_byte[chunk];
-      _segments.SetAt(i, p);
+      int chunk = i == last ? fSegRest(_size): kSegMax;
+      lens.SetAt(i, chunk);
+      _segments.SetAt(i, d4_new t4_byte[chunk]);
+    }
 
-      if (_position > 0) {
-        d4_dbgdef(int n = )Strategy().DataRead(pos, p, chunk);
-        d4_assert(n == chunk);
-        pos += chunk;
-      }
+    if (_position > 0 && n > 0) {
+      d4_dbgdef(int k = )Strategy().DataReadv(_position, &_segments.ElementAt
+        (0), &lens.ElementAt(0), n);
+      d4_assert(k == _size);
     }
   }
 
@@ -258,6 +299,55 @@ void c4_Column::SetupSegments() {
   Validate();
 }
 
+t4_byte *c4_Column::LoadSegment(int index_) {
+  d4_assert(_gap == 0 && _slack == 0);
+
+  t4_i32 offset = fSegOffset(index_);
+  if (offset >= _size)
+    return 0;
+  // the last entry is a null pointer when there is no partial segment
+
+  int chunk = _size - offset < kSegMax ? (int)(_size - offset): kSegMax;
+
+  t4_byte *p = d4_new t4_byte[chunk];
+  _segments.SetAt(index_, p);
+
+  d4_dbgdef(int n = )Strategy().DataRead(_position + offset, p, chunk);
+  d4_assert(n == chunk);
+
+  return p;
+}
+
+t4_byte *c4_Column::CachedSegment(int index_) {
+  t4_byte *p = (t4_byte*)_segments.GetAt(index_);
+
+  if (p != 0)
+    c4_ColCache::Touch((int)_slots.GetAt(index_));
+  else {
+    p = LoadSegment(index_);
+    if (p != 0)
+      _slots.SetAt(index_, c4_ColCache::Add(*this, index_));
+  }
+
+  return p;
+}
+
+//@func Loads all segments and keeps them, prior to making changes.
+void c4_Column::Uncache() {
+  d4_assert(_cached);
+
+  c4_ColCache::Forget(*this);
+  _cached = false;
+
+  for (int i = 0; i < _segments.GetSize(); ++i)
+    if (_segments.GetAt(i) == 0)
+      LoadSegment(i);
+
+  _slots.SetSize(0);
+
+  Validate();
+}
+
 //@func Makes sure the requested data is in a modifiable buffer.
 t4_byte *c4_Column::CopyNow(t4_i32 offset_) {
   d4_assert(offset_ <= _size);
@@ -265,6 +355,11 @@ t4_byte *c4_Column::CopyNow(t4_i32 offset_) {
   _dirty = true;
 
   const t4_byte *ptr = LoadNow(offset_);
+  if (_cached) {
+    Uncache();
+    ptr = LoadNow(offset_);
+  }
+
   if (UsesMap(ptr)) {
     if (offset_ >= _gap)
       offset_ += _slack;
@@ -518,6 +613,8 @@ void c4_Column::Grow(t4_i32 off_, t4_i32 diff_) {
 
   if (_segments.GetSize() == 0)
     SetupSegments();
+  if (_cached)
+    Uncache();
 
   Validate();
 
@@ -574,6 +671,8 @@ void c4_Column::Shrink(t4_i32 off_, t4_i32 diff_) {
 
   if (_segments.GetSize() == 0)
     SetupSegments();
+  if (_cached)
+    Uncache();
 
   Validate();
 
@@ -696,14 +795,32 @@ void c4_Column::SaveNow(c4_Strategy &strategy_, t4_i32 pos_) {
   if (_segments.GetSize() == 0)
     SetupSegments();
 
-  // write all segments
+  // write all segments, a batch at a time - not all at once, because the
+  // segment cache may drop segments which have not been used recently
+  c4_PtrArray bufs;
+  c4_DWordArray lens;
+  t4_i32 n = 0;
+
   c4_ColIter iter(*this, 0, _size);
-  while (iter.Next(kSegMax)) {
-    int n = iter.BufLen();
-    strategy_.DataWrite(pos_, iter.BufLoad(), n);
-    if (strategy_._failure != 0)
-      break;
-    pos_ += n;
+  for (bool more = iter.Next(kSegMax); more || bufs.GetSize() > 0;) {
+    if (more) {
+      bufs.Add((void*)iter.BufLoad()); // loses const
+      lens.Add(iter.BufLen());
+      n += iter.BufLen();
+      more = iter.Next(kSegMax);
+    }
+
+    if (!more || bufs.GetSize() >= kSaveBatch) {
+      strategy_.DataWritev(pos_, &bufs.ElementAt(0), &lens.ElementAt(0),
+        bufs.GetSize());
+      if (strategy_._failure != 0)
+        break;
+
+      pos_ += n;
+      n = 0;
+      bufs.SetSize(0);
+      lens.SetSize(0);
+    }
   }
 }
 
@@ -716,8 +833,9 @@ const t4_byte *c4_Column::FetchBytes(t4_i32 pos_, int len_, c4_Bytes &buffer_,
   c4_ColIter iter(*this, pos_, pos_ + len_);
   iter.Next();
 
-  // most common case, all bytes are inside the same segment
-  if (!forceCopy_ && iter.BufLen() == len_)
+  // most common case, all bytes are inside the same segment, but segments
+  // of a cached column may get evicted while the caller still uses them
+  if (!forceCopy_ && !_cached && iter.BufLen() == len_)
     return iter.BufLoad();
 
   t4_byte *p = buffer_.SetBuffer(len_);
@@ -813,6 +931,154 @@ void c4_Column::RemoveData(t4_i32 index_, t4_i32 count_) {
     Shrink(index_, count_);
 }
 
+/////////////////////////////////////////////////////////////////////////////
+// c4_ColCache
+
+/*
+ *  Without a memory map, each column used to read all of its segments on
+ *  first access and keep them until it was released, so scanning a large
+ *  file ended up with the entire file on the heap.  When a limit is set,
+ *  columns which have not been changed load their segments one at a time
+ *  instead, and register them here.  Once the limit is reached, the clock
+ *  algorithm picks a segment which has not been used recently, which is
+ *  then deleted and will be read in again when needed.
+ *
+ *  No pointer into a cached segment is handed out by FetchBytes, it always
+ *  copies the bytes into the caller's buffer instead.  Other code can
+ *  still hold on to a pointer into one segment while loading some others,
+ *  such as when it iterates over several, so the last kPinned segments
+ *  used are never evicted.  A column which gets changed loads all its
+ *  remaining segments and leaves the cache.
+ *
+ *  This is a single shared cache, with no locking, so it is not used in
+ *  builds which support multi-threading.
+ */
+
+struct c4_ColSlot {
+  c4_Column *_column; // zero if this slot is free
+  int _index;
+  t4_i64 _stamp;
+  bool _used; // set on each access, cleared as the clock hand passes
+};
+
+static c4_ColSlot *sColSlots = 0;
+static int sColCount = 0; // number of slots
+static int sColUsed = 0; // number of slots in use
+static int sColHand = 0;
+static t4_i64 sColTick = 0;
+static t4_i64 sColHits = 0;
+static t4_i64 sColMisses = 0;
+static t4_i64 sColEvictions = 0;
+
+void c4_ColCache::SetLimit(t4_i32 bytes_) {
+  for (int i = 0; i < sColCount; ++i)
+    if (sColSlots[i]._column != 0)
+      Evict(i);
+
+  delete [] sColSlots;
+  sColSlots = 0;
+  sColCount = sColUsed = sColHand = 0;
+  sColHits = sColMisses = sColEvictions = 0;
+
+#if !q4_MULTI
+  if (bytes_ > 0) {
+    sColCount = (int)(bytes_ / c4_Column::kSegMax);
+    if (sColCount < 2 *kPinned)
+      sColCount = 2 * kPinned;
+
+    sColSlots = d4_new c4_ColSlot[sColCount];
+    memset(sColSlots, 0, sColCount *sizeof(c4_ColSlot));
+  }
+#endif 
+}
+
+bool c4_ColCache::IsEnabled() {
+  return sColCount > 0;
+}
+
+t4_i32 c4_ColCache::Stats(t4_i64 *hits_, t4_i64 *misses_, t4_i64 *evictions_)
+  {
+  if (hits_)
+    *hits_ = sColHits;
+  if (misses_)
+    *misses_ = sColMisses;
+  if (evictions_)
+    *evictions_ = sColEvictions;
+
+  // all segments are full-size, except perhaps the last one of a column
+  return sColUsed *(t4_i32)c4_Column::kSegMax;
+}
+
+int c4_ColCache::Add(c4_Column &col_, int index_) {
+  ++sColMisses;
+
+  if (sColCount == 0)
+    return  - 1;
+  // caching was turned off after this column was set up
+
+  // at most kPinned slots are skipped, so this ends within two rounds
+  for (;;) {
+    int i = sColHand;
+    if (++sColHand >= sColCount)
+      sColHand = 0;
+
+    c4_ColSlot &slot = sColSlots[i];
+
+    if (slot._column != 0) {
+      if (sColTick - slot._stamp < kPinned)
+        continue;
+
+      if (slot._used) {
+        slot._used = false;
+        continue;
+      }
+
+      Evict(i);
+    }
+
+    slot._column = &col_;
+    slot._index = index_;
+    slot._stamp = ++sColTick;
+    slot._used = true;
+    ++sColUsed;
+
+    return i;
+  }
+}
+
+void c4_ColCache::Touch(int slot_) {
+  ++sColHits;
+
+  if (slot_ >= 0) {
+    c4_ColSlot &slot = sColSlots[slot_];
+    slot._stamp = ++sColTick;
+    slot._used = true;
+  }
+}
+
+void c4_ColCache::Forget(c4_Column &col_) {
+  for (int i = 0; i < col_._slots.GetSize(); ++i)
+    if (col_._segments.GetAt(i) != 0) {
+      int j = (int)col_._slots.GetAt(i);
+      if (j >= 0 && j < sColCount && sColSlots[j]._column == &col_) {
+        sColSlots[j]._column = 0;
+        --sColUsed;
+      }
+    }
+}
+
+void c4_ColCache::Evict(int slot_) {
+  c4_ColSlot &slot = sColSlots[slot_];
+  c4_Column &col = *slot._column;
+
+  delete [](t4_byte*)col._segments.GetAt(slot._index);
+  col._segments.SetAt(slot._index, 0);
+
+  slot._column = 0;
+  --sColUsed;
+  ++sColEvictions;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 void c4_ColOfInts::Get_0b(int) {
@@ -1165,6 +1431,11 @@ void c4_ColOfInts::FlipBytes() {
   }
 }
 
+bool c4_ColOfInts::IsNative(int width_)const {
+  return _currWidth == 8 * width_ && !_mustFlip && (Persist() == 0 ||
+    !Strategy()._bytesFlipped);
+}
+
 void c4_ColOfInts::SetAccessWidth(int bits_) {
   d4_assert((bits_ &(bits_ - 1)) == 0);
 
@@ -1298,6 +1569,38 @@ void c4_ColOfInts::Set(int index_, const c4_Bytes &buf_) {
   }
 }
 
+void c4_ColOfInts::SetInts(int index_, const t4_i32 *values_, int count_) {
+  d4_assert(_dataWidth == sizeof(t4_i32));
+
+  int w = _currWidth >> 3;
+  if ((w == 1 || w == 2 || w == 4) && IsNative(w)) {
+    if (w == 4) {
+      StoreBytes(index_ *w, c4_Bytes(values_, count_ *w));
+      return ;
+    }
+
+    c4_Bytes temp;
+    t4_byte *p = temp.SetBuffer(count_ *w);
+
+    int i = 0;
+    if (w == 2)
+      for (; i < count_ && values_[i] == (short)values_[i]; ++i)
+        ((short*)p)[i] = (short)values_[i];
+    else
+      for (; i < count_ && values_[i] == (signed char)values_[i]; ++i)
+        p[i] = (t4_byte)values_[i];
+
+    if (i == count_) {
+      StoreBytes(index_ *w, temp);
+      return ;
+    }
+  }
+
+  // sub-byte or flipped entries, or some value is wider than the rest
+  for (int j = 0; j < count_; ++j)
+    Set(index_ + j, c4_Bytes(values_ + j, sizeof(t4_i32)));
+}
+
 t4_i32 c4_ColOfInts::GetInt(int index_) {
   int n;
   const void *p = Get(index_, n);
@@ -1447,6 +1750,535 @@ void c4_ColOfInts::FixSize(bool fudge_) {
 
 /////////////////////////////////////////////////////////////////////////////
 
+/*
+A packed int column holds the same values as a c4_ColOfInts, but stored
+in blocks of kBlockSize entries, each encoded in whichever way is smallest:
+
+  kFOR      frame of reference: a base value plus small unsigned offsets
+  kDelta    first value, then offsets of the differences between entries
+  kDelta2   first value and difference, then the changes in difference
+  kRuns     run-length: offsets of the distinct values, and run lengths
+  kXor      float bits: each value xor-ed with the previous one, storing
+            only the meaningful bits in between leading and trailing zeros
+
+Float and double columns only use kXor and kRuns, since the differences
+between bit patterns of floating point values say little about them.
+
+Offsets are packed at 0, 1, 2, 4, 8, 16, 32, or 64 bits per entry, just as
+in c4_ColOfInts, so that decoding a block is a tight loop per width.  All
+multi-byte values are stored little-endian, which makes the encoding byte
+order independent (there is no need to flip these columns).
+
+Layout: a 6-byte header (version, block bits, row count), then a directory
+with the start offset of each block plus the end offset, then the blocks.
+The directory lets each block be decoded on its own, touching only its own
+bytes in the column - random access works per block.
+ */
+
+typedef uint64_t t4_u64; // all packing arithmetic is done modulo 2^64
+
+enum {
+  kPackVersion = 1, kHeadSize = 6, kFOR = 0, kDelta, kDelta2, kRuns, kXor
+};
+
+static t4_u64 fGetLE(const t4_byte *p_, int n_) {
+  t4_u64 v = 0;
+  while (--n_ >= 0)
+    v = (v << 8) | p_[n_];
+  return v;
+}
+
+static void fPutLE(t4_byte *p_, t4_u64 v_, int n_) {
+  for (int i = 0; i < n_; ++i) {
+    p_[i] = (t4_byte)v_;
+    v_ >>= 8;
+  }
+}
+
+static int fPackWidth(t4_u64 range_) {
+  int w = 0;
+  while (w < 64 && (range_ >> w) != 0)
+    w = w ? w << 1 : 1;
+  return w;
+}
+
+static int fSizeFOR(const t4_i64 *v_, int n_, t4_i64 &base_, int &width_) {
+  t4_i64 lo = n_ > 0 ? v_[0] : 0;
+  t4_i64 hi = lo;
+
+  for (int i = 1; i < n_; ++i)
+    if (v_[i] < lo)
+      lo = v_[i];
+    else if (v_[i] > hi)
+      hi = v_[i];
+
+  base_ = lo;
+  width_ = fPackWidth((t4_u64)hi - (t4_u64)lo);
+
+  return 9+(int)(((t4_i64)n_ *width_ + 7) >> 3);
+}
+
+static t4_byte *fPackFOR(t4_byte *p_, const t4_i64 *v_, int n_) {
+  t4_i64 base;
+  int width;
+  int size = fSizeFOR(v_, n_, base, width);
+
+  fPutLE(p_, (t4_u64)base, 8);
+  p_[8] = (t4_byte)width;
+  p_ += 9;
+
+  memset(p_, 0, size - 9);
+
+  // all values are equal, there is no payload to fill in
+  if (width == 0)
+    return p_;
+
+  for (int i = 0; i < n_; ++i) {
+    t4_u64 d = (t4_u64)v_[i] - (t4_u64)base;
+    if (width < 8)
+      p_[(i *width) >> 3] |= (t4_byte)(d << ((i *width) &7));
+    else
+      fPutLE(p_ + i *(width >> 3), d, width >> 3);
+  }
+
+  return p_ + size - 9;
+}
+
+// the per-width loops are kept trivial so that compilers can vectorize them
+static const t4_byte *fUnpackFOR(const t4_byte *p_, int n_, t4_i64 *out_) {
+  const t4_u64 base = fGetLE(p_, 8);
+  const int width = p_[8];
+  p_ += 9;
+
+  int i;
+  switch (width) {
+    case 0:
+      for (i = 0; i < n_; ++i)
+        out_[i] = (t4_i64)base;
+      break;
+    case 1:
+    case 2:
+    case 4:
+       {
+        const int mask = (1 << width) - 1;
+        for (i = 0; i < n_; ++i)
+          out_[i] = (t4_i64)(base + ((p_[(i *width) >> 3] >> ((i *width) &7))
+            &mask));
+      }
+      break;
+    case 8:
+      for (i = 0; i < n_; ++i)
+        out_[i] = (t4_i64)(base + p_[i]);
+      break;
+    case 16:
+      for (i = 0; i < n_; ++i)
+        out_[i] = (t4_i64)(base + (p_[2 *i] | (p_[2 *i + 1] << 8)));
+      break;
+    case 32:
+      for (i = 0; i < n_; ++i)
+        out_[i] = (t4_i64)(base + (p_[4 *i] | (p_[4 *i + 1] << 8) | (p_[4 *i +
+          2] << 16) | ((t4_u64)p_[4 *i + 3] << 24)));
+      break;
+    default:
+      d4_assert(width == 64);
+      for (i = 0; i < n_; ++i)
+        out_[i] = (t4_i64)(base + fGetLE(p_ + 8 * i, 8));
+  }
+
+  return p_ + (((t4_i64)n_ *width + 7) >> 3);
+}
+
+static int fLeadingZeros(t4_u64 v_) {
+  int n = 0;
+  for (int w = 32; w > 0; w >>= 1)
+    if ((v_ >> (64-w)) == 0) {
+      n += w;
+      v_ <<= w;
+    }
+  return n;
+}
+
+static int fTrailingZeros(t4_u64 v_) {
+  int n = 0;
+  for (int w = 32; w > 0; w >>= 1)
+    if ((v_ << (64-w)) == 0) {
+      n += w;
+      v_ >>= w;
+    }
+  return n;
+}
+
+// bit streams are filled from the low bit of each byte up, p_ must be zeroed
+static void fPutBits(t4_byte *p_, t4_i32 &pos_, t4_u64 v_, int n_) {
+  if (p_ != 0)
+    while (n_ > 0) {
+      int k = 8-(pos_ &7);
+      p_[pos_ >> 3] |= (t4_byte)(v_ << (pos_ &7));
+      if (k >= n_) {
+        pos_ += n_;
+        return ;
+      }
+      v_ >>= k;
+      pos_ += k;
+      n_ -= k;
+    }
+  pos_ += n_;
+}
+
+static t4_u64 fGetBits(const t4_byte *p_, t4_i32 &pos_, int n_) {
+  t4_u64 v = 0;
+  for (int shift = 0; shift < n_;) {
+    int k = 8-(pos_ &7);
+    if (k > n_ - shift)
+      k = n_ - shift;
+    t4_u64 bits = (p_[pos_ >> 3] >> (pos_ &7)) &((1 << k) - 1);
+    v |= bits << shift;
+    shift += k;
+    pos_ += k;
+  }
+  return v;
+}
+
+/*
+The xor encoding follows Pelkonen et al, "Gorilla: A Fast, Scalable,
+In-Memory Time Series Database" (2015).  The first value is stored in full.
+Each next value is xor-ed with its predecessor, then a 0 bit means "same".
+Else "10" re-uses the previous window of meaningful bits, while "11" is
+followed by 6 bits leading zero count, 6 bits length - 1, and those bits.
+ */
+
+static int fXorBlock(const t4_i64 *v_, int n_, t4_byte *out_) {
+  if (out_ != 0)
+    fPutLE(out_, (t4_u64)v_[0], 8);
+
+  t4_byte *bits = out_ != 0 ? out_ + 8 : 0;
+  t4_i32 pos = 0;
+  int lead =  - 1, len = 0;
+
+  for (int i = 1; i < n_; ++i) {
+    t4_u64 x = (t4_u64)v_[i] ^ (t4_u64)v_[i - 1];
+    if (x == 0) {
+      fPutBits(bits, pos, 0, 1);
+      continue;
+    }
+
+    int l = fLeadingZeros(x);
+    int t = fTrailingZeros(x);
+
+    if (lead >= 0 && l >= lead && t >= 64-lead - len) {
+      fPutBits(bits, pos, 1, 2);
+      fPutBits(bits, pos, x >> (64-lead - len), len);
+    } else {
+      lead = l;
+      len = 64-l - t;
+      fPutBits(bits, pos, 3, 2);
+      fPutBits(bits, pos, lead, 6);
+      fPutBits(bits, pos, len - 1, 6);
+      fPutBits(bits, pos, x >> t, len);
+    }
+  }
+
+  return 8+((pos + 7) >> 3);
+}
+
+static void fUnxorBlock(const t4_byte *p_, int n_, t4_i64 *out_) {
+  t4_u64 v = fGetLE(p_, 8);
+  out_[0] = (t4_i64)v;
+
+  const t4_byte *bits = p_ + 8;
+  t4_i32 pos = 0;
+  int lead = 0, len = 0;
+
+  for (int i = 1; i < n_; ++i) {
+    if (fGetBits(bits, pos, 1) != 0) {
+      if (fGetBits(bits, pos, 1) != 0) {
+        lead = (int)fGetBits(bits, pos, 6);
+        len = (int)fGetBits(bits, pos, 6) + 1;
+      }
+      v ^= fGetBits(bits, pos, len) << (64-lead - len);
+    }
+    out_[i] = (t4_i64)v;
+  }
+}
+
+// returns the encoded size of a block, and stores it if out_ is not null
+static int fPackBlock(const t4_i64 *v_, int n_, t4_i64 *work_, t4_byte *out_,
+  bool floats_) {
+  t4_i64 base;
+  int width;
+
+  int kind = floats_ ? kXor : kFOR;
+  int best = 1+(floats_ ? fXorBlock(v_, n_, 0): fSizeFOR(v_, n_, base, width));
+
+  t4_i64 *delta = work_;
+  t4_i64 *delta2 = work_ + c4_ColOfPacked::kBlockSize;
+  t4_i64 *values = delta2 + c4_ColOfPacked::kBlockSize;
+  t4_i64 *counts = values + c4_ColOfPacked::kBlockSize;
+
+  int i;
+  for (i = 1; i < n_; ++i)
+    delta[i - 1] = (t4_i64)((t4_u64)v_[i] - (t4_u64)v_[i - 1]);
+  for (i = 1; i < n_ - 1; ++i)
+    delta2[i - 1] = (t4_i64)((t4_u64)delta[i] - (t4_u64)delta[i - 1]);
+
+  int runs = 0;
+  for (i = 0; i < n_; ++i)
+  if (runs > 0 && values[runs - 1] == v_[i])
+    ++counts[runs - 1];
+  else {
+    values[runs] = v_[i];
+    counts[runs++] = 0; // stored as length - 1
+  }
+
+  if (n_ >= 2 && !floats_) {
+    int n = 1+8+fSizeFOR(delta, n_ - 1, base, width);
+    if (n < best) {
+      kind = kDelta;
+      best = n;
+    }
+  }
+
+  if (n_ >= 3 && !floats_) {
+    int n = 1+16+fSizeFOR(delta2, n_ - 2, base, width);
+    if (n < best) {
+      kind = kDelta2;
+      best = n;
+    }
+  }
+
+  int n = 1+2+fSizeFOR(values, runs, base, width) + fSizeFOR(counts, runs,
+    base, width);
+  if (n < best) {
+    kind = kRuns;
+    best = n;
+  }
+
+  if (out_ != 0) {
+    *out_++ = (t4_byte)kind;
+
+    switch (kind) {
+      case kFOR:
+        out_ = fPackFOR(out_, v_, n_);
+        break;
+      case kDelta:
+        fPutLE(out_, (t4_u64)v_[0], 8);
+        out_ = fPackFOR(out_ + 8, delta, n_ - 1);
+        break;
+      case kDelta2:
+        fPutLE(out_, (t4_u64)v_[0], 8);
+        fPutLE(out_ + 8, (t4_u64)delta[0], 8);
+        out_ = fPackFOR(out_ + 16, delta2, n_ - 2);
+        break;
+      case kRuns:
+        fPutLE(out_, runs, 2);
+        out_ = fPackFOR(out_ + 2, values, runs);
+        out_ = fPackFOR(out_, counts, runs);
+        break;
+      case kXor:
+        fXorBlock(v_, n_, out_);
+    }
+  }
+
+  return best;
+}
+
+static void fUnpackBlock(const t4_byte *p_, int n_, t4_i64 *out_) {
+  int i;
+
+  switch (*p_++) {
+    case kFOR:
+      fUnpackFOR(p_, n_, out_);
+      break;
+    case kDelta:
+      out_[0] = (t4_i64)fGetLE(p_, 8);
+      fUnpackFOR(p_ + 8, n_ - 1, out_ + 1);
+      for (i = 1; i < n_; ++i)
+        out_[i] = (t4_i64)((t4_u64)out_[i - 1] + (t4_u64)out_[i]);
+      break;
+    case kDelta2:
+       {
+        t4_u64 d = fGetLE(p_ + 8, 8);
+        out_[0] = (t4_i64)fGetLE(p_, 8);
+        out_[1] = (t4_i64)((t4_u64)out_[0] + d);
+        fUnpackFOR(p_ + 16, n_ - 2, out_ + 2);
+        for (i = 2; i < n_; ++i) {
+          d += (t4_u64)out_[i];
+          out_[i] = (t4_i64)((t4_u64)out_[i - 1] + d);
+        }
+      }
+      break;
+    case kRuns:
+       {
+        int runs = (int)fGetLE(p_, 2);
+
+        c4_Bytes temp;
+        t4_i64 *values = (t4_i64*)temp.SetBuffer(2 *runs *sizeof(t4_i64));
+        t4_i64 *counts = values + runs;
+
+        p_ = fUnpackFOR(p_ + 2, runs, values);
+        fUnpackFOR(p_, runs, counts);
+
+        for (int r = 0; r < runs; ++r)
+          for (t4_i64 k = counts[r]; k >= 0; --k)
+            *out_++ = values[r];
+      }
+      break;
+    case kXor:
+      fUnxorBlock(p_, n_, out_);
+      break;
+    default:
+      d4_assert(0);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+c4_ColOfPacked::c4_ColOfPacked(c4_Persist *persist_, int width_, bool floats_)
+  : c4_Column(persist_), _dataWidth(width_), _numRows( - 1), _block( - 1),
+  _floats(floats_){}
+
+int c4_ColOfPacked::RowCount() {
+  if (_numRows < 0) {
+    _numRows = 0;
+
+    if (ColSize() >= kHeadSize) {
+      c4_Bytes temp;
+      const t4_byte *p = FetchBytes(0, kHeadSize, temp, false);
+
+      d4_assert(p[0] == kPackVersion);
+      d4_assert(p[1] == kBlockBits);
+      _numRows = (int)fGetLE(p + 2, 4);
+    }
+  }
+
+  return _numRows;
+}
+
+int c4_ColOfPacked::ItemSize()const {
+  return _dataWidth;
+}
+
+void c4_ColOfPacked::Forget() {
+  _numRows =  - 1;
+  _block =  - 1;
+}
+
+void c4_ColOfPacked::DecodeBlock(int block_, t4_i64 *out_) {
+  int n = RowCount() - (block_ << kBlockBits);
+  if (n > kBlockSize)
+    n = kBlockSize;
+  d4_assert(n > 0);
+
+  c4_Bytes temp;
+  const t4_byte *p = FetchBytes(kHeadSize + 4 * block_, 8, temp, false);
+  t4_i32 start = (t4_i32)fGetLE(p, 4);
+  t4_i32 limit = (t4_i32)fGetLE(p + 4, 4);
+
+  c4_Bytes buffer;
+  fUnpackBlock(FetchBytes(start, limit - start, buffer, false), n, out_);
+}
+
+const void *c4_ColOfPacked::Get(int index_, int &length_) {
+  d4_assert(0 <= index_ && index_ < RowCount());
+
+  int block = index_ >> kBlockBits;
+  if (block != _block) {
+    if (_cache.Size() == 0)
+      _cache.SetBuffer(kBlockSize *sizeof(t4_i64));
+
+    DecodeBlock(block, (t4_i64*)_cache.Contents());
+    _block = block;
+  }
+
+  const t4_i64 *v = (const t4_i64*)_cache.Contents() + (index_ &(kBlockSize -
+    1));
+
+  length_ = _dataWidth;
+  if (_dataWidth == sizeof(t4_i64))
+    return v;
+
+  *(t4_i32*)_item = (t4_i32) *v;
+  return _item;
+}
+
+bool c4_ColOfPacked::Encode(c4_ColOfInts &src_) {
+  const int rows = src_.RowCount();
+  if (rows < kMinRows)
+    return false;
+
+  const int blocks = (rows + kBlockSize - 1) >> kBlockBits;
+
+  c4_Bytes temp;
+  t4_i64 *values = (t4_i64*)temp.SetBuffer(5 *kBlockSize *sizeof(t4_i64));
+  t4_i64 *work = values + kBlockSize;
+
+  // first pass determines the size, give up if it saves less than 25%
+  t4_i32 limit = src_.ColSize() - (src_.ColSize() >> 2);
+  t4_i32 total = kHeadSize + 4 * (blocks + 1);
+
+  int pass, b, i, n;
+  for (pass = 0; pass < 2; ++pass) {
+    c4_Bytes head;
+    t4_byte *dir = 0;
+
+    if (pass > 0) {
+      SetBuffer(total);
+      Forget();
+
+      dir = head.SetBuffer(kHeadSize + 4 * (blocks + 1));
+      dir[0] = kPackVersion;
+      dir[1] = kBlockBits;
+      fPutLE(dir + 2, rows, 4);
+      dir += kHeadSize;
+
+      total = head.Size();
+    }
+
+    for (b = 0; b < blocks; ++b) {
+      n = rows - (b << kBlockBits);
+      if (n > kBlockSize)
+        n = kBlockSize;
+
+      for (i = 0; i < n; ++i) {
+        int len;
+        const void *p = src_.Get((b << kBlockBits) + i, len);
+        if (len == sizeof(t4_i64))
+          values[i] = *(const t4_i64*)p;
+        else if (_floats)
+          values[i] = *(const uint32_t*)p; // no sign extension of float bits
+        else
+          values[i] = *(const t4_i32*)p;
+      }
+
+      if (pass == 0) {
+        total += fPackBlock(values, n, work, 0, _floats);
+        if (total > limit)
+          return false;
+      } else {
+        c4_Bytes block;
+        int size = fPackBlock(values, n, work, 0, _floats);
+        t4_byte *p = block.SetBuffer(size);
+        memset(p, 0, size);
+        fPackBlock(values, n, work, p, _floats);
+
+        fPutLE(dir + 4 * b, total, 4);
+        StoreBytes(total, block);
+        total += size;
+      }
+    }
+
+    if (pass > 0) {
+      fPutLE(dir + 4 * blocks, total, 4);
+      StoreBytes(0, head);
+      d4_assert(total == ColSize());
+    }
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 bool c4_ColIter::Next() {
   _pos += _len;
 
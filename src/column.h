@@ -13,6 +13,7 @@
 // Declarations in this file
 
 class c4_Column; // a column in a table
+class c4_ColOfPacked; // a column of block-encoded numbers
 class c4_ColIter; // an iterator over column data
 class c4_ColCache; // manages a cache for columns
 
@@ -29,6 +30,8 @@ class c4_Column {
     t4_i32 _gap;
     int _slack;
     bool _dirty;
+    bool _cached; // segments are loaded on demand and may be evicted
+    c4_DWordArray _slots; // cache slot of each loaded segment, if _cached
 
   public:
     c4_Column(c4_Persist *persist_);
@@ -75,6 +78,10 @@ class c4_Column {
 
     bool RequiresMap()const;
     void ReleaseAllSegments();
+    void Advise(int how_);
+    //: Tells the strategy how the data of this column on file will be used.
+    const t4_byte *MappedData();
+    //: Returns all data in place, if unchanged and mapped from a r/o file.
 
     static t4_i32 PullValue(const t4_byte * &ptr_);
     static void PushValue(t4_byte * &ptr_, t4_i32 v_);
@@ -84,7 +91,8 @@ class c4_Column {
     void RemoveGap();
 
     enum {
-        kSegBits = 12, kSegMax = 1 << kSegBits, kSegMask = kSegMax - 1
+        kSegBits = 12, kSegMax = 1 << kSegBits, kSegMask = kSegMax - 1,
+        kSaveBatch = 32 // number of segments written at once by SaveNow
     };
 
   private:
@@ -97,6 +105,9 @@ class c4_Column {
 
     void ReleaseSegment(int);
     void SetupSegments();
+    t4_byte *LoadSegment(int index_);
+    t4_byte *CachedSegment(int index_);
+    void Uncache();
     void Validate()const;
     void FinishSlack();
 
@@ -105,6 +116,34 @@ class c4_Column {
     void MoveGapTo(t4_i32 pos_);
 
     t4_byte *CopyData(t4_i32, t4_i32, int);
+
+    friend class c4_ColCache;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+class c4_ColCache {
+  public:
+    static void SetLimit(t4_i32 bytes_);
+    //: Sets the memory to use for segments, zero to stop caching.
+    static bool IsEnabled();
+    //: Returns true if new columns should load segments through the cache.
+    static t4_i32 Stats(t4_i64 *hits_, t4_i64 *misses_, t4_i64 *evictions_);
+    //: Returns the number of bytes in use, and the counts since SetLimit.
+
+    static int Add(c4_Column &col_, int index_);
+    //: Registers a freshly loaded segment, may evict others to make room.
+    static void Touch(int slot_);
+    //: Marks a segment as used.
+    static void Forget(c4_Column &col_);
+    //: Unregisters all segments of a column, without releasing them.
+
+  private:
+    static void Evict(int slot_);
+
+    enum {
+        kPinned = 64 // recently used segments which are never evicted
+    };
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -117,10 +156,14 @@ class c4_ColOfInts: public c4_Column {
     void SetRowCount(int numRows_);
 
     void FlipBytes();
+    bool IsNative(int width_)const;
+    //: Returns true if all items are stored as plain values of this size.
 
     int ItemSize(int index_);
     const void *Get(int index_, int &length_);
     void Set(int index_, const c4_Bytes &buf_);
+    void SetInts(int index_, const t4_i32 *values_, int count_);
+    //: Stores a run of values, in one go if they fit in the current width.
 
     t4_i32 GetInt(int index_);
     void SetInt(int index_, t4_i32 value_);
@@ -182,6 +225,45 @@ class c4_ColOfInts: public c4_Column {
 
 /////////////////////////////////////////////////////////////////////////////
 
+class c4_ColOfPacked: public c4_Column {
+  public:
+    c4_ColOfPacked(c4_Persist *persist_, int width_ = sizeof(t4_i32), bool
+      floats_ = false);
+
+    int RowCount();
+    //: Returns the number of values, as recorded in the header.
+    int ItemSize()const;
+    //: Returns the width of one decoded value.
+
+    const void *Get(int index_, int &length_);
+    //: Returns one value, decoding its block if not cached.
+
+    bool Encode(c4_ColOfInts &src_);
+    //: Fills this column from plain ints, if that saves enough space.
+    void Forget();
+    //: Drops the decoded block cache, call after contents changed.
+
+    enum {
+        kBlockBits = 10, kBlockSize = 1 << kBlockBits, kMinRows = 64
+    };
+
+  private:
+    void DecodeBlock(int block_, t4_i64 *out_);
+
+    union {
+        t4_byte _item[8]; // holds temp result (careful with alignment!)
+        double _aligner; // needed for SPARC
+    };
+
+    int _dataWidth; // number of bytes used for passing a value along
+    int _numRows; // -1 until the header has been read
+    int _block; // index of the block held in _cache, or -1
+    c4_Bytes _cache; // one decoded block, always as 64-bit values
+    bool _floats; // holds float or double bit patterns
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
 class c4_ColIter {
     c4_Column &_column;
     t4_i32 _limit;
@@ -59,7 +59,8 @@ d4_inline const t4_byte* c4_Column::LoadNow(t4_i32 offset_)
   if (offset_ >= _gap)
     offset_ += _slack;
 
-  t4_byte* ptr = (t4_byte*) _segments.GetAt(fSegIndex(offset_));
+  int i = fSegIndex(offset_);
+  t4_byte* ptr = _cached ? CachedSegment(i) : (t4_byte*) _segments.GetAt(i);
   return ptr + fSegRest(offset_); 
 }
 
@@ -11,6 +11,8 @@
 #include "custom.h"
 #include "format.h"
 
+#include <stdio.h>    // sprintf
+
 /////////////////////////////////////////////////////////////////////////////
 
 class c4_CustomHandler: public c4_Handler {
@@ -130,6 +132,22 @@ bool c4_CustomSeq::RestrictSearch(c4_Cursor cursor_, int &pos_, int &count_) {
   return false;
 }
 
+int c4_CustomSeq::RestrictSelect(c4_Cursor low_, c4_Cursor high_, c4_Bytes
+  &rows_) {
+  return _viewer->SelectRows(low_, high_, rows_);
+}
+
+bool c4_CustomSeq::PickRows(c4_View &view_, c4_Bytes &rows_) {
+  return _viewer->PickRows(view_, rows_);
+}
+
+const char *c4_CustomSeq::Describe() {
+  char buf[50];
+  sprintf(buf, "custom(%d rows)", NumRows());
+
+  return UseTempBuffer(buf);
+}
+
 void c4_CustomSeq::InsertAt(int p_, c4_Cursor c_, int n_) {
   _viewer->InsertRows(p_, c_, n_);
 }
@@ -199,6 +217,30 @@ bool c4_CustomViewer::RemoveRows(int, int) {
   return false; // default is not modifiable
 }
 
+/** Determine which rows lie in a selection range, if this can be done fast
+ *
+ *  Fills the buffer with a sorted array of t4_i32 row numbers, and returns
+ *  how many of the properties in the range were used to narrow down rows.
+ *  If that covers all properties, no other checks will be done on the rows.
+ *  A viewer which asks the view below it for rows as well must leave out
+ *  the properties it handles itself, so that none are counted twice.
+ *  The default returns -1, meaning: "don't know, please scan all".
+ */
+int c4_CustomViewer::SelectRows(c4_Cursor, c4_Cursor, c4_Bytes &) {
+  return  - 1;
+}
+
+/** Determine whether each row is simply a row of some other view
+ *
+ *  If so, sets the view and fills the buffer with one t4_i32 row number per
+ *  row, so that fused views can read that other view's data directly.  The
+ *  other view must have all properties of this one.  The default returns
+ *  false, meaning that rows can only be accessed through this viewer.
+ */
+bool c4_CustomViewer::PickRows(c4_View &, c4_Bytes &) {
+  return false;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 class c4_SliceViewer: public c4_CustomViewer {
@@ -215,6 +257,7 @@ class c4_SliceViewer: public c4_CustomViewer {
     bool SetItem(int row_, int col_, const c4_Bytes &buf_);
     virtual bool InsertRows(int pos_, c4_Cursor value_, int count_ = 1);
     virtual bool RemoveRows(int pos_, int count_ = 1);
+    virtual bool PickRows(c4_View &view_, c4_Bytes &rows_);
 };
 
 c4_SliceViewer::c4_SliceViewer(c4_Sequence &seq_, int first_, int limit_, int
@@ -250,6 +293,17 @@ bool c4_SliceViewer::SetItem(int row_, int col_, const c4_Bytes &buf_) {
   return true;
 }
 
+bool c4_SliceViewer::PickRows(c4_View &view_, c4_Bytes &rows_) {
+  int n = GetSize();
+  t4_i32 *p = (t4_i32*)rows_.SetBuffer(n *sizeof(t4_i32));
+
+  for (int i = 0; i < n; ++i)
+    p[i] = _first + _step *(_step > 0 ? i : i - n + 1);
+
+  view_ = _parent;
+  return true;
+}
+
 bool c4_SliceViewer::InsertRows(int pos_, c4_Cursor value_, int count_) {
   if (_step != 1)
     return false;
@@ -342,6 +396,7 @@ class c4_RemapWithViewer: public c4_CustomViewer {
     virtual int GetSize();
     virtual bool GetItem(int row_, int col_, c4_Bytes &buf_);
     bool SetItem(int row_, int col_, const c4_Bytes &buf_);
+    virtual bool PickRows(c4_View &view_, c4_Bytes &rows_);
 };
 
 c4_RemapWithViewer::c4_RemapWithViewer(c4_Sequence &seq_, const c4_View &view_)
@@ -376,6 +431,20 @@ bool c4_RemapWithViewer::SetItem(int row_, int col_, const c4_Bytes &buf_) {
   return true;
 }
 
+bool c4_RemapWithViewer::PickRows(c4_View &view_, c4_Bytes &rows_) {
+  const c4_Property &map = _argView.NthProperty(0);
+  d4_assert(map.Type() == 'I');
+
+  int n = GetSize();
+  t4_i32 *p = (t4_i32*)rows_.SetBuffer(n *sizeof(t4_i32));
+
+  for (int i = 0; i < n; ++i)
+    p[i] = ((const c4_IntProp &)map)(_argView[i]);
+
+  view_ = _parent;
+  return true;
+}
+
 c4_CustomViewer *f4_CustRemapWith(c4_Sequence &seq_, const c4_View &view_) {
   return d4_new c4_RemapWithViewer(seq_, view_);
 }
@@ -572,12 +641,16 @@ class c4_GroupByViewer: public c4_CustomViewer {
     c4_Property _result;
     c4_DWordArray _map;
 
-    int ScanTransitions(int lo_, int hi_, t4_byte *flags_, const c4_View
-      &match_)const;
+    int ScanTransitions(int lo_, int hi_, t4_byte *flags_, int base_, const
+      c4_View &match_)const;
+
+    enum {
+        kBlockSize = 1 << 16
+    };
 
   public:
     c4_GroupByViewer(c4_Sequence &seq_, const c4_View &keys_, const c4_Property
-      &result_);
+      &result_, t4_i32 budget_);
     virtual ~c4_GroupByViewer();
 
     virtual c4_View GetTemplate();
@@ -586,38 +659,40 @@ class c4_GroupByViewer: public c4_CustomViewer {
 };
 
 c4_GroupByViewer::c4_GroupByViewer(c4_Sequence &seq_, const c4_View &keys_,
-  const c4_Property &result_): _parent(&seq_), _keys(keys_), _result(result_) {
-  _sorted = _parent.SortOn(_keys);
+  const c4_Property &result_, t4_i32 budget_): _parent(&seq_), _keys(keys_),
+  _result(result_) {
+  _sorted = budget_ > 0 ? _parent.SortOnExternal(_keys, budget_):
+    _parent.SortOn(_keys);
   int n = _sorted.GetSize();
 
+  c4_View match = _sorted.Project(_keys);
   c4_Bytes temp;
-  t4_byte *buf = temp.SetBufferClear(n);
 
-  int groups = 0;
-  if (n > 0) {
-    ++buf[0]; // the first entry is always a transition
-    groups = 1+ScanTransitions(1, n, buf, _sorted.Project(_keys));
-  }
+  // set up a map pointing to each transition, flagging one block at a time
+  for (int lo = 0; lo < n; lo += kBlockSize) {
+    int hi = n - lo > kBlockSize ? lo + kBlockSize : n;
+    t4_byte *buf = temp.SetBufferClear(hi - lo);
 
-  // set up a map pointing to each transition
-  _map.SetSize(groups + 1);
-  int j = 0;
+    if (lo == 0)
+      ++buf[0]; // the first entry is always a transition
 
-  for (int i = 0; i < n; ++i)
-    if (buf[i])
-      _map.SetAt(j++, i);
+    ScanTransitions(lo > 0 ? lo : 1, hi, buf, lo, match);
+
+    for (int i = lo; i < hi; ++i)
+      if (buf[i - lo])
+        _map.Add(i);
+  }
 
   // also append an entry to point just past the end
-  _map.SetAt(j, n);
+  _map.Add(n);
 
   d4_assert(_map.GetAt(0) == 0);
-  d4_assert(j == groups);
 }
 
 c4_GroupByViewer::~c4_GroupByViewer(){}
 
-int c4_GroupByViewer::ScanTransitions(int lo_, int hi_, t4_byte *flags_, const
-  c4_View &match_)const {
+int c4_GroupByViewer::ScanTransitions(int lo_, int hi_, t4_byte *flags_, int
+  base_, const c4_View &match_)const {
   d4_assert(lo_ > 0);
 
   int m = hi_ - lo_;
@@ -629,21 +704,21 @@ int c4_GroupByViewer::ScanTransitions(int lo_, int hi_, t4_byte *flags_, const
 
   // range has a transition, done if it is exactly of size one
   if (m == 1) {
-    ++(flags_[lo_]);
+    ++(flags_[lo_ - base_]);
     return 1;
   }
 
   // use binary splitting if the range has enough entries
   if (m >= 5)
-    return ScanTransitions(lo_, lo_ + m / 2, flags_, match_) + ScanTransitions
-      (lo_ + m / 2, hi_, flags_, match_);
+    return ScanTransitions(lo_, lo_ + m / 2, flags_, base_, match_) +
+      ScanTransitions(lo_ + m / 2, hi_, flags_, base_, match_);
 
   // else use a normal linear scan
   int n = 0;
 
   for (int i = lo_; i < hi_; ++i)
   if (match_[i] != match_[i - 1]) {
-    ++(flags_[i]);
+    ++(flags_[i - base_]);
     ++n;
   }
 
@@ -688,8 +763,8 @@ bool c4_GroupByViewer::GetItem(int row_, int col_, c4_Bytes &buf_) {
 }
 
 c4_CustomViewer *f4_CustGroupBy(c4_Sequence &seq_, const c4_View &template_,
-  const c4_Property &result_) {
-  return d4_new c4_GroupByViewer(seq_, template_, result_);
+  const c4_Property &result_, t4_i32 budget_) {
+  return d4_new c4_GroupByViewer(seq_, template_, result_, budget_);
 }
 
 /////////////////////////////////////////////////////////////////////////////
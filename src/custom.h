@@ -29,11 +29,15 @@ class c4_CustomSeq: public c4_HandlerSeq {
     virtual int NumRows()const;
 
     virtual bool RestrictSearch(c4_Cursor, int &, int &);
+    virtual int RestrictSelect(c4_Cursor, c4_Cursor, c4_Bytes &);
+    virtual bool PickRows(c4_View &, c4_Bytes &);
 
     virtual void InsertAt(int, c4_Cursor, int = 1);
     virtual void RemoveAt(int, int = 1);
     virtual void Move(int from_, int);
 
+    virtual const char *Describe();
+
     bool DoGet(int row_, int col_, c4_Bytes &buf_)const;
     void DoSet(int row_, int col_, const c4_Bytes &buf_);
 
@@ -52,7 +56,7 @@ extern c4_CustomViewer *f4_CustConcat(c4_Sequence &, const c4_View &);
 extern c4_CustomViewer *f4_CustRename(c4_Sequence &, const c4_Property &, const
   c4_Property &);
 extern c4_CustomViewer *f4_CustGroupBy(c4_Sequence &, const c4_View &, const
-  c4_Property &);
+  c4_Property &, t4_i32 = 0);
 extern c4_CustomViewer *f4_CustJoinProp(c4_Sequence &, const c4_ViewProp &,
   bool);
 extern c4_CustomViewer *f4_CustJoin(c4_Sequence &, const c4_View &, const
@@ -10,7 +10,10 @@
 #include "handler.h"
 #include "store.h"
 #include "derived.h"
+#include "format.h"
 
+#include <ctype.h>    // tolower
+#include <stdio.h>    // sprintf, tmpfile
 #include <stdlib.h>   // qsort
 
 /////////////////////////////////////////////////////////////////////////////
@@ -20,27 +23,34 @@
 class c4_DerivedSeq;
 class c4_FilterSeq;
 class c4_SortSeq;
+class c4_TopSeq;
+class c4_SpillSeq;
 class c4_ProjectSeq;
+class c4_ExprNode;
+class c4_ExprPlan;
+class c4_ExprSeq;
+class c4_FusedSeq;
 
 /////////////////////////////////////////////////////////////////////////////
 
 class c4_FilterSeq: public c4_DerivedSeq {
   protected:
     c4_DWordArray _rowMap;
-    c4_DWordArray _revMap;
     c4_Row _lowRow;
     c4_Row _highRow;
     c4_Bytes _rowIds;
 
   protected:
-    c4_FilterSeq(c4_Sequence &seq_);
+    c4_FilterSeq(c4_Sequence &seq_, bool allRows_ = true);
     virtual ~c4_FilterSeq();
 
-    void FixupReverseMap();
     int PosInMap(int index_)const;
-    bool Match(int index_, c4_Sequence &seq_, const int * = 0, const int * = 0)
-      const;
-    bool MatchOne(int prop_, const c4_Bytes &data_)const;
+    int FindInMap(int index_)const;
+    virtual bool Match(int index_, c4_Sequence &seq_, const int * = 0, const
+      int * = 0)const;
+    virtual bool MatchOne(int index_, int prop_, const c4_Bytes &data_)const;
+    int SkipZones(int index_, c4_Sequence &seq_, const int *lowCols_, const int
+      *highCols_, bool &skip_)const;
 
   public:
     c4_FilterSeq(c4_Sequence &seq_, c4_Cursor low_, c4_Cursor high_);
@@ -57,20 +67,25 @@ class c4_FilterSeq: public c4_DerivedSeq {
     virtual void Set(int, const c4_Property &, const c4_Bytes &);
     virtual void SetSize(int);
 
+    virtual const char *Describe();
+
     virtual c4_Notifier *PreChange(c4_Notifier &nf_);
     virtual void PostChange(c4_Notifier &nf_);
+
+  protected:
+    const char *DescribeAs(const char *name_);
 };
 
 /////////////////////////////////////////////////////////////////////////////
 
-c4_FilterSeq::c4_FilterSeq(c4_Sequence &seq_): c4_DerivedSeq(seq_) {
-  _rowMap.SetSize(_seq.NumRows());
-  _revMap.SetSize(_seq.NumRows());
-  d4_assert(NumRows() == _seq.NumRows());
+c4_FilterSeq::c4_FilterSeq(c4_Sequence &seq_, bool allRows_): c4_DerivedSeq
+  (seq_) {
+  if (allRows_) {
+    _rowMap.SetSize(_seq.NumRows());
+    d4_assert(NumRows() == _seq.NumRows());
 
-  for (int i = 0; i < NumRows(); ++i) {
-    _rowMap.SetAt(i, i);
-    _revMap.SetAt(i, i);
+    for (int i = 0; i < NumRows(); ++i)
+      _rowMap.SetAt(i, i);
   }
 }
 
@@ -128,33 +143,48 @@ c4_FilterSeq::c4_FilterSeq(c4_Sequence &seq_, c4_Cursor low_, c4_Cursor high_):
 
   _rowMap.SetSize(_seq.NumRows()); // avoid growing, use safe upper bound
 
-  int n = 0;
-
-  for (int i = 0; i < _seq.NumRows(); ++i)
-    if (Match(i, _seq, lowCols, highCols))
-      _rowMap.SetAt(n++, i);
-
-  _rowMap.SetSize(n);
+  int n = 0, limit = 0;
 
-  FixupReverseMap();
-}
+  // a bitmap index may already know which rows are in range, and if it
+  // took all criteria into account, then there is no need to check them
+  c4_Bytes known;
+  int used = _seq.RestrictSelect(low_, high_, known);
+  if (used >= 0) {
+    int crit = 0;
+    for (int j = 0; j < _rowIds.Size(); ++j)
+      if (_rowIds.Contents()[j])
+        ++crit;
 
-c4_FilterSeq::~c4_FilterSeq(){}
+    const t4_i32 *p = (const t4_i32*)known.Contents();
+    int np = known.Size() / sizeof(t4_i32);
 
-void c4_FilterSeq::FixupReverseMap() {
-  int n = _seq.NumRows();
+    for (int k = 0; k < np; ++k)
+      if (used >= crit || Match(p[k], _seq, lowCols, highCols))
+        _rowMap.SetAt(n++, p[k]);
 
-  _revMap.SetSize(0);
+    limit = _seq.NumRows(); // skip the scan below
+  }
 
-  if (n > 0) {
-    _revMap.InsertAt(0, ~(t4_i32)0, n); //!
+  for (int i = limit; i < _seq.NumRows(); ++i) {
+    if (i >= limit) {
+      bool skip;
+      limit = SkipZones(i, _seq, lowCols, highCols, skip);
+      if (skip) {
+        i = limit - 1;
+        continue;
+      }
+    }
 
-    for (int i = 0; i < _rowMap.GetSize(); ++i)
-      _revMap.SetAt((int)_rowMap.GetAt(i), i);
+    if (Match(i, _seq, lowCols, highCols))
+      _rowMap.SetAt(n++, i);
   }
+
+  _rowMap.SetSize(n);
 }
 
-bool c4_FilterSeq::MatchOne(int prop_, const c4_Bytes &data_)const {
+c4_FilterSeq::~c4_FilterSeq(){}
+
+bool c4_FilterSeq::MatchOne(int, int prop_, const c4_Bytes &data_)const {
   d4_assert(prop_ < _rowIds.Size());
 
   t4_byte flag = _rowIds.Contents()[prop_];
@@ -229,6 +259,47 @@ bool c4_FilterSeq::Match(int index_, c4_Sequence &seq_, const int *lowCols_,
   return true;
 }
 
+/*
+Zone maps are only consulted for columns which are stored in the sequence
+being filtered, since only then do rows map one-to-one onto the handlers.
+Returns the end of the range of rows for which skip_ tells whether they can
+all be ignored, because the bounds of some column are completely outside
+the selected range.
+ */
+
+int c4_FilterSeq::SkipZones(int index_, c4_Sequence &seq_, const int
+  *lowCols_, const int *highCols_, bool &skip_)const {
+  c4_Sequence *lowSeq = (&_lowRow)._seq;
+  c4_Sequence *highSeq = (&_highRow)._seq;
+
+  int nl = lowSeq->NumHandlers(), nh = highSeq->NumHandlers();
+
+  int limit = seq_.NumRows();
+  skip_ = false;
+
+  c4_Bytes zmin, zmax;
+
+  for (int c = 0; c < nl + nh; ++c) {
+    bool low = c < nl;
+    int n = low ? lowCols_[c]: highCols_[c - nl];
+    if (n < 0 || seq_.HandlerContext(n) != &seq_)
+      continue;
+
+    int end = limit;
+    if (seq_.NthHandler(n).GetZone(index_, end, zmin, zmax) && (low ?
+      lowSeq->NthHandler(c).Compare(0, zmax) > 0: highSeq->NthHandler(c - nl)
+      .Compare(0, zmin) < 0)) {
+      skip_ = true;
+      return end;
+    }
+
+    if (end < limit)
+      limit = end;
+  }
+
+  return limit;
+}
+
 int c4_FilterSeq::RemapIndex(int index_, const c4_Sequence *seq_)const {
   return seq_ == this ? index_: _seq.RemapIndex((int)_rowMap.GetAt(index_),
     seq_);
@@ -262,16 +333,34 @@ void c4_FilterSeq::SetSize(int) {
   d4_assert(0);
 }
 
-int c4_FilterSeq::PosInMap(int index_)const {
-  int i = 0;
+const char *c4_FilterSeq::Describe() {
+  return DescribeAs("select");
+}
 
-  while (i < NumRows())
-    if ((int)_rowMap.GetAt(i) >= index_)
-      break;
+const char *c4_FilterSeq::DescribeAs(const char *name_) {
+  char buf[50];
+  sprintf(buf, "(%d rows) <- ", NumRows());
+
+  return UseTempBuffer(name_ + c4_String(buf) + _seq.Describe());
+}
+
+int c4_FilterSeq::PosInMap(int index_)const {
+  // the row map is in increasing order, so use a binary search
+  int l = 0, h = NumRows();
+  while (l < h) {
+    int m = l + (h - l) / 2;
+    if ((int)_rowMap.GetAt(m) < index_)
+      l = m + 1;
     else
-      ++i;
+      h = m;
+  }
 
-  return i;
+  return l;
+}
+
+int c4_FilterSeq::FindInMap(int index_)const {
+  int i = PosInMap(index_);
+  return i < NumRows() && (int)_rowMap.GetAt(i) == index_ ? i :  - 1;
 }
 
 c4_Notifier *c4_FilterSeq::PreChange(c4_Notifier &nf_) {
@@ -288,7 +377,7 @@ c4_Notifier *c4_FilterSeq::PreChange(c4_Notifier &nf_) {
     // fall through...
 
     case c4_Notifier::kSetAt:  {
-      int r = (int)_revMap.GetAt(nf_._index);
+      int r = FindInMap(nf_._index);
 
       bool includeRow = r >= 0;
       if (!pass)
@@ -299,7 +388,7 @@ c4_Notifier *c4_FilterSeq::PreChange(c4_Notifier &nf_) {
         }
          else
         // set just one property, and it's not in a row yet
-          includeRow = MatchOne(nf_._propId,  *nf_._bytes);
+          includeRow = MatchOne(nf_._index, nf_._propId,  *nf_._bytes);
       }
 
       if (r >= 0 && !includeRow)
@@ -344,6 +433,9 @@ c4_Notifier *c4_FilterSeq::PreChange(c4_Notifier &nf_) {
         chg->StartMove(i, PosInMap(nf_._count));
     }
     break;
+
+    case c4_Notifier::kBulk: chg->StartBulk(PosInMap(nf_._index));
+    break;
   }
 
   return chg;
@@ -358,7 +450,7 @@ void c4_FilterSeq::PostChange(c4_Notifier &nf_) {
     // fall through...
 
     case c4_Notifier::kSetAt:  {
-      int r = (int)_revMap.GetAt(nf_._index);
+      int r = FindInMap(nf_._index);
 
       bool includeRow = r >= 0;
       if (!pass)
@@ -369,17 +461,13 @@ void c4_FilterSeq::PostChange(c4_Notifier &nf_) {
         }
          else
         // set just one property, and it's not in a row yet
-          includeRow = MatchOne(nf_._propId,  *nf_._bytes);
+          includeRow = MatchOne(nf_._index, nf_._propId,  *nf_._bytes);
       }
 
       if (r >= 0 && !includeRow)
         _rowMap.RemoveAt(r);
       else if (r < 0 && includeRow)
         _rowMap.InsertAt(PosInMap(nf_._index), nf_._index);
-      else
-        break;
-
-      FixupReverseMap();
     }
     break;
 
@@ -395,8 +483,6 @@ void c4_FilterSeq::PostChange(c4_Notifier &nf_) {
 
       while (i < NumRows())
         _rowMap.ElementAt(i++) += nf_._count;
-
-      FixupReverseMap();
     }
     break;
 
@@ -410,8 +496,6 @@ void c4_FilterSeq::PostChange(c4_Notifier &nf_) {
 
       while (i < NumRows())
         _rowMap.ElementAt(i++) -= nf_._count;
-
-      FixupReverseMap();
     }
     break;
 
@@ -428,11 +512,19 @@ void c4_FilterSeq::PostChange(c4_Notifier &nf_) {
           --j;
 
         _rowMap.InsertAt(j, nf_._count);
-
-        FixupReverseMap();
       }
     }
     break;
+
+    case c4_Notifier::kBulk:  {
+      // drop all entries from the first changed row on, then re-match
+      _rowMap.SetSize(PosInMap(nf_._index));
+
+      for (int i = nf_._index; i < _seq.NumRows(); ++i)
+        if (Match(i, _seq))
+          _rowMap.Add(i);
+    }
+    break;
   }
 }
 
@@ -442,13 +534,15 @@ class c4_SortSeq: public c4_FilterSeq {
   public:
     typedef t4_i32 T;
 
-    c4_SortSeq(c4_Sequence &seq_, c4_Sequence *down_);
+    c4_SortSeq(c4_Sequence &seq_, c4_Sequence *down_, bool sortAll_ = true);
     virtual ~c4_SortSeq();
 
+    virtual const char *Describe();
+
     virtual c4_Notifier *PreChange(c4_Notifier &nf_);
     virtual void PostChange(c4_Notifier &nf_);
 
-  private:
+  protected:
     struct c4_SortInfo {
         c4_Handler *_handler;
         const c4_Sequence *_context;
@@ -462,17 +556,20 @@ class c4_SortSeq: public c4_FilterSeq {
         } 
     };
 
+    void PrepareInfo();
     bool LessThan(T a, T b);
     bool TestSwap(T &first, T &second);
     void MergeSortThis(T *ar, int size, T scratch[]);
     void MergeSort(T ar[], int size);
 
     virtual int Compare(int, c4_Cursor)const;
-    int PosInMap(c4_Cursor cursor_)const;
+    int CompareRow(int index_, c4_Cursor cursor_, int row_)const;
+    int PosInMap(c4_Cursor cursor_, int row_)const;
 
     c4_SortInfo *_info;
     c4_Bytes _down;
     int _width;
+    int _oldPos; // position of the row being changed, set in PreChange
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -582,40 +679,48 @@ void c4_SortSeq::MergeSort(T ar[], int size) {
   }
 }
 
-c4_SortSeq::c4_SortSeq(c4_Sequence &seq_, c4_Sequence *down_): c4_FilterSeq
-  (seq_), _info(0), _width( - 1) {
-  d4_assert(NumRows() == seq_.NumRows());
+void c4_SortSeq::PrepareInfo() {
+  d4_assert(!_info);
 
-  if (NumRows() > 0) {
-    // down is a vector of flags, true to sort in reverse order
-    char *down = (char*)_down.SetBufferClear(NumHandlers());
+  int n = NumHandlers() + 1;
+  _info = d4_new c4_SortInfo[n];
 
-    // set the down flag for all properties to be sorted in reverse
-    if (down_)
-      for (int i = 0; i < NumHandlers(); ++i)
-        if (down_->PropIndex(NthPropId(i)) >= 0)
-          down[i] = 1;
+  int j;
 
-    _width =  - 1;
-    int n = NumHandlers() + 1;
-    _info = d4_new c4_SortInfo[n];
+  for (j = 0; j < NumHandlers(); ++j) {
+    _info[j]._handler = &_seq.NthHandler(j);
+    _info[j]._context = _seq.HandlerContext(j);
+  }
 
-    int j;
+  _info[j]._handler = 0;
+}
 
-    for (j = 0; j < NumHandlers(); ++j) {
-      _info[j]._handler = &_seq.NthHandler(j);
-      _info[j]._context = _seq.HandlerContext(j);
-    }
+c4_SortSeq::c4_SortSeq(c4_Sequence &seq_, c4_Sequence *down_, bool sortAll_):
+  c4_FilterSeq(seq_, sortAll_), _info(0), _width( - 1), _oldPos( - 1) {
+  d4_assert(!sortAll_ || NumRows() == seq_.NumRows());
+
+  // down is a vector of flags, true to sort in reverse order
+  char *down = (char*)_down.SetBufferClear(NumHandlers());
+
+  // set the down flag for all properties to be sorted in reverse
+  if (down_)
+    for (int i = 0; i < NumHandlers(); ++i)
+      if (down_->PropIndex(NthPropId(i)) >= 0)
+        down[i] = 1;
 
-    _info[j]._handler = 0;
+  if (sortAll_ && NumRows() > 0) {
+    // sorting touches the key of every row, read them ahead from file
+    for (int j = 0; j < NumHandlers(); ++j)
+      NthHandler(j).Advise(c4_Strategy::kAdviseWillNeed);
+
+    _width =  - 1;
+    PrepareInfo();
 
     // everything is ready, go sort the row index vector
     MergeSort((T*) &_rowMap.ElementAt(0), NumRows());
 
     delete [] _info;
     _info = 0;
-
-    FixupReverseMap();
   }
 }
 
@@ -646,20 +751,52 @@ int c4_SortSeq::Compare(int index_, c4_Cursor cursor_)const {
   return 0;
 }
 
-int c4_SortSeq::PosInMap(c4_Cursor cursor_)const {
-  int i = 0;
+/*
+ *  Entries are kept ordered on their keys and then on their row numbers,
+ *  as in LessThan.  Inserting or removing rows in the underlying view
+ *  renumbers all later rows by the same amount, which keeps that order.
+ *  So the position of any row can be found with a binary search, and no
+ *  reverse map needs to be maintained on each change.
+ */
 
-  while (i < NumRows())
-    if (Compare(i, cursor_) >= 0)
-      break;
+int c4_SortSeq::CompareRow(int index_, c4_Cursor cursor_, int row_)const {
+  int f = Compare(index_, cursor_);
+  return f != 0 ? f : (int)_rowMap.GetAt(index_) - row_;
+}
+
+int c4_SortSeq::PosInMap(c4_Cursor cursor_, int row_)const {
+  int l = 0, h = NumRows();
+  while (l < h) {
+    int m = l + (h - l) / 2;
+    if (CompareRow(m, cursor_, row_) < 0)
+      l = m + 1;
     else
-      ++i;
+      h = m;
+  }
+
+  return l;
+}
 
-  d4_assert(i == NumRows() || Compare(i, cursor_) >= 0);
-  return i;
+const char *c4_SortSeq::Describe() {
+  return DescribeAs("sort");
 }
 
-c4_Notifier *c4_SortSeq::PreChange(c4_Notifier & /*nf_*/) {
+c4_Notifier *c4_SortSeq::PreChange(c4_Notifier &nf_) {
+  // the key of this row is about to change, so find it while we still can
+  _oldPos =  - 1;
+  if (nf_._type == c4_Notifier::kSetAt || (nf_._type == c4_Notifier::kSet &&
+    _seq.PropIndex(nf_._propId) <= _width)) {
+    _oldPos = PosInMap(c4_Cursor(_seq, nf_._index), nf_._index);
+
+    // never touch some other entry, even if the map is not in order
+    if (_oldPos >= NumRows() || (int)_rowMap.GetAt(_oldPos) != nf_._index) {
+      d4_assert(0);
+      _oldPos = NumRows();
+      while (--_oldPos >= 0 && (int)_rowMap.GetAt(_oldPos) != nf_._index)
+        ;
+    }
+  }
+
   if (!GetDependencies())
     return 0;
 
@@ -720,18 +857,18 @@ void c4_SortSeq::PostChange(c4_Notifier &nf_) {
     // cannot affect sort order, valuable optimization
 
     case c4_Notifier::kSetAt:  {
-      int oi = (int)_revMap.GetAt(nf_._index);
+      int oi = _oldPos;
       d4_assert(oi >= 0);
+      if (oi < 0)
+        break;
 
       c4_Cursor cursor(_seq, nf_._index);
 
       // move the entry if the sort order has been disrupted
-      if ((oi > 0 && Compare(oi - 1, cursor) > 0) || (oi + 1 < NumRows() &&
-        Compare(oi + 1, cursor) < 0)) {
+      if ((oi > 0 && CompareRow(oi - 1, cursor, nf_._index) > 0) || (oi + 1 <
+        NumRows() && CompareRow(oi + 1, cursor, nf_._index) < 0)) {
         _rowMap.RemoveAt(oi);
-        _rowMap.InsertAt(PosInMap(cursor), nf_._index);
-
-        FixupReverseMap();
+        _rowMap.InsertAt(PosInMap(cursor, nf_._index), nf_._index);
       }
 
       _width = NumHandlers(); // sorry, no more optimization
@@ -744,17 +881,17 @@ void c4_SortSeq::PostChange(c4_Notifier &nf_) {
       if (nf_._cursor)
         cursor =  *nf_._cursor;
 
-      for (int n = 0; n < NumRows(); ++n)
-        if ((int)_rowMap.GetAt(n) >= nf_._index)
-          _rowMap.ElementAt(n) += nf_._count;
+      // no need to renumber anything when appending rows
+      if (nf_._index + nf_._count < _seq.NumRows())
+        for (int n = 0; n < NumRows(); ++n)
+          if ((int)_rowMap.GetAt(n) >= nf_._index)
+            _rowMap.ElementAt(n) += nf_._count;
 
-      int i = PosInMap(cursor);
+      int i = PosInMap(cursor, nf_._index);
       _rowMap.InsertAt(i, 0, nf_._count);
 
       for (int j = 0; j < nf_._count; ++j)
-        _rowMap.SetAt(i++, nf_._index + j);
-
-      FixupReverseMap();
+        _rowMap.SetAt(i + j, nf_._index + j);
 
       _width = NumHandlers(); // sorry, no more optimization
     }
@@ -778,14 +915,78 @@ void c4_SortSeq::PostChange(c4_Notifier &nf_) {
       d4_assert(j + nf_._count == NumRows());
       _rowMap.SetSize(j);
 
-      FixupReverseMap();
-
       _width = NumHandlers(); // sorry, no more optimization
     }
     break;
 
     case c4_Notifier::kMove:  {
-      // incorrect: may need to move if recnum matters (recs same)
+      int from = nf_._index;
+      int to = nf_._count > from ? nf_._count - 1: nf_._count;
+      if (from == to)
+        break;
+
+      // rows in between shift by one and keep their relative order, but
+      // equal keys are ordered by row number, so the moved row is re-keyed
+      int lo = from < to ? from : to;
+      int hi = from < to ? to : from;
+      int step = from < to ?  - 1: 1;
+
+      int pos =  - 1;
+      for (int n = 0; n < NumRows(); ++n) {
+        int r = (int)_rowMap.GetAt(n);
+        if (r == from)
+          pos = n;
+        else if (lo <= r && r <= hi)
+          _rowMap.ElementAt(n) += step;
+      }
+
+      if (pos >= 0) {
+        _rowMap.RemoveAt(pos);
+        _rowMap.InsertAt(PosInMap(c4_Cursor(_seq, to), to), to);
+      }
+
+      _width = NumHandlers(); // sorry, no more optimization
+    }
+    break;
+
+    case c4_Notifier::kBulk:  {
+      // keep the unchanged rows, which are still in order
+      int n = 0;
+      for (int i = 0; i < NumRows(); ++i)
+        if ((int)_rowMap.GetAt(i) < nf_._index)
+          _rowMap.SetAt(n++, _rowMap.GetAt(i));
+
+      int m = _seq.NumRows() - nf_._index;
+      _rowMap.SetSize(n + m);
+
+      if (m > 0) {
+        for (int j = 0; j < m; ++j)
+          _rowMap.SetAt(n + j, nf_._index + j);
+
+        // sort the changed rows once, then merge both runs
+        PrepareInfo();
+
+        T *ar = (T*) &_rowMap.ElementAt(0);
+        MergeSort(ar + n, m);
+
+        if (n > 0) {
+          T *first = d4_new T[n];
+          memcpy(first, ar, n *sizeof(T));
+
+          T *p = first, *q = ar + n, *out = ar;
+          while (p < first + n && q < ar + n + m)
+            *out++ = LessThan(*q,  *p) ? *q++ :  *p++;
+          while (p < first + n)
+            *out++ =  *p++;
+
+          delete [] first;
+        }
+
+        delete [] _info;
+        _info = 0;
+      }
+
+      _width = NumHandlers(); // sorry, no more optimization
     }
     break;
   }
@@ -793,106 +994,1593 @@ void c4_SortSeq::PostChange(c4_Notifier &nf_) {
 
 /////////////////////////////////////////////////////////////////////////////
 
-class c4_ProjectSeq: public c4_DerivedSeq {
-    c4_DWordArray _colMap; // a bit large, but bytes would be too small
-    bool _frozen;
-    int _omitCount; // if > 0 then this is a dynamic "project without"
-
+class c4_TopSeq: public c4_SortSeq {
   public:
-    c4_ProjectSeq(c4_Sequence &seq_, c4_Sequence &in_, bool, c4_Sequence *out_);
-    virtual ~c4_ProjectSeq();
+    c4_TopSeq(c4_Sequence &seq_, c4_Sequence *down_, int count_, int offset_);
 
-    virtual int NumHandlers()const;
-    virtual c4_Handler &NthHandler(int)const;
-    virtual const c4_Sequence *HandlerContext(int)const;
-    virtual int AddHandler(c4_Handler*);
+    virtual const char *Describe();
 
-    virtual bool Get(int, int, c4_Bytes &);
-    virtual void Set(int, const c4_Property &, const c4_Bytes &);
+    virtual c4_Notifier *PreChange(c4_Notifier &nf_);
+    virtual void PostChange(c4_Notifier &nf_);
+
+  private:
+    void Rebuild();
+    int Place(c4_Cursor cursor_, int row_)const;
+    void SiftUp(T *heap_, int pos_);
+    void SiftDown(T *heap_, int size_);
+    void SelectNth(T *ar_, int lo_, int hi_, int nth_);
+
+    int _count;
+    int _offset;
+    int _oldPlace; // where the changed rows were, set in PreChange
 };
 
-/////////////////////////////////////////////////////////////////////////////
+/*
+ *  Only the rows ranked _offset up to _offset + _count are kept, in the
+ *  same order as a full sort would give them (ties are broken on row
+ *  number, just like c4_SortSeq).  For a short window near the start, the
+ *  rows are picked with a bounded heap in a single pass.  Deeper windows
+ *  use quickselect to partition around the first and last rank, so only
+ *  the rows in the window ever get sorted.
+ *
+ *  Changes to rows which stay on the same side of the window, or which
+ *  only move around inside it, are applied to the window directly.  The
+ *  same goes for inserts and deletes when the window starts at row zero
+ *  and does not need to be refilled.  Anything else selects the window
+ *  again, which is still linear in the number of rows.
+ */
 
-c4_ProjectSeq::c4_ProjectSeq(c4_Sequence &seq_, c4_Sequence &in_, bool reorder_,
-  c4_Sequence *out_): c4_DerivedSeq(seq_), _frozen(!reorder_ && !out_),
-  _omitCount(0) {
-  // build the array with column indexes
-  for (int j = 0; j < in_.NumHandlers(); ++j) {
-    int propId = in_.NthPropId(j);
-    int idx = _seq.PropIndex(propId);
+c4_TopSeq::c4_TopSeq(c4_Sequence &seq_, c4_Sequence *down_, int count_, int
+  offset_): c4_SortSeq(seq_, down_, false), _count(count_), _offset(offset_),
+  _oldPlace(0) {
+  if (_offset < 0)
+    _offset = 0;
 
-    // if the j'th property is in the sequence, add it
-    if (idx >= 0) {
-      // but only if it's not in the out_ view
-      if (out_ && out_->PropIndex(propId) >= 0)
-        ++_omitCount;
-      else
-        _colMap.Add(idx);
-    }
+  Rebuild();
+}
+
+void c4_TopSeq::SiftUp(T *heap_, int pos_) {
+  T v = heap_[pos_];
+
+  while (pos_ > 0) {
+    int p = (pos_ - 1) / 2;
+    if (!LessThan(heap_[p], v))
+      break;
+    heap_[pos_] = heap_[p];
+    pos_ = p;
   }
 
-  // if only reordering, append remaining columns from original view
-  if (reorder_) {
-    for (int i = 0; i < _seq.NumHandlers(); ++i) {
-      int propId = _seq.NthPropId(i);
+  heap_[pos_] = v;
+}
 
-      // only consider properties we did not deal with before
-      if (in_.PropIndex(propId) < 0)
-        _colMap.Add(i);
-    }
+void c4_TopSeq::SiftDown(T *heap_, int size_) {
+  T v = heap_[0];
+  int i = 0;
 
-    d4_assert(_colMap.GetSize() == _seq.NumHandlers());
+  for (;;) {
+    int c = 2 * i + 1;
+    if (c >= size_)
+      break;
+    if (c + 1 < size_ && LessThan(heap_[c], heap_[c + 1]))
+      ++c;
+    if (!LessThan(v, heap_[c]))
+      break;
+    heap_[i] = heap_[c];
+    i = c;
   }
+
+  heap_[i] = v;
 }
 
-c4_ProjectSeq::~c4_ProjectSeq(){}
+void c4_TopSeq::SelectNth(T *ar_, int lo_, int hi_, int nth_) {
+  // all keys differ, since ties are broken on row number
+  while (hi_ - lo_ > 1) {
+    int m = lo_ + (hi_ - lo_) / 2;
+
+    // median of three, also serves as sentinels for the scans below
+    TestSwap(ar_[lo_], ar_[m]);
+    TestSwap(ar_[m], ar_[hi_ - 1]);
+    TestSwap(ar_[lo_], ar_[m]);
+
+    T pivot = ar_[m];
+    int i = lo_, j = hi_ - 1;
+
+    while (i <= j) {
+      while (LessThan(ar_[i], pivot))
+        ++i;
+      while (LessThan(pivot, ar_[j]))
+        --j;
+
+      if (i <= j) {
+        T temp = ar_[i];
+        ar_[i++] = ar_[j];
+        ar_[j--] = temp;
+      }
+    }
 
-int c4_ProjectSeq::NumHandlers()const {
-  return _frozen ? _colMap.GetSize(): _seq.NumHandlers() - _omitCount;
+    if (nth_ <= j)
+      hi_ = j + 1;
+    else if (nth_ >= i)
+      lo_ = i;
+    else
+      break;
+  }
 }
 
-c4_Handler &c4_ProjectSeq::NthHandler(int colNum_)const {
-  int n = colNum_ < _colMap.GetSize() ? _colMap.GetAt(colNum_): colNum_;
-  return _seq.NthHandler(n);
-}
+void c4_TopSeq::Rebuild() {
+  int n = _seq.NumRows();
+  int k = _count < n - _offset ? _offset + _count : n;
 
-const c4_Sequence *c4_ProjectSeq::HandlerContext(int colNum_)const {
-  int n = colNum_ < _colMap.GetSize() ? _colMap.GetAt(colNum_): colNum_;
-  return _seq.HandlerContext(n);
+  _rowMap.SetSize(0);
+  _width =  - 1;
+
+  if (k <= _offset)
+    return ;
+
+  PrepareInfo();
+
+  T *ar;
+
+  if (k <= n / 16) {
+    ar = d4_new T[k];
+
+    for (T r = 0; r < n; ++r)
+      if (r < k) {
+        ar[r] = r;
+        SiftUp(ar, r);
+      } else if (LessThan(r, ar[0])) {
+        ar[0] = r;
+        SiftDown(ar, k);
+      }
+
+    MergeSort(ar, k);
+  } else {
+    ar = d4_new T[n];
+
+    for (T r = 0; r < n; ++r)
+      ar[r] = r;
+
+    SelectNth(ar, 0, n, _offset);
+    SelectNth(ar, _offset, n, k - 1);
+    MergeSort(ar + _offset, k - _offset);
+  }
+
+  _rowMap.SetSize(k - _offset);
+  memcpy(&_rowMap.ElementAt(0), ar + _offset, (k - _offset) *sizeof(T));
+
+  delete [] ar;
+  delete [] _info;
+  _info = 0;
 }
 
-int c4_ProjectSeq::AddHandler(c4_Handler *handler_) {
-  int n = _seq.AddHandler(handler_);
-  return _frozen ? _colMap.Add(n): n - _omitCount;
+int c4_TopSeq::Place(c4_Cursor cursor_, int row_)const {
+  // returns -1 if the row sorts before the window, +1 if after, else 0
+  int w = NumRows();
+  if (w == 0 || CompareRow(0, cursor_, row_) > 0)
+    return  - 1;
+
+  return CompareRow(w - 1, cursor_, row_) < 0 ? 1 : 0;
 }
 
-bool c4_ProjectSeq::Get(int index_, int propId_, c4_Bytes &buf_) {
-  // fixed in 1.8: check that the property is visible
-  return PropIndex(propId_) >= 0 && _seq.Get(index_, propId_, buf_);
+const char *c4_TopSeq::Describe() {
+  return DescribeAs("top");
 }
 
-void c4_ProjectSeq::Set(int index_, const c4_Property &prop_, const c4_Bytes
-  &bytes_) {
-  int n = _seq.NumHandlers();
-  _seq.Set(index_, prop_, bytes_);
+c4_Notifier *c4_TopSeq::PreChange(c4_Notifier &nf_) {
+  _oldPlace = 0;
+  _oldPos =  - 1;
 
-  // if the number of handlers changed, then one must have been added
-  if (n != _seq.NumHandlers()) {
-    d4_assert(n == _seq.NumHandlers() - 1);
+  switch (nf_._type) {
+    case c4_Notifier::kSet: if (_seq.PropIndex(nf_._propId) > _width)
+      break;
+    // cannot affect the order, so the window stays as it is
 
-    if (_frozen)
-      _colMap.Add(n);
+    case c4_Notifier::kSetAt:  {
+      _oldPlace = Place(c4_Cursor(_seq, nf_._index), nf_._index);
+      if (_oldPlace == 0) {
+        _oldPos = PosInMap(c4_Cursor(_seq, nf_._index), nf_._index);
+        d4_assert((int)_rowMap.GetAt(_oldPos) == nf_._index);
+      }
+    }
+    break;
+
+    case c4_Notifier::kRemoveAt:  {
+      // the window stays valid if only rows after it go away, or if it
+      // starts at row zero and there are no more rows after it anyway
+      if (NumRows() == _count && _offset + _count < _seq.NumRows()) {
+        _oldPlace = 1;
+
+        for (int i = 0; i < nf_._count && _oldPlace > 0; ++i) {
+          int r = nf_._index + i;
+          if (Place(c4_Cursor(_seq, r), r) <= 0)
+            _oldPlace =  - 1;
+        }
+      } else
+        _oldPlace = _offset == 0 ? 0 :  - 1;
+    }
+    break;
   }
+
+  return 0;
 }
 
-/////////////////////////////////////////////////////////////////////////////
+void c4_TopSeq::PostChange(c4_Notifier &nf_) {
+  if (_count <= 0)
+    return ;
 
-c4_Sequence *f4_CreateFilter(c4_Sequence &seq_, c4_Cursor l_, c4_Cursor h_) {
-  return d4_new c4_FilterSeq(seq_, l_, h_);
-}
+  switch (nf_._type) {
+    case c4_Notifier::kSet: if (_seq.PropIndex(nf_._propId) > _width)
+      break;
+    // cannot affect the order, so the window stays as it is
 
-c4_Sequence *f4_CreateSort(c4_Sequence &seq_, c4_Sequence *down_) {
-  return d4_new c4_SortSeq(seq_, down_);
+    case c4_Notifier::kSetAt:  {
+      c4_Cursor cursor(_seq, nf_._index);
+
+      if (_oldPlace != 0) {
+        if (Place(cursor, nf_._index) != _oldPlace)
+          Rebuild();
+        break;
+      }
+
+      // the row was in the window, see whether it can stay in there
+      _rowMap.RemoveAt(_oldPos);
+
+      int w = NumRows();
+      if ((_offset > 0 && (w == 0 || CompareRow(0, cursor, nf_._index) > 0)) 
+        || (_offset + w + 1 < _seq.NumRows() && (w == 0 || CompareRow(w - 1,
+        cursor, nf_._index) < 0)))
+        Rebuild();
+      else
+        _rowMap.InsertAt(PosInMap(cursor, nf_._index), nf_._index);
+
+      _width = NumHandlers();
+    }
+    break;
+
+    case c4_Notifier::kInsertAt:  {
+      // if cursor was not set, it started out as a single Set
+      c4_Cursor cursor(_seq, nf_._index);
+      if (nf_._cursor)
+        cursor =  *nf_._cursor;
+
+      for (int n = 0; n < NumRows(); ++n)
+        if ((int)_rowMap.GetAt(n) >= nf_._index)
+          _rowMap.ElementAt(n) += nf_._count;
+
+      // equal keys, so the new rows all end up next to each other
+      int w = NumRows();
+      if (w == _count && CompareRow(w - 1, cursor, nf_._index) < 0)
+        break;
+
+      if (_offset > 0) {
+        Rebuild();
+        break;
+      }
+
+      int i = PosInMap(cursor, nf_._index);
+      _rowMap.InsertAt(i, 0, nf_._count);
+
+      for (int j = 0; j < nf_._count; ++j)
+        _rowMap.SetAt(i + j, nf_._index + j);
+
+      if (NumRows() > _count)
+        _rowMap.SetSize(_count);
+
+      _width = NumHandlers();
+    }
+    break;
+
+    case c4_Notifier::kRemoveAt:  {
+      if (_oldPlace < 0) {
+        Rebuild();
+        break;
+      }
+
+      int lo = nf_._index;
+      int hi = nf_._index + nf_._count;
+
+      int j = 0;
+      for (int i = 0; i < NumRows(); ++i) {
+        int n = (int)_rowMap.GetAt(i);
+
+        if (n >= hi)
+          _rowMap.ElementAt(i) -= nf_._count;
+
+        if (!(lo <= n && n < hi))
+          _rowMap.SetAt(j++, _rowMap.GetAt(i));
+      }
+
+      _rowMap.SetSize(j);
+    }
+    break;
+
+    case c4_Notifier::kMove: case c4_Notifier::kBulk:
+      Rebuild();
+      break;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+class c4_SpillSeq: public c4_SortSeq {
+  public:
+    c4_SpillSeq(c4_Sequence &seq_, c4_Sequence *down_, t4_i32 budget_);
+    virtual ~c4_SpillSeq();
+
+    virtual int RemapIndex(int, const c4_Sequence*)const;
+    virtual int NumRows()const;
+    virtual bool Get(int, int, c4_Bytes &);
+
+    virtual const char *Describe();
+
+    virtual c4_Notifier *PreChange(c4_Notifier &nf_);
+    virtual void PostChange(c4_Notifier &nf_);
+
+  private:
+    struct c4_RunInfo {
+        T *_buf;
+        int _pos, _fill; // entries used and loaded in _buf
+        int _next, _end; // file range of this run still to be loaded
+    };
+
+    enum {
+        kBlock = 1024, kMinBuf = 256
+    };
+
+    void Spill();
+    void SortInMemory();
+    FILE *SortRuns(int length_, c4_DWordArray &runs_);
+    bool MergeRuns(FILE *in_, FILE *out_, c4_DWordArray &runs_, int first_,
+      int count_);
+    bool LoadRun(FILE *in_, c4_RunInfo &run_, int size_);
+    bool RunLess(const c4_RunInfo *runs_, int a_, int b_);
+    void SiftRuns(const c4_RunInfo *runs_, int *heap_, int pos_, int size_);
+    T Row(int index_)const;
+
+    t4_i32 _budget;
+    FILE *_file; // the sorted row numbers, or zero if kept in _rowMap
+    int _numRows;
+    int _blockPos; // first row number held in _block, or -1
+    T _block[kBlock];
+    bool _dirty;
+};
+
+/*
+ *  Sorting a view keeps two row number vectors in memory, the map itself
+ *  and a scratch copy used by the merge sort.  When that exceeds the memory
+ *  budget, runs which do fit are sorted and written to a temporary file,
+ *  and then merged with only a small buffer per run, in as many passes as
+ *  the budget requires.  The resulting row numbers stay on file and are
+ *  read back one block at a time.
+ *
+ *  Keeping the order current on every change is not feasible this way, so
+ *  any change to the underlying view simply marks the order as stale.  It
+ *  is re-created on the next access, which is also when the external sort
+ *  first runs.  Views derived from this one are told that all rows changed.
+ *  If the temporary file can't be read back, the order is re-created in
+ *  memory, as when no temporary file could be written.
+ */
+
+c4_SpillSeq::c4_SpillSeq(c4_Sequence &seq_, c4_Sequence *down_, t4_i32
+  budget_): c4_SortSeq(seq_, down_, false), _budget(budget_), _file(0),
+  _numRows(0), _blockPos( - 1), _dirty(true){}
+
+c4_SpillSeq::~c4_SpillSeq() {
+  if (_file)
+    fclose(_file);
+}
+
+int c4_SpillSeq::RemapIndex(int index_, const c4_Sequence *seq_)const {
+  return seq_ == this ? index_ : _seq.RemapIndex((int)Row(index_), seq_);
+}
+
+int c4_SpillSeq::NumRows()const {
+  if (_dirty)
+    ((c4_SpillSeq*)this)->Spill();
+
+  return _numRows;
+}
+
+bool c4_SpillSeq::Get(int index_, int propId_, c4_Bytes &bytes_) {
+  return _seq.Get((int)Row(index_), propId_, bytes_);
+}
+
+c4_SpillSeq::T c4_SpillSeq::Row(int index_)const {
+  if (_dirty)
+    ((c4_SpillSeq*)this)->Spill();
+
+  if (!_file)
+    return _rowMap.GetAt(index_);
+
+  d4_assert(0 <= index_ && index_ < _numRows);
+
+  if (_blockPos < 0 || index_ < _blockPos || index_ >= _blockPos + kBlock) {
+    c4_SpillSeq *self = (c4_SpillSeq*)this;
+    self->_blockPos = index_ - index_ % kBlock;
+
+    int n = _numRows - _blockPos;
+    if (n > kBlock)
+      n = kBlock;
+
+    if (fseek(_file, (long)_blockPos *sizeof(T), 0) != 0 || (int)fread(self
+      ->_block, sizeof(T), n, _file) != n) {
+      // the temporary file is damaged, don't return any row from it
+      fclose(self->_file);
+      self->_file = 0;
+      self->_blockPos =  - 1;
+
+      self->PrepareInfo();
+      self->SortInMemory();
+
+      delete [] self->_info;
+      self->_info = 0;
+
+      return _rowMap.GetAt(index_);
+    }
+  }
+
+  return _block[index_ - _blockPos];
+}
+
+void c4_SpillSeq::Spill() {
+  _dirty = false;
+  _blockPos =  - 1;
+
+  if (_file) {
+    fclose(_file);
+    _file = 0;
+  }
+
+  _numRows = _seq.NumRows();
+
+  // the merge sort needs room for a scratch copy of each run
+  int length = (int)(_budget / (2 *sizeof(T)));
+  if (length < kBlock)
+    length = kBlock;
+
+  PrepareInfo();
+
+  if (_numRows > length) {
+    c4_DWordArray runs;
+    _file = SortRuns(length, runs);
+
+    // merge as many runs at a time as the buffers in the budget allow
+    int fanIn = (int)(_budget / (kMinBuf *sizeof(T))) - 1;
+    if (fanIn < 2)
+      fanIn = 2;
+
+    while (_file && runs.GetSize() > 2) {
+      FILE *out = tmpfile();
+
+      int n = 0;
+      for (int r = 0; r < runs.GetSize() - 1; r += fanIn) {
+        int count = runs.GetSize() - 1-r;
+        if (count > fanIn)
+          count = fanIn;
+
+        if (!out || !MergeRuns(_file, out, runs, r, count)) {
+          if (out)
+            fclose(out);
+          out = 0;
+          break;
+        }
+
+        runs.SetAt(n++, runs.GetAt(r));
+      }
+
+      runs.SetAt(n++, _numRows);
+      runs.SetSize(n);
+
+      fclose(_file);
+      _file = out;
+    }
+  }
+
+  // when it fits, or when there was trouble with the temporary files
+  if (!_file)
+    SortInMemory();
+  else
+    _rowMap.SetSize(0);
+
+  delete [] _info;
+  _info = 0;
+
+  _width = NumHandlers(); // no optimization, order is re-created anyway
+}
+
+void c4_SpillSeq::SortInMemory() {
+  d4_assert(_info != 0 && _file == 0);
+
+  _rowMap.SetSize(_numRows);
+
+  for (int i = 0; i < _numRows; ++i)
+    _rowMap.SetAt(i, i);
+
+  if (_numRows > 0)
+    MergeSort((T*) &_rowMap.ElementAt(0), _numRows);
+}
+
+FILE *c4_SpillSeq::SortRuns(int length_, c4_DWordArray &runs_) {
+  FILE *file = tmpfile();
+  if (!file)
+    return 0;
+
+  T *buf = d4_new T[length_];
+
+  for (int first = 0; first < _numRows; first += length_) {
+    int m = _numRows - first;
+    if (m > length_)
+      m = length_;
+
+    for (int i = 0; i < m; ++i)
+      buf[i] = first + i;
+
+    MergeSort(buf, m);
+
+    if ((int)fwrite(buf, sizeof(T), m, file) != m) {
+      fclose(file);
+      file = 0;
+      break;
+    }
+
+    runs_.Add(first);
+  }
+
+  runs_.Add(_numRows);
+
+  delete [] buf;
+  return file;
+}
+
+bool c4_SpillSeq::LoadRun(FILE *in_, c4_RunInfo &run_, int size_) {
+  int n = run_._end - run_._next;
+  if (n > size_)
+    n = size_;
+
+  run_._pos = 0;
+  run_._fill = n;
+
+  if (n > 0) {
+    if (fseek(in_, (long)run_._next *sizeof(T), 0) != 0 || (int)fread
+      (run_._buf, sizeof(T), n, in_) != n)
+      return false;
+    run_._next += n;
+  }
+
+  return true;
+}
+
+inline bool c4_SpillSeq::RunLess(const c4_RunInfo *runs_, int a_, int b_) {
+  return LessThan(runs_[a_]._buf[runs_[a_]._pos], runs_[b_]._buf[runs_[b_]
+    ._pos]);
+}
+
+void c4_SpillSeq::SiftRuns(const c4_RunInfo *runs_, int *heap_, int pos_,
+  int size_) {
+  int v = heap_[pos_];
+
+  for (int c; (c = 2 * pos_ + 1) < size_; pos_ = c) {
+    if (c + 1 < size_ && RunLess(runs_, heap_[c + 1], heap_[c]))
+      ++c;
+    if (!RunLess(runs_, heap_[c], v))
+      break;
+    heap_[pos_] = heap_[c];
+  }
+
+  heap_[pos_] = v;
+}
+
+bool c4_SpillSeq::MergeRuns(FILE *in_, FILE *out_, c4_DWordArray &runs_, int
+  first_, int count_) {
+  // split the budget over one buffer per run plus one for the output
+  int size = (int)(_budget / ((count_ + 1) *sizeof(T)));
+  if (size < kMinBuf)
+    size = kMinBuf;
+
+  T *bufs = d4_new T[(count_ + 1) *size];
+  T *out = bufs + count_ * size;
+  int fill = 0;
+
+  c4_RunInfo *runs = d4_new c4_RunInfo[count_];
+  int *heap = d4_new int[count_];
+  int n = 0;
+  bool ok = true;
+
+  for (int i = 0; i < count_ && ok; ++i) {
+    c4_RunInfo &run = runs[i];
+    run._buf = bufs + i * size;
+    run._next = (int)runs_.GetAt(first_ + i);
+    run._end = (int)runs_.GetAt(first_ + i + 1);
+
+    ok = LoadRun(in_, run, size);
+    if (run._fill > 0)
+      heap[n++] = i;
+  }
+
+  // build a heap of runs, ordered on their current entry
+  for (int k = n / 2-1; k >= 0; --k)
+    SiftRuns(runs, heap, k, n);
+
+  while (n > 0 && ok) {
+    c4_RunInfo &run = runs[heap[0]];
+    out[fill++] = run._buf[run._pos++];
+
+    if (fill == size) {
+      ok = (int)fwrite(out, sizeof(T), fill, out_) == fill;
+      fill = 0;
+    }
+
+    if (run._pos >= run._fill) {
+      ok = ok && LoadRun(in_, run, size);
+      if (run._fill == 0)
+        heap[0] = heap[--n];
+    }
+
+    SiftRuns(runs, heap, 0, n);
+  }
+
+  if (ok && fill > 0)
+    ok = (int)fwrite(out, sizeof(T), fill, out_) == fill;
+
+  delete [] heap;
+  delete [] runs;
+  delete [] bufs;
+
+  return ok;
+}
+
+const char *c4_SpillSeq::Describe() {
+  return DescribeAs(_file ? "sort on disk" : "sort");
+}
+
+c4_Notifier *c4_SpillSeq::PreChange(c4_Notifier &) {
+  if (!GetDependencies())
+    return 0;
+
+  // any change may reorder every row, so dependents have to start over
+  c4_Notifier *chg = d4_new c4_Notifier(this);
+  chg->StartBulk(0);
+  return chg;
+}
+
+void c4_SpillSeq::PostChange(c4_Notifier &) {
+  _dirty = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+class c4_ProjectSeq: public c4_DerivedSeq {
+    c4_DWordArray _colMap; // a bit large, but bytes would be too small
+    bool _frozen;
+    int _omitCount; // if > 0 then this is a dynamic "project without"
+
+  public:
+    c4_ProjectSeq(c4_Sequence &seq_, c4_Sequence &in_, bool, c4_Sequence *out_);
+    virtual ~c4_ProjectSeq();
+
+    virtual int NumHandlers()const;
+    virtual c4_Handler &NthHandler(int)const;
+    virtual const c4_Sequence *HandlerContext(int)const;
+    virtual int AddHandler(c4_Handler*);
+
+    virtual bool Get(int, int, c4_Bytes &);
+    virtual void Set(int, const c4_Property &, const c4_Bytes &);
+
+    virtual const char *Describe();
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+c4_ProjectSeq::c4_ProjectSeq(c4_Sequence &seq_, c4_Sequence &in_, bool reorder_,
+  c4_Sequence *out_): c4_DerivedSeq(seq_), _frozen(!reorder_ && !out_),
+  _omitCount(0) {
+  // build the array with column indexes
+  for (int j = 0; j < in_.NumHandlers(); ++j) {
+    int propId = in_.NthPropId(j);
+    int idx = _seq.PropIndex(propId);
+
+    // if the j'th property is in the sequence, add it
+    if (idx >= 0) {
+      // but only if it's not in the out_ view
+      if (out_ && out_->PropIndex(propId) >= 0)
+        ++_omitCount;
+      else
+        _colMap.Add(idx);
+    }
+  }
+
+  // if only reordering, append remaining columns from original view
+  if (reorder_) {
+    for (int i = 0; i < _seq.NumHandlers(); ++i) {
+      int propId = _seq.NthPropId(i);
+
+      // only consider properties we did not deal with before
+      if (in_.PropIndex(propId) < 0)
+        _colMap.Add(i);
+    }
+
+    d4_assert(_colMap.GetSize() == _seq.NumHandlers());
+  }
+}
+
+c4_ProjectSeq::~c4_ProjectSeq(){}
+
+int c4_ProjectSeq::NumHandlers()const {
+  return _frozen ? _colMap.GetSize(): _seq.NumHandlers() - _omitCount;
+}
+
+c4_Handler &c4_ProjectSeq::NthHandler(int colNum_)const {
+  int n = colNum_ < _colMap.GetSize() ? _colMap.GetAt(colNum_): colNum_;
+  return _seq.NthHandler(n);
+}
+
+const c4_Sequence *c4_ProjectSeq::HandlerContext(int colNum_)const {
+  int n = colNum_ < _colMap.GetSize() ? _colMap.GetAt(colNum_): colNum_;
+  return _seq.HandlerContext(n);
+}
+
+int c4_ProjectSeq::AddHandler(c4_Handler *handler_) {
+  int n = _seq.AddHandler(handler_);
+  return _frozen ? _colMap.Add(n): n - _omitCount;
+}
+
+bool c4_ProjectSeq::Get(int index_, int propId_, c4_Bytes &buf_) {
+  // fixed in 1.8: check that the property is visible
+  return PropIndex(propId_) >= 0 && _seq.Get(index_, propId_, buf_);
+}
+
+void c4_ProjectSeq::Set(int index_, const c4_Property &prop_, const c4_Bytes
+  &bytes_) {
+  int n = _seq.NumHandlers();
+  _seq.Set(index_, prop_, bytes_);
+
+  // if the number of handlers changed, then one must have been added
+  if (n != _seq.NumHandlers()) {
+    d4_assert(n == _seq.NumHandlers() - 1);
+
+    if (_frozen)
+      _colMap.Add(n);
+  }
+}
+
+const char *c4_ProjectSeq::Describe() {
+  c4_String s = "project(";
+
+  for (int i = 0; i < NumHandlers(); ++i) {
+    if (i > 0)
+      s += ",";
+    s += NthHandler(i).Property().Name();
+  }
+
+  return UseTempBuffer(s + ") <- " + _seq.Describe());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+class c4_ExprNode {
+  public:
+    enum {
+        kTrue = 100, kAnd, kOr, kNot, kIn
+    };
+
+    c4_ExprNode(int op_, c4_ExprNode *left_ = 0, c4_ExprNode *right_ = 0);
+    ~c4_ExprNode();
+
+    void Attach();
+    void Detach();
+
+    bool Holds(int diff_)const;
+    bool Test(const c4_Bytes &data_)const;
+    bool Match(c4_Sequence &seq_, int index_, int propId_, const c4_Bytes
+      *bytes_)const;
+
+    int MaxPropId()const;
+    void MarkProps(t4_byte *flags_)const;
+
+    int _refs;
+    int _op; // one of the c4_Expr comparisons, or a logical operator
+    c4_ExprNode *_left;
+    c4_ExprNode *_right;
+    int _propId; // the property being compared, or -1
+    int _otherId; // the property compared against, or -1 to use _value
+    char _type;
+    c4_Bytes _value;
+    c4_PtrArray _list; // sorted values for kIn, each one a c4_Bytes
+
+  private:
+    bool MatchText(const c4_Bytes &data_)const;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+static void ClearValue(char type_, c4_Bytes &buf_) {
+  static char zeros[8];
+
+  int n = f4_ClearFormat(type_);
+  d4_assert(n <= sizeof zeros);
+
+  buf_ = c4_Bytes(zeros, n);
+}
+
+static void FetchValue(c4_Sequence &seq_, int index_, int propId_, char type_,
+  int overrideId_, const c4_Bytes *override_, c4_Bytes &buf_, bool copy_) {
+  if (propId_ == overrideId_) {
+    d4_assert(override_ != 0);
+    buf_ = *override_;
+    return ;
+  }
+
+  int n = seq_.PropIndex(propId_);
+  if (n >= 0) {
+    const c4_Sequence *hc = seq_.HandlerContext(n);
+    seq_.NthHandler(n).GetBytes(seq_.RemapIndex(index_, hc), buf_, copy_);
+  } else
+    ClearValue(type_, buf_);
+}
+
+// strings ignore case, as in c4_String::CompareNoCase, bytes do not
+static bool SameChar(int c1_, int c2_, bool fold_) {
+  return c1_ == c2_ || (fold_ && tolower(c1_) == tolower(c2_));
+}
+
+static bool SameText(const t4_byte *s_, const t4_byte *p_, int m_, bool
+  fold_) {
+  for (int i = 0; i < m_; ++i)
+    if (!SameChar(s_[i], p_[i], fold_))
+      return false;
+
+  return true;
+}
+
+static bool GlobMatch(const t4_byte *s_, int n_, const t4_byte *p_, int m_,
+  bool fold_) {
+  int si = 0, pi = 0, star =  - 1, mark = 0;
+
+  while (si < n_) {
+    if (pi < m_ && p_[pi] == '*') {
+      star = pi++;
+      mark = si;
+    } else if (pi < m_ && (p_[pi] == '?' || SameChar(p_[pi], s_[si], fold_)))
+      {
+      ++si;
+      ++pi;
+    } else if (star >= 0) {
+      // let the last star absorb one more character and retry
+      pi = star + 1;
+      si = ++mark;
+    } else
+      return false;
+  }
+
+  while (pi < m_ && p_[pi] == '*')
+    ++pi;
+
+  return pi == m_;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+c4_ExprNode::c4_ExprNode(int op_, c4_ExprNode *left_, c4_ExprNode *right_):
+  _refs(0), _op(op_), _left(left_), _right(right_), _propId( - 1), _otherId(
+  - 1), _type(0) {
+  if (_left)
+    _left->Attach();
+  if (_right)
+    _right->Attach();
+}
+
+c4_ExprNode::~c4_ExprNode() {
+  if (_left)
+    _left->Detach();
+  if (_right)
+    _right->Detach();
+
+  for (int i = 0; i < _list.GetSize(); ++i)
+    delete (c4_Bytes*)_list.GetAt(i);
+}
+
+void c4_ExprNode::Attach() {
+  ++_refs;
+}
+
+void c4_ExprNode::Detach() {
+  d4_assert(_refs > 0);
+
+  if (--_refs == 0)
+    delete this;
+}
+
+bool c4_ExprNode::Holds(int diff_)const {
+  switch (_op) {
+    case c4_Expr::kEQ:
+      return diff_ == 0;
+    case c4_Expr::kNE:
+      return diff_ != 0;
+    case c4_Expr::kLT:
+      return diff_ < 0;
+    case c4_Expr::kLE:
+      return diff_ <= 0;
+    case c4_Expr::kGT:
+      return diff_ > 0;
+    case c4_Expr::kGE:
+      return diff_ >= 0;
+  }
+
+  d4_assert(0);
+  return false;
+}
+
+bool c4_ExprNode::MatchText(const c4_Bytes &data_)const {
+  const t4_byte *s = data_.Contents();
+  const t4_byte *p = _value.Contents();
+  int n = data_.Size(), m = _value.Size();
+
+  // strings are stored with a trailing null byte, which is not text
+  if (_type == 'S') {
+    if (n > 0 && s[n - 1] == 0)
+      --n;
+    if (m > 0 && p[m - 1] == 0)
+      --m;
+  }
+
+  // match strings the same way as kEQ and others compare them
+  const bool fold = _type == 'S';
+
+  switch (_op) {
+    case c4_Expr::kPrefix:
+      return m <= n && SameText(s, p, m, fold);
+
+    case c4_Expr::kContains:
+      for (int i = 0; i + m <= n; ++i)
+        if (SameText(s + i, p, m, fold))
+          return true;
+      return false;
+  }
+
+  d4_assert(_op == c4_Expr::kGlob);
+  return GlobMatch(s, n, p, m, fold);
+}
+
+bool c4_ExprNode::Test(const c4_Bytes &data_)const {
+  switch (_op) {
+    case c4_Expr::kPrefix:
+    case c4_Expr::kContains:
+    case c4_Expr::kGlob:
+      return MatchText(data_);
+
+    case kIn:  {
+      int l = 0, h = _list.GetSize();
+      while (l < h) {
+        int m = l + (h - l) / 2;
+        int f = f4_CompareFormat(_type, *(const c4_Bytes*)_list.GetAt(m),
+          data_);
+        if (f == 0)
+          return true;
+        if (f < 0)
+          l = m + 1;
+        else
+          h = m;
+      }
+      return false;
+    }
+  }
+
+  return Holds(f4_CompareFormat(_type, data_, _value));
+}
+
+/*
+Evaluates the expression on a single row, which may live in any sequence,
+such as the temporary row passed along with a change notification.  If
+propId_ is not -1, then bytes_ is used as value for that property, to find
+out whether a row will match once a pending change has been applied.
+ */
+
+bool c4_ExprNode::Match(c4_Sequence &seq_, int index_, int propId_, const
+  c4_Bytes *bytes_)const {
+  switch (_op) {
+    case kTrue:
+      return true;
+    case kAnd:
+      return _left->Match(seq_, index_, propId_, bytes_) && _right->Match
+        (seq_, index_, propId_, bytes_);
+    case kOr:
+      return _left->Match(seq_, index_, propId_, bytes_) || _right->Match
+        (seq_, index_, propId_, bytes_);
+    case kNot:
+      return !_left->Match(seq_, index_, propId_, bytes_);
+  }
+
+  c4_Bytes data;
+  FetchValue(seq_, index_, _propId, _type, propId_, bytes_, data, true);
+
+  if (_otherId < 0)
+    return Test(data);
+
+  c4_Bytes other;
+  FetchValue(seq_, index_, _otherId, _type, propId_, bytes_, other, false);
+
+  return Holds(f4_CompareFormat(_type, data, other));
+}
+
+int c4_ExprNode::MaxPropId()const {
+  int n = _propId > _otherId ? _propId : _otherId;
+
+  if (_left) {
+    int l = _left->MaxPropId();
+    if (n < l)
+      n = l;
+  }
+
+  if (_right) {
+    int r = _right->MaxPropId();
+    if (n < r)
+      n = r;
+  }
+
+  return n;
+}
+
+void c4_ExprNode::MarkProps(t4_byte *flags_)const {
+  if (_propId >= 0)
+    flags_[_propId] = 1;
+  if (_otherId >= 0)
+    flags_[_otherId] = 1;
+
+  if (_left)
+    _left->MarkProps(flags_);
+  if (_right)
+    _right->MarkProps(flags_);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// c4_Expr
+
+c4_Expr::c4_Expr(): _node(d4_new c4_ExprNode(c4_ExprNode::kTrue)) {
+  _node->Attach();
+}
+
+c4_Expr::c4_Expr(const c4_RowRef &crit_, int op_): _node(d4_new c4_ExprNode
+  (c4_ExprNode::kTrue)) {
+  _node->Attach();
+
+  c4_Sequence *seq = (&crit_)._seq;
+  int index = (&crit_)._index;
+
+  // one comparison per property, combined with "and"
+  for (int i = 0; i < seq->NumHandlers(); ++i) {
+    const c4_Property &prop = seq->NthHandler(i).Property();
+
+    c4_Bytes data;
+    seq->Get(index, prop.GetId(), data);
+
+    c4_ExprNode *leaf = d4_new c4_ExprNode(op_);
+    leaf->_propId = prop.GetId();
+    leaf->_type = prop.Type();
+    leaf->_value = c4_Bytes(data.Contents(), data.Size(), true);
+
+    *this = i == 0 ? c4_Expr(leaf): *this && c4_Expr(leaf);
+  }
+}
+
+c4_Expr::c4_Expr(const c4_Property &prop_, int op_, const c4_Property &other_)
+  : _node(0) {
+  d4_assert(op_ <= kGE);
+
+  if (prop_.Type() == other_.Type()) {
+    _node = d4_new c4_ExprNode(op_);
+    _node->_propId = prop_.GetId();
+    _node->_otherId = other_.GetId();
+    _node->_type = prop_.Type();
+  } else
+  // values of different types never compare equal, nor in any order
+    _node = d4_new c4_ExprNode(c4_ExprNode::kNot, d4_new c4_ExprNode
+      (c4_ExprNode::kTrue));
+
+  _node->Attach();
+}
+
+c4_Expr::c4_Expr(const c4_View &list_): _node(0) {
+  if (list_.NumProperties() == 0) {
+    _node = d4_new c4_ExprNode(c4_ExprNode::kNot, d4_new c4_ExprNode
+      (c4_ExprNode::kTrue));
+    _node->Attach();
+    return ;
+  }
+
+  const c4_Property &prop = list_.NthProperty(0);
+
+  _node = d4_new c4_ExprNode(c4_ExprNode::kIn);
+  _node->_propId = prop.GetId();
+  _node->_type = prop.Type();
+  _node->Attach();
+
+  // keep the values sorted, so each row can use a binary search
+  c4_PtrArray &list = _node->_list;
+
+  for (int i = 0; i < list_.GetSize(); ++i) {
+    c4_Bytes data;
+    list_.GetItem(i, 0, data);
+
+    int l = 0, h = list.GetSize();
+    while (l < h) {
+      int m = l + (h - l) / 2;
+      if (f4_CompareFormat(_node->_type, *(const c4_Bytes*)list.GetAt(m),
+        data) < 0)
+        l = m + 1;
+      else
+        h = m;
+    }
+
+    list.InsertAt(l, d4_new c4_Bytes(data.Contents(), data.Size(), true));
+  }
+}
+
+c4_Expr::c4_Expr(c4_ExprNode *node_): _node(node_) {
+  _node->Attach();
+}
+
+c4_Expr::c4_Expr(const c4_Expr &expr_): _node(expr_._node) {
+  _node->Attach();
+}
+
+c4_Expr::~c4_Expr() {
+  _node->Detach();
+}
+
+c4_Expr &c4_Expr::operator = (const c4_Expr &expr_) {
+  expr_._node->Attach();
+  _node->Detach();
+  _node = expr_._node;
+  return  *this;
+}
+
+c4_Expr operator && (const c4_Expr &a_, const c4_Expr &b_) {
+  return d4_new c4_ExprNode(c4_ExprNode::kAnd, a_._node, b_._node);
+}
+
+c4_Expr operator || (const c4_Expr &a_, const c4_Expr &b_) {
+  return d4_new c4_ExprNode(c4_ExprNode::kOr, a_._node, b_._node);
+}
+
+c4_Expr operator !(const c4_Expr &a_) {
+  return d4_new c4_ExprNode(c4_ExprNode::kNot, a_._node);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+A plan is an expression bound to one specific sequence.  All handlers are
+looked up once, and rows are then tested one column at a time: each node
+takes a selection vector of row numbers, and reduces it to those rows which
+match.  An "and" node only passes the survivors of its left side on to the
+right side, an "or" node only passes the rows which did not match yet.
+ */
+
+class c4_ExprPlan {
+    const c4_ExprNode &_node;
+    c4_ExprPlan *_left;
+    c4_ExprPlan *_right;
+    c4_Handler *_handler; // zero if the property is not in the sequence
+    const c4_Sequence *_context;
+    c4_Handler *_other;
+    const c4_Sequence *_otherContext;
+
+  public:
+    c4_ExprPlan(const c4_ExprNode &node_, c4_Sequence &seq_);
+    ~c4_ExprPlan();
+
+    void Select(c4_Sequence &seq_, c4_DWordArray &rows_)const;
+
+  private:
+    void Fetch(c4_Sequence &seq_, int index_, c4_Handler *handler_, const
+      c4_Sequence *context_, c4_Bytes &buf_, bool copy_)const;
+};
+
+c4_ExprPlan::c4_ExprPlan(const c4_ExprNode &node_, c4_Sequence &seq_): _node
+  (node_), _left(0), _right(0), _handler(0), _context(0), _other(0),
+  _otherContext(0) {
+  if (_node._left)
+    _left = d4_new c4_ExprPlan(*_node._left, seq_);
+  if (_node._right)
+    _right = d4_new c4_ExprPlan(*_node._right, seq_);
+
+  if (_node._propId >= 0) {
+    int n = seq_.PropIndex(_node._propId);
+    if (n >= 0) {
+      _handler = &seq_.NthHandler(n);
+      _context = seq_.HandlerContext(n);
+    }
+  }
+
+  if (_node._otherId >= 0) {
+    int n = seq_.PropIndex(_node._otherId);
+    if (n >= 0) {
+      _other = &seq_.NthHandler(n);
+      _otherContext = seq_.HandlerContext(n);
+    }
+  }
+}
+
+c4_ExprPlan::~c4_ExprPlan() {
+  delete _left;
+  delete _right;
+}
+
+void c4_ExprPlan::Fetch(c4_Sequence &seq_, int index_, c4_Handler *handler_,
+  const c4_Sequence *context_, c4_Bytes &buf_, bool copy_)const {
+  if (handler_ == 0)
+    ClearValue(_node._type, buf_);
+  else
+    handler_->GetBytes(context_ == &seq_ ? index_ : seq_.RemapIndex(index_,
+      context_), buf_, copy_);
+}
+
+void c4_ExprPlan::Select(c4_Sequence &seq_, c4_DWordArray &rows_)const {
+  int count = rows_.GetSize();
+  if (count == 0)
+    return ;
+
+  switch (_node._op) {
+    case c4_ExprNode::kTrue:
+      return ;
+
+    case c4_ExprNode::kAnd:
+      _left->Select(seq_, rows_);
+      _right->Select(seq_, rows_);
+      return ;
+
+    case c4_ExprNode::kOr:
+    case c4_ExprNode::kNot:  {
+      c4_DWordArray hits;
+      hits.SetSize(count);
+      for (int i = 0; i < count; ++i)
+        hits.SetAt(i, rows_.GetAt(i));
+
+      _left->Select(seq_, hits);
+
+      // remove the hits, both vectors are in increasing order
+      int n = 0, h = 0;
+      for (int j = 0; j < count; ++j) {
+        t4_i32 r = rows_.GetAt(j);
+        if (h < hits.GetSize() && hits.GetAt(h) == r)
+          ++h;
+        else
+          rows_.SetAt(n++, r);
+      }
+      rows_.SetSize(n);
+
+      if (_node._op == c4_ExprNode::kNot)
+        return ;
+
+      _right->Select(seq_, rows_);
+
+      // merge the hits of both sides back into a single vector
+      int k = hits.GetSize() + rows_.GetSize();
+      int a = hits.GetSize() - 1, b = rows_.GetSize() - 1;
+      rows_.SetSize(k);
+      while (b >= 0)
+        rows_.SetAt(--k, a >= 0 && hits.GetAt(a) > rows_.GetAt(b) ?
+          hits.GetAt(a--): rows_.GetAt(b--));
+      while (a >= 0)
+        rows_.SetAt(--k, hits.GetAt(a--));
+      return ;
+    }
+  }
+
+  c4_Bytes data, other;
+
+  // a property which does not exist has the same default value in all rows
+  if (_handler == 0 && (_node._otherId < 0 || _other == 0)) {
+    ClearValue(_node._type, data);
+    if (!(_node._otherId < 0 ? _node.Test(data): _node.Holds(0)))
+      rows_.SetSize(0);
+    return ;
+  }
+
+  // strings go through the handler, which can compare dictionary codes
+  bool viaHandler = _node._type == 'S' && _handler != 0 && _node._otherId < 0
+    && _node._op <= c4_Expr::kGE;
+
+  int n = 0;
+  for (int i = 0; i < count; ++i) {
+    int r = (int)rows_.GetAt(i);
+    bool match;
+
+    if (viaHandler)
+      match = _node.Holds(_handler->Compare(_context == &seq_ ? r :
+        seq_.RemapIndex(r, _context), _node._value));
+    else if (_node._otherId < 0) {
+      Fetch(seq_, r, _handler, _context, data, false);
+      match = _node.Test(data);
+    } else {
+      // the first value must be copied, both may use the same handler
+      Fetch(seq_, r, _handler, _context, data, true);
+      Fetch(seq_, r, _other, _otherContext, other, false);
+      match = _node.Holds(f4_CompareFormat(_node._type, data, other));
+    }
+
+    if (match)
+      rows_.SetAt(n++, r);
+  }
+
+  rows_.SetSize(n);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+class c4_ExprSeq: public c4_FilterSeq {
+    c4_Expr _expr;
+
+  public:
+    c4_ExprSeq(c4_Sequence &seq_, const c4_Expr &expr_);
+    virtual ~c4_ExprSeq();
+
+    virtual const char *Describe();
+
+  protected:
+    virtual bool Match(int index_, c4_Sequence &seq_, const int * = 0, const
+      int * = 0)const;
+    virtual bool MatchOne(int index_, int prop_, const c4_Bytes &data_)const;
+};
+
+c4_ExprSeq::c4_ExprSeq(c4_Sequence &seq_, const c4_Expr &expr_): c4_FilterSeq
+  (seq_), _expr(expr_) {
+  // only changes to the properties used in the expression need re-matching
+  int max = _expr._node->MaxPropId();
+  _expr._node->MarkProps(_rowIds.SetBufferClear(max + 1));
+
+  // the base class starts off with all rows, reduce that to the matches
+  c4_ExprPlan plan(*_expr._node, _seq);
+  plan.Select(_seq, _rowMap);
+}
+
+c4_ExprSeq::~c4_ExprSeq(){}
+
+const char *c4_ExprSeq::Describe() {
+  return DescribeAs("where");
+}
+
+bool c4_ExprSeq::Match(int index_, c4_Sequence &seq_, const int *, const int
+  *)const {
+  return _expr._node->Match(seq_, index_,  - 1, 0);
+}
+
+bool c4_ExprSeq::MatchOne(int index_, int prop_, const c4_Bytes &data_)const {
+  return _expr._node->Match(_seq, index_, prop_, &data_);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+A fused view collapses a stack of derived views into a single row map per
+underlying sequence, plus the handler to use for each column.  Reads then
+go to that handler directly, instead of passing each layer of the stack.
+The maps are dropped on every change to any of the sequences involved, and
+rebuilt on the next access, so this pays off for views which are read far
+more often than they are changed.
+ */
+
+class c4_FusedSeq: public c4_DerivedSeq {
+    c4_View _picked; // a view the top layer picks rows from, if any
+    c4_PtrArray _contexts; // sequences which hold the handlers
+    c4_PtrArray _maps; // row map for each context, as a c4_DWordArray
+    c4_PtrArray _handlers; // handler for each column, zero if not fused
+    c4_DWordArray _slots; // the entry in _contexts for each column
+    c4_PtrArray _attached; // other sequences which report changes to us
+    bool _dirty;
+
+  public:
+    c4_FusedSeq(c4_Sequence &seq_);
+    virtual ~c4_FusedSeq();
+
+    virtual int RemapIndex(int, const c4_Sequence*)const;
+
+    virtual int ItemSize(int, int);
+    virtual bool Get(int, int, c4_Bytes &);
+    virtual void Set(int, const c4_Property &, const c4_Bytes &);
+
+    virtual void InsertAt(int, c4_Cursor, int = 1);
+    virtual void RemoveAt(int, int = 1);
+
+    virtual const char *Describe();
+
+    virtual c4_Notifier *PreChange(c4_Notifier &nf_);
+    virtual void PostChange(c4_Notifier &nf_);
+
+  private:
+    void Rebuild();
+    void Forget();
+    c4_Handler *Lookup(int propId_, int &index_);
+};
+
+c4_FusedSeq::c4_FusedSeq(c4_Sequence &seq_): c4_DerivedSeq(seq_), _dirty(true)
+  {}
+
+c4_FusedSeq::~c4_FusedSeq() {
+  Forget();
+
+  for (int i = 0; i < _attached.GetSize(); ++i)
+    ((c4_Sequence*)_attached.GetAt(i))->Detach(this);
+}
+
+void c4_FusedSeq::Forget() {
+  for (int i = 0; i < _maps.GetSize(); ++i)
+    delete (c4_DWordArray*)_maps.GetAt(i);
+
+  _maps.SetSize(0);
+  _contexts.SetSize(0);
+  _handlers.SetSize(0);
+  _slots.SetSize(0);
+  _picked = c4_View();
+
+  _dirty = true;
+}
+
+void c4_FusedSeq::Rebuild() {
+  Forget();
+
+  // a custom view may merely pick rows from another one, so look past it
+  c4_View picked;
+  c4_Bytes picks;
+  bool pick = _seq.PickRows(picked, picks);
+  c4_Sequence &src = pick ? *(&picked[0])._seq: _seq;
+
+  const t4_i32 *rows = (const t4_i32*)picks.Contents();
+  int n = NumRows();
+  d4_assert(!pick || picks.Size() == n *(int)sizeof(t4_i32));
+
+  for (int col = 0; col < _seq.NumHandlers(); ++col) {
+    int i = src.PropIndex(_seq.NthPropId(col));
+    if (i < 0) {
+      _handlers.Add(0);
+      _slots.Add( - 1);
+      continue;
+    }
+
+    const c4_Sequence *hc = src.HandlerContext(i);
+
+    int k = _contexts.GetSize();
+    while (--k >= 0)
+      if (_contexts.GetAt(k) == hc)
+        break;
+
+    if (k < 0) {
+      c4_DWordArray *map = d4_new c4_DWordArray;
+      map->SetSize(n);
+
+      for (int j = 0; j < n; ++j)
+        map->SetAt(j, src.RemapIndex(pick ? rows[j] : j, hc));
+
+      k = _contexts.Add((void*)hc);
+      _maps.Add(map);
+
+      // changes deep down may not be passed up the stack, so watch it all
+      int a = _attached.GetSize();
+      while (--a >= 0)
+        if (_attached.GetAt(a) == hc)
+          break;
+
+      if (a < 0 && hc != &_seq) {
+        ((c4_Sequence*)hc)->Attach(this);
+        _attached.Add((void*)hc);
+      }
+    }
+
+    _handlers.Add(&src.NthHandler(i));
+    _slots.Add(k);
+  }
+
+  _picked = picked; // keeps the picked view alive
+  _dirty = false;
+}
+
+c4_Handler *c4_FusedSeq::Lookup(int propId_, int &index_) {
+  if (_dirty)
+    Rebuild();
+
+  int col = PropIndex(propId_);
+  if (col < 0 || col >= _handlers.GetSize() || _handlers.GetAt(col) == 0)
+    return 0;
+
+  const c4_DWordArray *map = (const c4_DWordArray*)_maps.GetAt((int)
+    _slots.GetAt(col));
+  index_ = (int)map->GetAt(index_);
+
+  return (c4_Handler*)_handlers.GetAt(col);
+}
+
+int c4_FusedSeq::RemapIndex(int index_, const c4_Sequence *seq_)const {
+  if (seq_ == this)
+    return index_;
+
+  if (!_dirty)
+    for (int k = 0; k < _contexts.GetSize(); ++k)
+      if (_contexts.GetAt(k) == seq_)
+        return (int)((const c4_DWordArray*)_maps.GetAt(k))->GetAt(index_);
+
+  return _seq.RemapIndex(index_, seq_);
+}
+
+int c4_FusedSeq::ItemSize(int index_, int propId_) {
+  int i = index_;
+  c4_Handler *h = Lookup(propId_, i);
+  return h != 0 ? h->ItemSize(i): _seq.ItemSize(index_, propId_);
+}
+
+bool c4_FusedSeq::Get(int index_, int propId_, c4_Bytes &buf_) {
+  int i = index_;
+  c4_Handler *h = Lookup(propId_, i);
+  if (h == 0)
+    return _seq.Get(index_, propId_, buf_);
+
+  h->GetBytes(i, buf_);
+  return true;
+}
+
+void c4_FusedSeq::Set(int index_, const c4_Property &prop_, const c4_Bytes
+  &buf_) {
+  _seq.Set(index_, prop_, buf_);
+}
+
+void c4_FusedSeq::InsertAt(int index_, c4_Cursor newElem_, int count_) {
+  _seq.InsertAt(index_, newElem_, count_);
+}
+
+void c4_FusedSeq::RemoveAt(int index_, int count_) {
+  _seq.RemoveAt(index_, count_);
+}
+
+const char *c4_FusedSeq::Describe() {
+  if (_dirty)
+    Rebuild();
+
+  int n = 0;
+  for (int i = 0; i < _handlers.GetSize(); ++i)
+    if (_handlers.GetAt(i) != 0)
+      ++n;
+
+  char buf[100];
+  sprintf(buf, "fused(%d rows, %d of %d columns via %d row maps) <- ",
+    NumRows(), n, _handlers.GetSize(), _maps.GetSize());
+
+  return UseTempBuffer(buf + c4_String(_seq.Describe()));
+}
+
+c4_Notifier *c4_FusedSeq::PreChange(c4_Notifier &nf_) {
+  // only changes reported by the top layer concern our own dependents
+  return nf_.Origin() == &_seq ? c4_DerivedSeq::PreChange(nf_): 0;
+}
+
+void c4_FusedSeq::PostChange(c4_Notifier &) {
+  _dirty = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+c4_Sequence *f4_CreateFilter(c4_Sequence &seq_, c4_Cursor l_, c4_Cursor h_) {
+  return d4_new c4_FilterSeq(seq_, l_, h_);
+}
+
+c4_Sequence *f4_CreateExprFilter(c4_Sequence &seq_, const c4_Expr &expr_) {
+  return d4_new c4_ExprSeq(seq_, expr_);
+}
+
+c4_Sequence *f4_CreateFused(c4_Sequence &seq_) {
+  return d4_new c4_FusedSeq(seq_);
+}
+
+c4_Sequence *f4_CreateSort(c4_Sequence &seq_, c4_Sequence *down_) {
+  return d4_new c4_SortSeq(seq_, down_);
+}
+
+c4_Sequence *f4_CreateSortTop(c4_Sequence &seq_, c4_Sequence *down_, int
+  count_, int offset_) {
+  return d4_new c4_TopSeq(seq_, down_, count_, offset_);
+}
+
+c4_Sequence *f4_CreateSortExternal(c4_Sequence &seq_, c4_Sequence *down_,
+  t4_i32 budget_) {
+  return d4_new c4_SpillSeq(seq_, down_, budget_);
 }
 
 c4_Sequence *f4_CreateProject(c4_Sequence &seq_, c4_Sequence &in_, bool
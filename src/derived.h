@@ -13,10 +13,15 @@
 // Declarations in this file
 
 class c4_Cursor; // not defined here
+class c4_Expr; // not defined here
 class c4_Sequence; // not defined here
 
 extern c4_Sequence *f4_CreateFilter(c4_Sequence &, c4_Cursor, c4_Cursor);
+extern c4_Sequence *f4_CreateExprFilter(c4_Sequence &, const c4_Expr &);
+extern c4_Sequence *f4_CreateFused(c4_Sequence &);
 extern c4_Sequence *f4_CreateSort(c4_Sequence &, c4_Sequence * = 0);
+extern c4_Sequence *f4_CreateSortTop(c4_Sequence &, c4_Sequence *, int, int);
+extern c4_Sequence *f4_CreateSortExternal(c4_Sequence &, c4_Sequence *, t4_i32);
 extern c4_Sequence *f4_CreateProject(c4_Sequence &, c4_Sequence &, bool,
   c4_Sequence * = 0);
 
@@ -30,6 +30,22 @@
 #include <fcntl.h>
 #endif 
 
+#if q4_UNIX && HAVE_MMAP && !defined (MAP_ANON) && defined (MAP_ANONYMOUS)
+#define MAP_ANON MAP_ANONYMOUS
+#endif 
+
+// positioned and vectored I/O: no seeks, and one system call per column
+#if q4_UNIX && defined (__linux__)
+#define q4_VECTORIO 1
+#include <sys/uio.h>
+#include <errno.h>
+#endif 
+
+// map files into a reserved address range, so they can grow in place
+#if q4_UNIX && HAVE_MMAP && !NO_MMAP && defined (MAP_FIXED) && defined (MAP_ANON)
+#define q4_GROWMAP 1
+#endif 
+
 #if q4_WINCE
 #define _get_osfhandle(x) x
 #endif 
@@ -201,7 +217,8 @@ bool c4_FileStream::Write(const void *buffer_, int length_) {
 /////////////////////////////////////////////////////////////////////////////
 // c4_FileStrategy
 
-c4_FileStrategy::c4_FileStrategy(FILE *file_): _file(file_), _cleanup(0) {
+c4_FileStrategy::c4_FileStrategy(FILE *file_): _file(file_), _cleanup(0),
+  _mapBase(0), _mapReserve(0), _mapLength(0) {
   InitializeIO();
   ResetFileMapping();
 }
@@ -244,6 +261,24 @@ t4_i32 c4_FileStrategy::FreshGeneration() {
   return 0;
 }
 
+// read-ahead requests are split up into chunks of this many bytes
+static const t4_i32 kAdviseChunk = 128 << 10;
+
+// the most buffers passed to the kernel in one vectored I/O call
+static const int kMaxVector = 256;
+
+#if q4_GROWMAP
+// Returns how much address space to set aside for mapping a file of the
+// given size: at least twice that, and plenty on 64-bit systems.
+static t4_i32 MapReserve(t4_i32 len_) {
+  t4_i32 room = sizeof(void*) > 4 ? 256 << 20: 1 << 20;
+  if (room < len_)
+    room = len_ < 0x3FFFFFFF ? 2 * len_ : 0x7FFFFFFF;
+  return room &~(t4_i32)(sysconf(_SC_PAGESIZE) - 1);
+}
+
+#endif 
+
 void c4_FileStrategy::ResetFileMapping() {
 #if q4_WIN32
   if (_mapStart != 0) {
@@ -276,19 +311,80 @@ void c4_FileStrategy::ResetFileMapping() {
     }
   }
 #elif HAVE_MMAP && !NO_MMAP
+#if q4_GROWMAP
+  /* A commit, or a refresh after another process committed, usually
+     only appends to the file.  Instead of tearing down the whole map and
+     faulting every page in again, extend it inside the address range
+     which was reserved when the file was first mapped.  The map start
+     stays put, and so do all the pages which were already resident.
+     A file which got smaller keeps its map, the bytes past the end are
+     simply never touched (they are remapped when the file grows back).
+     If the file outgrows the reservation, fall back to a full remap. */
+  if (_mapBase != 0 && _file != 0) {
+    t4_i32 len = FileSize();
+
+    if (len > 0 && len <= _mapReserve) {
+      if (len > _mapLength) {
+        t4_i32 from = _mapLength &~(t4_i32)(sysconf(_SC_PAGESIZE) - 1);
+        if (mmap(_mapBase + from, len - from, PROT_READ, MAP_SHARED |
+          MAP_FIXED, fileno(_file), from) == _mapBase + from)
+          _mapLength = len;
+      }
+
+      if (len <= _mapLength) {
+#ifdef MADV_NORMAL
+        // a commit may have put other data where a random access hint
+        // was given, and the kept pages would otherwise keep that hint
+        madvise((char*)_mapBase, _mapLength, MADV_NORMAL);
+#endif 
+        _mapStart = _mapBase + _baseOffset;
+        _dataSize = len - _baseOffset;
+        return ;
+      }
+    }
+  }
+#endif 
+
   if (_mapStart != 0) {
     _mapStart -= _baseOffset;
-    munmap((char*)_mapStart, _baseOffset + _dataSize); // also loses const
+#if q4_GROWMAP
+    if (_mapBase != 0)
+      munmap((char*)_mapBase, _mapReserve);
+    else
+#endif 
+      munmap((char*)_mapStart, _baseOffset + _dataSize); // also loses const
     _mapStart = 0;
     _dataSize = 0;
   }
 
+  _mapBase = 0;
+  _mapReserve = 0;
+  _mapLength = 0;
+
   if (_file != 0) {
     t4_i32 len = FileSize();
 
     if (len > 0) {
-      _mapStart = (const t4_byte*)mmap(0, len, PROT_READ, MAP_SHARED, fileno
-        (_file), 0);
+#if q4_GROWMAP
+      t4_i32 room = MapReserve(len);
+      void *p = room >= len ? mmap(0, room, PROT_NONE, MAP_PRIVATE | MAP_ANON,
+         - 1, 0): (void*) - 1L;
+      if (p != (void*) - 1L) {
+        if (mmap(p, len, PROT_READ, MAP_SHARED | MAP_FIXED, fileno(_file), 0) 
+          == p) {
+          _mapBase = (t4_byte*)p;
+          _mapReserve = room;
+          _mapLength = len;
+        } else
+          munmap((char*)p, room);
+      }
+
+      if (_mapBase != 0)
+        _mapStart = _mapBase;
+      else
+#endif 
+        _mapStart = (const t4_byte*)mmap(0, len, PROT_READ, MAP_SHARED, fileno
+          (_file), 0);
       if (_mapStart != (void*) - 1L) {
         _mapStart += _baseOffset;
         _dataSize = len - _baseOffset;
@@ -299,6 +395,51 @@ void c4_FileStrategy::ResetFileMapping() {
 #endif 
 }
 
+void c4_FileStrategy::DataAdvise(t4_i32 pos_, t4_i32 len_, int how_) {
+  if (_file == 0 || pos_ < 0 || len_ <= 0)
+    return ;
+
+#if q4_UNIX && HAVE_MMAP && !NO_MMAP && defined (MADV_WILLNEED)
+  /* Advice applies to whole pages of the map, which starts on a page
+     boundary.  MADV_RANDOM sticks to the pages until they are unmapped
+     (and may split the map into separate regions), so it is only meant
+     for data which is always probed, such as the map of a hash view.
+     It is reset when the map is kept across a commit, and callers
+     should undo it with kAdviseNormal when they no longer need it.
+     Read-ahead is requested in chunks, because Linux silently reads no
+     more than its read-ahead window for each request. */
+  if (_mapStart != 0) {
+    if (pos_ + len_ > _dataSize)
+      len_ = _dataSize - pos_;
+    if (len_ <= 0)
+      return ;
+
+    t4_i32 pos = _baseOffset + pos_;
+    t4_i32 off = pos &~(t4_i32)(sysconf(_SC_PAGESIZE) - 1);
+    char *map = (char*)(_mapStart - _baseOffset);
+
+    if (how_ != kAdviseWillNeed)
+      madvise(map + off, pos + len_ - off, how_ == kAdviseRandom ? MADV_RANDOM
+        : MADV_NORMAL);
+    else
+      for (; off < pos + len_; off += kAdviseChunk)
+        madvise(map + off, pos + len_ - off < kAdviseChunk ? pos + len_ - off
+          : kAdviseChunk, MADV_WILLNEED);
+    return ;
+  }
+#endif 
+
+#if q4_UNIX && defined (POSIX_FADV_WILLNEED)
+  // without a map, only read-ahead is useful: the other kinds of file
+  // advice apply to all reads from this file, not just to this range
+  if (how_ == kAdviseWillNeed)
+    for (t4_i32 pos = _baseOffset + pos_; len_ > 0; pos += kAdviseChunk,
+      len_ -= kAdviseChunk)
+      posix_fadvise(fileno(_file), pos, len_ < kAdviseChunk ? len_ :
+        kAdviseChunk, POSIX_FADV_WILLNEED);
+#endif 
+}
+
 #if q4_WIN32 && !q4_BORC && !q4_WINCE
 static DWORD GetPlatformId() {
   static OSVERSIONINFO os;
@@ -409,6 +550,110 @@ void c4_FileStrategy::DataWrite(t4_i32 pos_, const void *buf_, int len_) {
   }
 }
 
+/*
+ *  Loading or saving a column which is not mapped takes a read or write
+ *  of every 4 Kb segment, each preceded by a seek.  With vectored I/O, the
+ *  segments of a column go to or from the kernel in a single system call,
+ *  and the file offset is passed along, so there is no seek either.  The
+ *  stdio buffer of the file is flushed first, to keep both views of the
+ *  file consistent: preadv must see pending writes, and no stale data
+ *  must be left in the buffer after a pwritev.
+ */
+
+int c4_FileStrategy::DataReadv(t4_i32 pos_, void *const *bufs_, const t4_i32
+  *lens_, int count_) {
+#if q4_VECTORIO
+  d4_assert(_baseOffset + pos_ >= 0);
+  d4_assert(_file != 0);
+
+  if (fflush(_file) < 0)
+    return  - 1;
+
+  int total = 0;
+
+  while (count_ > 0) {
+    struct iovec vec[kMaxVector];
+    t4_i32 want = 0;
+
+    int n = count_ < kMaxVector ? count_ : kMaxVector;
+    for (int i = 0; i < n; ++i) {
+      vec[i].iov_base = bufs_[i];
+      vec[i].iov_len = lens_[i];
+      want += lens_[i];
+    }
+
+    ssize_t r = preadv(fileno(_file), vec, n, _baseOffset + pos_);
+    if (r < 0)
+      return total > 0 ? total :  - 1;
+
+    total += (int)r;
+    if (r < want)
+      break;
+    // only at end of file
+
+    pos_ += want;
+    bufs_ += n;
+    lens_ += n;
+    count_ -= n;
+  }
+
+  return total;
+#else 
+  return c4_Strategy::DataReadv(pos_, bufs_, lens_, count_);
+#endif 
+}
+
+void c4_FileStrategy::DataWritev(t4_i32 pos_, const void *const *bufs_, const
+  t4_i32 *lens_, int count_) {
+#if q4_VECTORIO
+  d4_assert(_baseOffset + pos_ >= 0);
+  d4_assert(_file != 0);
+
+  if (fflush(_file) < 0) {
+    _failure = ferror(_file);
+    d4_assert(_failure != 0);
+    return ;
+  }
+
+  while (count_ > 0 && _failure == 0) {
+    struct iovec vec[kMaxVector];
+    t4_i32 want = 0;
+
+    int n = count_ < kMaxVector ? count_ : kMaxVector;
+    for (int i = 0; i < n; ++i) {
+      vec[i].iov_base = (void*)bufs_[i]; // loses const
+      vec[i].iov_len = lens_[i];
+      want += lens_[i];
+    }
+
+    // a short write is rare, finish it in pieces if it happens
+    ssize_t r = pwritev(fileno(_file), vec, n, _baseOffset + pos_);
+    if (r < want) {
+      if (r < 0 && errno != EINTR) {
+        _failure = errno;
+        break;
+      }
+
+      t4_i32 skip = r > 0 ? (t4_i32)r : 0;
+      for (int i = 0; i < n && _failure == 0; ++i) {
+        if (skip < lens_[i])
+          DataWrite(pos_ + skip, (const char*)bufs_[i] + skip, lens_[i] -
+            skip);
+        pos_ += lens_[i];
+        skip = skip > lens_[i] ? skip - lens_[i] : 0;
+      }
+    } else
+      pos_ += want;
+
+    bufs_ += n;
+    lens_ += n;
+    count_ -= n;
+  }
+#else 
+  c4_Strategy::DataWritev(pos_, bufs_, lens_, count_);
+#endif 
+}
+
 void c4_FileStrategy::DataCommit(t4_i32 limit_) {
   d4_assert(_file != 0);
 
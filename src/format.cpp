@@ -45,6 +45,427 @@ bool c4_FormatHandler::IsPersistent()const {
 
 /////////////////////////////////////////////////////////////////////////////
 
+/*
+Zone maps hold the lowest and highest value of each block of kZoneSize rows
+in large numeric and string columns.  Range selections and Find consult them
+through c4_Handler::GetZone, and skip whole blocks which cannot match.  With
+append-ordered data, such as time stamps, the cost of selecting a window is
+then close to the number of rows in the result, not in the entire view.
+
+Set widens the bounds, unless it replaces a value equal to one of them: then
+the block is marked unknown, to be recalculated from the column once needed
+again.  Appends extend the last block(s), but other inserts and deletes shift
+rows, so all blocks from there on become unknown.  A block holding values
+which cannot be ordered (NaN) or long strings is open, it is never skipped.
+
+If enabled with c4_Storage::SaveZoneMaps, the zone map is saved on commit
+as one more column, flagged in the walk by a marker value in front of the
+other column(s) of its handler.  The layout is a version byte, the block
+bits, and then per block a state byte and, if closed, both bounds as a size
+and the raw bytes.  Numbers are little-endian.  Without that setting, files
+keep the layout which older releases can read, and zone maps are rebuilt
+in memory as blocks get scanned.
+ */
+
+class c4_ZoneMap {
+  public:
+    c4_ZoneMap(c4_Handler &owner_, c4_Persist *persist_);
+    ~c4_ZoneMap();
+
+    void Define(int rows_, const t4_byte **ptr_);
+    void Commit(c4_SaveContext &ar_);
+    void Unmapped();
+
+    bool Lookup(int index_, int &limit_, c4_Bytes &min_, c4_Bytes &max_);
+    void Set(int index_, const c4_Bytes &buf_);
+    void Insert(int index_, const c4_Bytes &buf_, int count_);
+    void Remove(int index_, int count_);
+    void Changed(int index_);
+
+    enum {
+        kZoneBits = 10, kZoneSize = 1 << kZoneBits, kMinRows = 2 * kZoneSize,
+          kMaxItem = 64
+    };
+
+  private:
+    enum {
+        kUnknown, kClosed, kOpen
+    };
+
+    int NumZones()const;
+    c4_Bytes *Bound(int zone_, int which_)const;
+    void Reset(int zone_, int state_, const c4_Bytes *buf_ = 0);
+    void Widen(int zone_, const c4_Bytes &buf_);
+    void Calculate(int zone_);
+    void Resize(int rows_);
+    void Forget(int from_);
+    bool Orderable(const c4_Bytes &buf_)const;
+    void Load();
+    void Save();
+
+    c4_Handler &_owner;
+    c4_Column _column;
+    c4_DWordArray _states;
+    c4_PtrArray _bounds; // min and max of each zone, as c4_Bytes
+    int _rows;
+    bool _loaded; // true once _column contents have been parsed
+    bool _changed; // true if _column must be rebuilt on commit
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+static const t4_i32 kZonedMarker =  - 2;
+
+// numeric bounds are stored little-endian, regardless of the file format
+static void fZoneOrder(char type_, c4_Bytes &buf_) {
+  const t4_i32 endian = 0x03020100;
+  if (*(const t4_byte*) &endian == 0 || type_ == 'S')
+    return ;
+
+  int n = buf_.Size();
+  c4_Bytes temp(buf_.Contents(), n, n > 0);
+  t4_byte *p = buf_.SetBuffer(n);
+  for (int i = 0; i < n; ++i)
+    p[i] = temp.Contents()[n - 1-i];
+}
+
+c4_ZoneMap::c4_ZoneMap(c4_Handler &owner_, c4_Persist *persist_): _owner
+  (owner_), _column(persist_), _rows(0), _loaded(true), _changed(false){}
+
+c4_ZoneMap::~c4_ZoneMap() {
+  Forget(0);
+}
+
+int c4_ZoneMap::NumZones()const {
+  return _states.GetSize();
+}
+
+c4_Bytes *c4_ZoneMap::Bound(int zone_, int which_)const {
+  return (c4_Bytes*)_bounds.GetAt(2 *zone_ + which_);
+}
+
+void c4_ZoneMap::Reset(int zone_, int state_, const c4_Bytes *buf_) {
+  for (int i = 0; i < 2; ++i) {
+    delete Bound(zone_, i);
+    c4_Bytes *p = buf_ != 0 ? d4_new c4_Bytes(buf_->Contents(), buf_->Size(),
+      buf_->Size() > 0): 0;
+    _bounds.SetAt(2 *zone_ + i, p);
+  }
+
+  _states.SetAt(zone_, state_);
+}
+
+bool c4_ZoneMap::Orderable(const c4_Bytes &buf_)const {
+  char type = _owner.Property().Type();
+  return buf_.Size() <= kMaxItem && f4_CompareFormat(type, buf_, buf_) == 0;
+}
+
+void c4_ZoneMap::Widen(int zone_, const c4_Bytes &buf_) {
+  if (_states.GetAt(zone_) != kClosed)
+    return ;
+
+  if (!Orderable(buf_)) {
+    Reset(zone_, kOpen);
+    _changed = true;
+    return ;
+  }
+
+  char type = _owner.Property().Type();
+
+  for (int i = 0; i < 2; ++i) {
+    c4_Bytes &bound = *Bound(zone_, i);
+    int f = f4_CompareFormat(type, buf_, bound);
+    if (i == 0 ? f < 0 : f > 0) {
+      bound = c4_Bytes(buf_.Contents(), buf_.Size(), buf_.Size() > 0);
+      _changed = true;
+    }
+  }
+}
+
+void c4_ZoneMap::Calculate(int zone_) {
+  int from = zone_ << kZoneBits;
+  int limit = from + kZoneSize;
+  if (limit > _rows)
+    limit = _rows;
+
+  c4_Bytes data;
+  _owner.GetBytes(from, data, true);
+
+  if (!Orderable(data)) {
+    Reset(zone_, kOpen);
+    return ;
+  }
+
+  Reset(zone_, kClosed, &data);
+
+  // ints are always orderable, and much quicker to compare directly
+  if (_owner.Property().Type() == 'I') {
+    t4_i32 lo = *(const t4_i32*)data.Contents(), hi = lo;
+    for (int i = from + 1; i < limit; ++i) {
+      int n;
+      t4_i32 v = *(const t4_i32*)_owner.Get(i, n);
+      if (v < lo)
+        lo = v;
+      else if (v > hi)
+        hi = v;
+    }
+    *Bound(zone_, 0) = c4_Bytes(&lo, sizeof lo, true);
+    *Bound(zone_, 1) = c4_Bytes(&hi, sizeof hi, true);
+    return ;
+  }
+
+  for (int i = from + 1; i < limit && _states.GetAt(zone_) == kClosed; ++i) {
+    _owner.GetBytes(i, data, true);
+    Widen(zone_, data);
+  }
+}
+
+void c4_ZoneMap::Forget(int from_) {
+  for (int i = from_; i < NumZones(); ++i)
+    Reset(i, kUnknown);
+
+  if (from_ < NumZones())
+    _changed = true;
+}
+
+void c4_ZoneMap::Resize(int rows_) {
+  int n = (rows_ + kZoneSize - 1) >> kZoneBits;
+
+  for (int i = n; i < NumZones(); ++i)
+    Reset(i, kUnknown);
+
+  _states.SetSize(n);
+  _bounds.SetSize(2 *n);
+  _rows = rows_;
+}
+
+void c4_ZoneMap::Define(int rows_, const t4_byte **ptr_) {
+  Resize(0);
+  Resize(rows_);
+
+  _column.SetBuffer(0);
+  _loaded = true;
+  _changed = false;
+
+  if (ptr_ != 0) {
+    // peek ahead: a negative value can only be a marker
+    const t4_byte *p =  *ptr_;
+    if (c4_Column::PullValue(p) == kZonedMarker) {
+      _column.PullLocation(p);
+      *ptr_ = p;
+
+      _loaded = _column.ColSize() == 0;
+    }
+  }
+}
+
+void c4_ZoneMap::Load() {
+  if (_loaded)
+    return ;
+
+  _loaded = true;
+
+  c4_Bytes temp;
+  const t4_byte *p = _column.FetchBytes(0, _column.ColSize(), temp, false);
+  const t4_byte *end = p + _column.ColSize();
+
+  // don't trust a zone map which does not fit the column exactly
+  if (_column.ColSize() < 2 || p[0] != 1 || p[1] != kZoneBits) {
+    _changed = true;
+    return ;
+  }
+
+  p += 2;
+
+  char type = _owner.Property().Type();
+
+  int i;
+  for (i = 0; i < NumZones() && p < end; ++i) {
+    int state = *p++;
+    if (state == kClosed) {
+      Reset(i, kClosed);
+
+      for (int j = 0; j < 2; ++j) {
+        int n = c4_Column::PullValue(p);
+        c4_Bytes *bound = d4_new c4_Bytes(p, n, n > 0);
+        fZoneOrder(type, *bound);
+        _bounds.SetAt(2 *i + j, bound);
+        p += n;
+      }
+    } else
+      Reset(i, state);
+  }
+
+  if (i != NumZones() || p != end)
+    Forget(0);
+}
+
+void c4_ZoneMap::Save() {
+  d4_assert(_loaded);
+
+  char type = _owner.Property().Type();
+
+  c4_Bytes buffer;
+  t4_byte *p = 0;
+
+  // first pass only determines the size, second one stores the bytes
+  for (int pass = 0; pass < 2; ++pass) {
+    int size = 2;
+    if (p != 0) {
+      p[0] = 1;
+      p[1] = kZoneBits;
+    }
+
+    for (int i = 0; i < NumZones(); ++i) {
+      if (_states.GetAt(i) == kUnknown)
+        Calculate(i);
+
+      int state = (int)_states.GetAt(i);
+      if (p != 0)
+        p[size] = (t4_byte)state;
+      ++size;
+
+      if (state == kClosed)
+      for (int j = 0; j < 2; ++j) {
+        c4_Bytes bound = *Bound(i, j);
+        fZoneOrder(type, bound);
+
+        t4_byte head[5];
+        t4_byte *q = head;
+        c4_Column::PushValue(q, bound.Size());
+
+        if (p != 0) {
+          memcpy(p + size, head, q - head);
+          memcpy(p + size + (q - head), bound.Contents(), bound.Size());
+        }
+        size += (q - head) + bound.Size();
+      }
+    }
+
+    if (p == 0)
+      p = buffer.SetBuffer(size);
+  }
+
+  _column.SetBuffer(buffer.Size());
+  _column.StoreBytes(0, buffer);
+  _changed = false;
+}
+
+void c4_ZoneMap::Commit(c4_SaveContext &ar_) {
+  if (_rows < kMinRows)
+    return ;
+
+  Load();
+
+  // without saving, drop the column so its file space can be reused
+  c4_Persist *persist = _column.Persist();
+  if (persist == 0 || !persist->SavesZoneMaps()) {
+    if (_column.ColSize() > 0) {
+      _column.SetBuffer(0);
+      _changed = true;
+    }
+    return ;
+  }
+
+  if (_changed || _column.ColSize() == 0)
+    Save();
+
+  ar_.StoreMarker(kZonedMarker);
+  ar_.CommitColumn(_column);
+}
+
+void c4_ZoneMap::Unmapped() {
+  _column.ReleaseAllSegments();
+}
+
+bool c4_ZoneMap::Lookup(int index_, int &limit_, c4_Bytes &min_, c4_Bytes
+  &max_) {
+  if (_rows < kMinRows)
+    return false;
+
+  Load();
+
+  int zone = index_ >> kZoneBits;
+  if (_states.GetAt(zone) == kUnknown)
+    Calculate(zone);
+
+  limit_ = (zone + 1) << kZoneBits;
+  if (limit_ > _rows)
+    limit_ = _rows;
+
+  if (_states.GetAt(zone) != kClosed)
+    return false;
+
+  min_ = c4_Bytes(Bound(zone, 0)->Contents(), Bound(zone, 0)->Size());
+  max_ = c4_Bytes(Bound(zone, 1)->Contents(), Bound(zone, 1)->Size());
+  return true;
+}
+
+void c4_ZoneMap::Set(int index_, const c4_Bytes &buf_) {
+  Load();
+
+  int zone = index_ >> kZoneBits;
+  if (_states.GetAt(zone) != kClosed)
+    return ;
+
+  // when the old value is a bound, the zone may shrink: recalculate later
+  c4_Bytes data;
+  _owner.GetBytes(index_, data, true);
+
+  char type = _owner.Property().Type();
+  if (f4_CompareFormat(type, data,  *Bound(zone, 0)) == 0 || f4_CompareFormat
+    (type, data,  *Bound(zone, 1)) == 0) {
+    Reset(zone, kUnknown);
+    _changed = true;
+  } else
+    Widen(zone, buf_);
+}
+
+void c4_ZoneMap::Insert(int index_, const c4_Bytes &buf_, int count_) {
+  Load();
+
+  int rows = _rows;
+  int zones = NumZones();
+  Resize(rows + count_);
+
+  if (index_ < rows) {
+    Forget(index_ >> kZoneBits);
+    return ;
+  }
+
+  // appending only affects the last zone, and adds new ones
+  if (rows &(kZoneSize - 1))
+    Widen(zones - 1, buf_);
+
+  for (int i = zones; i < NumZones(); ++i)
+    if (Orderable(buf_))
+      Reset(i, kClosed, &buf_);
+    else
+      Reset(i, kOpen);
+
+  _changed = true;
+}
+
+void c4_ZoneMap::Remove(int index_, int count_) {
+  Load();
+
+  int rows = _rows;
+  Resize(rows - count_);
+
+  // removing from the end leaves the bounds of all other rows intact
+  if (index_ + count_ < rows)
+    Forget(index_ >> kZoneBits);
+
+  _changed = true;
+}
+
+void c4_ZoneMap::Changed(int index_) {
+  Load();
+  Forget(index_ >> kZoneBits);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 class c4_FormatX: public c4_FormatHandler {
   public:
     c4_FormatX(const c4_Property &prop_, c4_HandlerSeq &seq_, int width_ =
@@ -58,37 +479,135 @@ class c4_FormatX: public c4_FormatHandler {
     virtual const void *Get(int index_, int &length_);
     virtual void Set(int index_, const c4_Bytes &buf_);
 
+    virtual bool GetZone(int index_, int &limit_, c4_Bytes &min_, c4_Bytes
+      &max_);
+
     virtual void Insert(int index_, const c4_Bytes &buf_, int count_);
+    virtual void InsertFrom(int index_, c4_Handler &src_, int count_, const
+      t4_i32 *rows_);
     virtual void Remove(int index_, int count_);
 
     virtual void Commit(c4_SaveContext &ar_);
 
     virtual void Unmapped();
+    virtual void Advise(int how_);
+    virtual const void *SharedData(int count_, int width_);
 
     static int DoCompare(const c4_Bytes &b1_, const c4_Bytes &b2_);
 
   protected:
     c4_ColOfInts _data;
+
+  private:
+    void Unpack();
+
+    c4_ColOfPacked _packed;
+    c4_ZoneMap _zones;
+    bool _isPacked; // true if values are only available in _packed
+    bool _recalc; // true if _packed must be recalculated on commit
 };
 
 /////////////////////////////////////////////////////////////////////////////
 
+/*
+Numeric columns can be stored in block-encoded form (c4_ColOfPacked),
+which is chosen on commit when it saves at least a quarter of the space.
+Ints and longs use frame-of-reference, delta, or run-length coding, while
+floats and doubles use xor coding of successive values, or run-lengths.
+Such a column is flagged in the structure walk by a negative marker value
+in front of the column location (a plain column size is never negative).
+
+A packed column is decoded one block at a time while it is only being read.
+On the first change, all values are unpacked into _data, and from then on
+everything works as with plain columns, until the next commit repacks them.
+ */
+
+static const t4_i32 kPackedMarker =  - 1;
+
 c4_FormatX::c4_FormatX(const c4_Property &p_, c4_HandlerSeq &s_, int w_):
-  c4_FormatHandler(p_, s_), _data(s_.Persist(), w_){}
+  c4_FormatHandler(p_, s_), _data(s_.Persist(), w_), _packed(s_.Persist(), w_,
+  p_.Type() == 'F' || p_.Type() == 'D'), _zones(*this, s_.Persist()),
+  _isPacked(false), _recalc(false){}
 
 int c4_FormatX::DoCompare(const c4_Bytes &b1_, const c4_Bytes &b2_) {
   return c4_ColOfInts::DoCompare(b1_, b2_);
 }
 
+void c4_FormatX::Unpack() {
+  d4_assert(_isPacked);
+  _isPacked = false;
+
+  int rows = _data.RowCount();
+  d4_assert(rows == _packed.RowCount());
+
+  if (_packed.ItemSize() > (int)sizeof(t4_i32)) {
+    // wide columns have a fixed size, allocate it all at once
+    _data.InsertData(0, rows *_packed.ItemSize(), true);
+    _data.SetRowCount(rows);
+  }
+
+  for (int i = 0; i < rows; ++i) {
+    int n;
+    const void *p = _packed.Get(i, n);
+    _data.Set(i, c4_Bytes(p, n));
+  }
+}
+
 void c4_FormatX::Commit(c4_SaveContext &ar_) {
+  _zones.Commit(ar_);
+
+  // repack only when changed, else keep whichever form is current
+  if (_recalc) {
+    _data.FixSize(true);
+    if (!_packed.Encode(_data))
+      _packed.SetBuffer(0);
+  }
+
+  if (_packed.ColSize() > 0) {
+    ar_.StoreMarker(kPackedMarker);
+    ar_.CommitColumn(_packed);
+
+    // once written to file (2nd pass), the unpacked copy is no longer needed
+    if (!ar_.Serializing() && !_packed.IsDirty()) {
+      int rows = _data.RowCount();
+      _data.SetBuffer(0);
+      _data.SetRowCount(rows);
+
+      _isPacked = true;
+      _recalc = false;
+    }
+    return ;
+  }
+
   _data.FixSize(true);
-  ar_.CommitColumn(_data);
+
+  // large arrays of plain values are aligned, so they can be used in place
+  int align = _data.IsNative(8) ? 8 : _data.IsNative(4) ? 4 : 1;
+  ar_.CommitColumn(_data, _data.ColSize() >= c4_Column::kSegMax ? align : 1);
   //_data.FixSize(false);
+
+  if (!ar_.Serializing() && !_data.IsDirty())
+    _recalc = false;
 }
 
 void c4_FormatX::Define(int rows_, const t4_byte **ptr_) {
-  if (ptr_ != 0)
-    _data.PullLocation(*ptr_);
+  _isPacked = false;
+  _recalc = false;
+  _packed.Forget();
+  _zones.Define(rows_, ptr_);
+
+  if (ptr_ != 0) {
+    // peek ahead: a negative value can only be the packed column marker
+    const t4_byte *p =  *ptr_;
+    if (c4_Column::PullValue(p) == kPackedMarker) {
+      _packed.PullLocation(p);
+      *ptr_ = p;
+
+      _isPacked = _packed.ColSize() > 0;
+      d4_assert(_packed.RowCount() == rows_);
+    } else
+      _data.PullLocation(*ptr_);
+  }
 
   _data.SetRowCount(rows_);
 }
@@ -96,6 +615,7 @@ void c4_FormatX::Define(int rows_, const t4_byte **ptr_) {
 void c4_FormatX::OldDefine(char, c4_Persist &pers_) {
   pers_.FetchOldLocation(_data);
   _data.SetRowCount(Owner().NumRows());
+  _zones.Define(Owner().NumRows(), 0);
 }
 
 void c4_FormatX::FlipBytes() {
@@ -103,27 +623,109 @@ void c4_FormatX::FlipBytes() {
 }
 
 int c4_FormatX::ItemSize(int index_) {
-  return _data.ItemSize(index_);
+  return _isPacked ? _packed.ItemSize(): _data.ItemSize(index_);
 }
 
 const void *c4_FormatX::Get(int index_, int &length_) {
-  return _data.Get(index_, length_);
+  return _isPacked ? _packed.Get(index_, length_): _data.Get(index_, length_);
 }
 
 void c4_FormatX::Set(int index_, const c4_Bytes &buf_) {
+  if (_isPacked)
+    Unpack();
+  _recalc = true;
+
+  _zones.Set(index_, buf_);
   _data.Set(index_, buf_);
 }
 
+bool c4_FormatX::GetZone(int index_, int &limit_, c4_Bytes &min_, c4_Bytes
+  &max_) {
+  return _zones.Lookup(index_, limit_, min_, max_);
+}
+
 void c4_FormatX::Insert(int index_, const c4_Bytes &buf_, int count_) {
+  if (_isPacked)
+    Unpack();
+  _recalc = true;
+
   _data.Insert(index_, buf_, count_);
+  _zones.Insert(index_, buf_, count_);
+}
+
+void c4_FormatX::InsertFrom(int index_, c4_Handler &src_, int count_, const
+  t4_i32 *rows_) {
+  c4_Bytes data;
+  ClearBytes(data);
+  Insert(index_, data, count_);
+
+  int i;
+
+  // ints are stored in as few bits as possible, and all of them have to be
+  // expanded each time a wider value comes along: store the widest first,
+  // fetching each value only once
+  if (Property().Type() == 'I') {
+    c4_Bytes temp;
+    t4_i32 *vals = (t4_i32*)temp.SetBuffer(count_ *sizeof(t4_i32));
+
+    int w =  - 1;
+    t4_i32 widest = 0;
+    for (i = 0; i < count_; ++i) {
+      int n;
+      t4_i32 v = vals[i] = *(const t4_i32*)src_.Get(rows_ != 0 ? rows_[i] : i,
+        n);
+      d4_assert(n == sizeof(t4_i32));
+      if (v < 0)
+        v = ~v | 16; // negative values take at least 8 bits
+      if (v > widest) {
+        widest = v;
+        w = i;
+      }
+    }
+    if (w >= 0)
+      _data.Set(index_ + w, c4_Bytes(vals + w, sizeof(t4_i32)));
+
+    // store directly, the zones of all new rows are recalculated when used
+    _data.SetInts(index_, vals, count_);
+  } else
+    for (i = 0; i < count_; ++i) {
+      int n;
+      const void *p = src_.Get(rows_ != 0 ? rows_[i] : i, n);
+      _data.Set(index_ + i, c4_Bytes(p, n));
+    }
+
+  _zones.Changed(index_);
 }
 
 void c4_FormatX::Remove(int index_, int count_) {
+  if (_isPacked)
+    Unpack();
+  _recalc = true;
+
   _data.Remove(index_, count_);
+  _zones.Remove(index_, count_);
 }
 
 void c4_FormatX::Unmapped() {
   _data.ReleaseAllSegments();
+  _packed.ReleaseAllSegments();
+  _zones.Unmapped();
+}
+
+void c4_FormatX::Advise(int how_) {
+  _data.Advise(how_);
+  _packed.Advise(how_);
+}
+
+const void *c4_FormatX::SharedData(int count_, int width_) {
+  if (_isPacked || !_data.IsNative(width_) || _data.ColSize() != (t4_i32)
+    count_ *width_)
+    return 0;
+
+  // only columns of kSegMax bytes or more are aligned when committed, and
+  // older files are not aligned at all: never return an unaligned pointer
+  const t4_byte *p = _data.MappedData();
+  return p != 0 && ((size_t)p &(width_ - 1)) == 0 ? p : 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -259,17 +861,25 @@ class c4_FormatB: public c4_FormatHandler {
     virtual void Set(int index_, const c4_Bytes &buf_);
 
     virtual void Insert(int index_, const c4_Bytes &buf_, int count_);
+    virtual void InsertFrom(int index_, c4_Handler &src_, int count_, const
+      t4_i32 *rows_);
     virtual void Remove(int index_, int count_);
 
     virtual c4_Column *GetNthMemoCol(int index_, bool alloc_);
 
     virtual void Unmapped();
+    virtual void Advise(int how_);
 
     static int DoCompare(const c4_Bytes &b1_, const c4_Bytes &b2_);
 
   protected:
     const void *GetOne(int index_, int &length_);
     void SetOne(int index_, const c4_Bytes &buf_, bool ignoreMemos_ = false);
+    void InsertItems(int index_, c4_Handler &src_, int count_, const t4_i32
+      *rows_, bool strings_);
+    void Forget();
+
+    bool _recalc; // 2001-11-27: remember when to redo _{size,memo}Col
 
   private:
     t4_i32 Offset(int index_)const;
@@ -283,14 +893,13 @@ class c4_FormatB: public c4_FormatHandler {
     c4_Column _memoCol; // 2001-11-27: keep, to track position on disk
     c4_DWordArray _offsets;
     c4_PtrArray _memos;
-    bool _recalc; // 2001-11-27: remember when to redo _{size,memo}Col
 };
 
 /////////////////////////////////////////////////////////////////////////////
 
 c4_FormatB::c4_FormatB(const c4_Property &prop_, c4_HandlerSeq &seq_):
-  c4_FormatHandler(prop_, seq_), _data(seq_.Persist()), _sizeCol(seq_.Persist())
-  , _memoCol(seq_.Persist()), _recalc(false) {
+  c4_FormatHandler(prop_, seq_), _recalc(false), _data(seq_.Persist()),
+  _sizeCol(seq_.Persist()), _memoCol(seq_.Persist()) {
   _offsets.SetSize(1, 100);
   _offsets.SetAt(0, 0);
 }
@@ -370,6 +979,23 @@ c4_Column *c4_FormatB::GetNthMemoCol(int index_, bool alloc_) {
   return col;
 }
 
+// drop all rows, used when the data is being kept elsewhere for a while
+void c4_FormatB::Forget() {
+  for (int i = 0; i < _memos.GetSize(); ++i)
+    delete (c4_Column*)_memos.GetAt(i);
+  _memos.SetSize(0);
+
+  _offsets.SetSize(1);
+  _offsets.SetAt(0, 0);
+
+  _data.SetBuffer(0);
+  _sizeCol.SetBuffer(0);
+  _sizeCol.SetRowCount(0);
+  _memoCol.SetBuffer(0);
+
+  _recalc = false;
+}
+
 void c4_FormatB::Unmapped() {
   _data.ReleaseAllSegments();
   _sizeCol.ReleaseAllSegments();
@@ -382,6 +1008,13 @@ void c4_FormatB::Unmapped() {
   }
 }
 
+void c4_FormatB::Advise(int how_) {
+  // large items have a column of their own, those are left alone
+  _data.Advise(how_);
+  _sizeCol.Advise(how_);
+  _memoCol.Advise(how_);
+}
+
 void c4_FormatB::Define(int, const t4_byte **ptr_) {
   d4_assert(_memos.GetSize() == 0);
 
@@ -700,6 +1333,49 @@ void c4_FormatB::Insert(int index_, const c4_Bytes &buf_, int count_) {
   d4_assert(index_ <= _memos.GetSize() + 1);
 }
 
+void c4_FormatB::InsertFrom(int index_, c4_Handler &src_, int count_, const
+  t4_i32 *rows_) {
+  InsertItems(index_, src_, count_, rows_, false);
+}
+
+/*
+ *  Unlike a Set per item, this adjusts the offsets of the following items
+ *  only once, and grows the data column at steadily increasing positions,
+ *  which its gap handles without moving anything else.  Empty strings are
+ *  stored without data, as in c4_FormatS::Set.
+ */
+
+void c4_FormatB::InsertItems(int index_, c4_Handler &src_, int count_, const
+  t4_i32 *rows_, bool strings_) {
+  d4_assert(count_ > 0);
+
+  _recalc = true;
+
+  t4_i32 off = Offset(index_);
+  t4_i32 pos = off;
+
+  _memos.InsertAt(index_, 0, count_);
+  _offsets.InsertAt(index_, 0, count_);
+
+  for (int i = 0; i < count_; ++i) {
+    _offsets.SetAt(index_ + i, pos);
+
+    int n;
+    const void *p = src_.Get(rows_ != 0 ? rows_[i] : i, n);
+    if (n > 0 && !(strings_ && n == 1)) {
+      _data.Grow(pos, n);
+      _data.StoreBytes(pos, c4_Bytes(p, n));
+      pos += n;
+    }
+  }
+
+  // adjust all following entries
+  for (int j = index_ + count_; j < _offsets.GetSize(); ++j)
+    _offsets.ElementAt(j) += pos - off;
+
+  d4_assert((t4_i32)_offsets.GetAt(_offsets.GetSize() - 1) == _data.ColSize());
+}
+
 void c4_FormatB::Remove(int index_, int count_) {
   _recalc = true;
 
@@ -817,30 +1493,352 @@ void c4_FormatB::Commit(c4_SaveContext &ar_) {
 
 /////////////////////////////////////////////////////////////////////////////
 
+/*
+String columns with few distinct values can be stored as a dictionary with
+one copy of each distinct string, plus a column of small ints with the index
+of the string in each row.  This is chosen on commit, when the dictionary
+and its codes save at least a quarter of the space of the plain layout.
+As with packed ints, a negative marker flags this case in the walk.
+
+While dictionary-encoded, the base class holds no rows at all.  The first
+change expands all values back into it, and the next commit re-evaluates.
+Comparisons against a string which is also in the dictionary are done on
+the codes, using the sort rank of each dictionary entry.
+ */
+
 class c4_FormatS: public c4_FormatB {
   public:
     c4_FormatS(const c4_Property &prop_, c4_HandlerSeq &seq_);
 
+    virtual void Define(int, const t4_byte **);
+    virtual void Commit(c4_SaveContext &ar_);
+
     virtual int ItemSize(int index_);
     virtual const void *Get(int index_, int &length_);
     virtual void Set(int index_, const c4_Bytes &buf_);
+    virtual int Compare(int index_, const c4_Bytes &buf_);
+    virtual bool GetZone(int index_, int &limit_, c4_Bytes &min_, c4_Bytes
+      &max_);
 
     virtual void Insert(int index_, const c4_Bytes &buf_, int count_);
+    virtual void InsertFrom(int index_, c4_Handler &src_, int count_, const
+      t4_i32 *rows_);
+    virtual void Remove(int index_, int count_);
+
+    virtual c4_Column *GetNthMemoCol(int index_, bool alloc_);
+
+    virtual void Unmapped();
+    virtual void Advise(int how_);
 
     static int DoCompare(const c4_Bytes &b1_, const c4_Bytes &b2_);
+
+    enum {
+        kMinRows = 64, kMaxLength = 100
+    };
+
+  private:
+    bool Encode();
+    void Unpack();
+
+    int FindCode(const char *str_, int length_, t4_i32 hash_)const;
+    int AddCode(const char *str_, t4_i32 hash_);
+    void HashCodes();
+    void RankCodes();
+
+    c4_Column _dict; // each distinct string, with its null byte
+    c4_ColOfInts _codes; // dictionary index of each row
+    c4_StringArray _strings; // in-memory copy of the dictionary
+    c4_DWordArray _hashes; // hash of each code, checked before the string
+    c4_DWordArray _slots; // open hash table, holds code + 1, or 0
+    c4_DWordArray _ranks; // sort position of each code, filled in on use
+    bool _isDict; // true if the values are only available as codes
+    c4_Bytes _probe; // last value looked up by Compare, or empty
+    int _probeCode; // code of _probe, or -1 if not in the dictionary
+    c4_ZoneMap _zones;
 };
 
 /////////////////////////////////////////////////////////////////////////////
 
+static const t4_i32 kDictMarker =  - 1;
+
+typedef uint32_t t4_u32; // hashes wrap around modulo 2^32
+
+static t4_i32 fHashString(const char *str_, int length_) {
+  t4_u32 h = 0;
+  while (--length_ >= 0)
+    h = (h *31) ^ (t4_byte) *str_++;
+  return (t4_i32)h;
+}
+
 c4_FormatS::c4_FormatS(const c4_Property &prop_, c4_HandlerSeq &seq_):
-  c4_FormatB(prop_, seq_){}
+  c4_FormatB(prop_, seq_), _dict(seq_.Persist()), _codes(seq_.Persist()),
+  _isDict(false), _probeCode( - 1), _zones(*this, seq_.Persist()){}
+
+int c4_FormatS::FindCode(const char *str_, int length_, t4_i32 hash_)const {
+  int mask = _slots.GetSize() - 1;
+  if (mask < 0)
+    return  - 1;
+
+  for (int i = hash_ &mask;; i = (i + 1) &mask) {
+    int code = (int)_slots.GetAt(i) - 1;
+    if (code < 0)
+      return  - 1;
+
+    // only compare the strings themselves if their hashes are the same
+    if (_hashes.GetAt(code) != hash_)
+      continue;
+
+    const char *s = _strings.GetAt(code);
+    if (strncmp(s, str_, length_) == 0 && s[length_] == 0)
+      return code;
+  }
+}
+
+int c4_FormatS::AddCode(const char *str_, t4_i32 hash_) {
+  int n = _strings.Add(str_);
+  _hashes.Add(hash_);
+
+  if (2 *(n + 1) >= _slots.GetSize())
+    HashCodes();
+  else {
+    int mask = _slots.GetSize() - 1;
+    int i = hash_ &mask;
+    while (_slots.GetAt(i) != 0)
+      i = (i + 1) &mask;
+    _slots.SetAt(i, n + 1);
+  }
+
+  return n;
+}
+
+void c4_FormatS::HashCodes() {
+  int n = _strings.GetSize();
+
+  int size = 16;
+  while (size < 4 *n)
+    size <<= 1;
+
+  _slots.SetSize(0);
+  _slots.InsertAt(0, 0, size);
+
+  for (int code = 0; code < n; ++code) {
+    int i = _hashes.GetAt(code) &(size - 1);
+    while (_slots.GetAt(i) != 0)
+      i = (i + 1) &(size - 1);
+    _slots.SetAt(i, code + 1);
+  }
+}
+
+// ranks must be in the same order as DoCompare, so use the same comparison
+static int fCompareNoCase(const char *p1_, const char *p2_) {
+  return c4_String(p1_).CompareNoCase(p2_);
+}
+
+void c4_FormatS::RankCodes() {
+  int n = _strings.GetSize();
+
+  // sort codes with a simple bottom-up merge sort, dictionaries are small
+  c4_DWordArray order, temp;
+  order.SetSize(n);
+  temp.SetSize(n);
+
+  int i;
+  for (i = 0; i < n; ++i)
+    order.SetAt(i, i);
+
+  for (int w = 1; w < n; w <<= 1) {
+    for (int lo = 0; lo < n; lo += 2 * w) {
+      int mid = lo + w < n ? lo + w : n;
+      int hi = lo + 2 * w < n ? lo + 2 * w : n;
+
+      int a = lo, b = mid, k = lo;
+      while (a < mid && b < hi)
+        if (fCompareNoCase(_strings.GetAt((int)order.GetAt(b)), _strings.GetAt
+          ((int)order.GetAt(a))) < 0)
+          temp.SetAt(k++, order.GetAt(b++));
+        else
+          temp.SetAt(k++, order.GetAt(a++));
+      while (a < mid)
+        temp.SetAt(k++, order.GetAt(a++));
+      while (b < hi)
+        temp.SetAt(k++, order.GetAt(b++));
+    }
+
+    for (i = 0; i < n; ++i)
+      order.SetAt(i, temp.GetAt(i));
+  }
+
+  // strings which only differ in case get the same rank
+  _ranks.SetSize(n);
+  for (i = 0; i < n; ++i) {
+    int code = (int)order.GetAt(i);
+    int prev = i > 0 ? (int)order.GetAt(i - 1): code;
+    bool same = i > 0 && fCompareNoCase(_strings.GetAt(prev), _strings.GetAt
+      (code)) == 0;
+    _ranks.SetAt(code, same ? _ranks.GetAt(prev): i);
+  }
+}
+
+bool c4_FormatS::Encode() {
+  int rows = Owner().NumRows();
+  if (rows < kMinRows)
+    return false;
+
+  _strings.SetSize(0);
+  _hashes.SetSize(0);
+  _slots.SetSize(0);
+  _ranks.SetSize(0);
+  _probe.SetBuffer(0);
+
+  _codes.SetBuffer(0);
+  _codes.SetRowCount(rows);
+
+  t4_i32 plain = 0, dict = 0;
+  int maxLen = 0;
+
+  for (int r = 0; r < rows; ++r) {
+    int n;
+    const char *s = (const char*)GetOne(r, n);
+    if (n > kMaxLength)
+      return false;
+
+    if (n > 0)
+      --n; // drop the null byte
+    plain += n;
+    if (n > maxLen)
+      maxLen = n;
+
+    t4_i32 hash = fHashString(s, n);
+    int code = FindCode(s, n, hash);
+    if (code < 0) {
+      if (_strings.GetSize() >= rows / 4)
+        return false;
+
+      c4_String str(s, n);
+      code = AddCode(str, hash);
+      dict += n + 1;
+    }
+
+    _codes.SetInt(r, code);
+  }
+
+  _codes.FixSize(true);
+
+  // estimate the plain size, assuming sizes are stored in as few bits as ints
+  int w = maxLen < 2 ? 1 : maxLen < 4 ? 2 : maxLen < 16 ? 4 : 8;
+  plain += ((t4_i32)rows *w + 7) >> 3;
+
+  if (dict + _codes.ColSize() > plain - (plain >> 2))
+    return false;
+
+  c4_Bytes buf;
+  t4_byte *p = buf.SetBuffer(dict);
+  for (int i = 0; i < _strings.GetSize(); ++i) {
+    const char *s = _strings.GetAt(i);
+    int n = strlen(s) + 1;
+    memcpy(p, s, n);
+    p += n;
+  }
+  d4_assert(p == buf.Contents() + dict);
+
+  _dict.SetBuffer(dict);
+  _dict.StoreBytes(0, buf);
+
+  return true;
+}
+
+void c4_FormatS::Unpack() {
+  d4_assert(_isDict);
+  _isDict = false;
+
+  int rows = _codes.RowCount();
+  for (int r = 0; r < rows; ++r) {
+    const char *s = _strings.GetAt(_codes.GetInt(r));
+    int n = strlen(s);
+    c4_FormatB::Insert(r, n > 0 ? c4_Bytes(s, n + 1): c4_Bytes(), 1);
+  }
+
+  _dict.SetBuffer(0);
+  _codes.SetBuffer(0);
+  _codes.SetRowCount(0);
+
+  _strings.SetSize(0);
+  _hashes.SetSize(0);
+  _slots.SetSize(0);
+  _ranks.SetSize(0);
+  _probe.SetBuffer(0);
+}
+
+void c4_FormatS::Define(int rows_, const t4_byte **ptr_) {
+  _zones.Define(rows_, ptr_);
+
+  if (ptr_ != 0) {
+    // peek ahead: a negative value can only be the dictionary marker
+    const t4_byte *p =  *ptr_;
+    if (c4_Column::PullValue(p) == kDictMarker) {
+      _dict.PullLocation(p);
+      _codes.PullLocation(p);
+      _codes.SetRowCount(rows_);
+      *ptr_ = p;
+
+      c4_Bytes buf;
+      const char *s = (const char*)_dict.FetchBytes(0, _dict.ColSize(), buf,
+        false);
+      _probe.SetBuffer(0);
+      for (const char *e = s + _dict.ColSize(); s < e; s += strlen(s) + 1) {
+        _strings.Add(s);
+        _hashes.Add(fHashString(s, strlen(s)));
+      }
+      HashCodes();
+
+      _isDict = true;
+      return ;
+    }
+  }
+
+  c4_FormatB::Define(rows_, ptr_);
+}
+
+void c4_FormatS::Commit(c4_SaveContext &ar_) {
+  _zones.Commit(ar_);
+
+  // only re-evaluate when changed, else keep whichever form is current
+  if (!_isDict && _recalc && !Encode()) {
+    _dict.SetBuffer(0);
+    _codes.SetBuffer(0);
+  }
+
+  if (_dict.ColSize() > 0) {
+    ar_.StoreMarker(kDictMarker);
+    ar_.CommitColumn(_dict);
+    ar_.CommitColumn(_codes);
+
+    // once written to file (2nd pass), the plain data is no longer needed
+    if (!_isDict && !ar_.Serializing() && !_dict.IsDirty()) {
+      Forget();
+      _isDict = true;
+    }
+    return ;
+  }
+
+  c4_FormatB::Commit(ar_);
+}
 
 int c4_FormatS::ItemSize(int index_) {
+  if (_isDict)
+    return strlen(_strings.GetAt(_codes.GetInt(index_)));
+
   int n = c4_FormatB::ItemSize(index_) - 1;
   return n >= 0 ? n : 0;
 }
 
 const void *c4_FormatS::Get(int index_, int &length_) {
+  if (_isDict) {
+    const char *s = _strings.GetAt(_codes.GetInt(index_));
+    length_ = strlen(s) + 1;
+    return s;
+  }
+
   const void *ptr = GetOne(index_, length_);
 
   if (length_ == 0) {
@@ -853,6 +1851,11 @@ const void *c4_FormatS::Get(int index_, int &length_) {
 }
 
 void c4_FormatS::Set(int index_, const c4_Bytes &buf_) {
+  if (_isDict)
+    Unpack();
+
+  _zones.Set(index_, buf_);
+
   int m = buf_.Size();
   if (--m >= 0) {
     d4_assert(buf_.Contents()[m] == 0);
@@ -865,6 +1868,36 @@ void c4_FormatS::Set(int index_, const c4_Bytes &buf_) {
   SetOne(index_, buf_);
 }
 
+int c4_FormatS::Compare(int index_, const c4_Bytes &buf_) {
+  if (_isDict && buf_.Size() > 0) {
+    // the same value is usually compared against many rows, so the lookup
+    // is only done again when it differs from the previous one
+    if (buf_ != _probe) {
+      const char *s = (const char*)buf_.Contents();
+      int n = buf_.Size() - 1;
+      _probe = c4_Bytes(s, buf_.Size(), true);
+      _probeCode = FindCode(s, n, fHashString(s, n));
+    }
+
+    int other = _probeCode;
+    if (other >= 0) {
+      if (_ranks.GetSize() == 0)
+        RankCodes();
+
+      t4_i32 r1 = _ranks.GetAt(_codes.GetInt(index_));
+      t4_i32 r2 = _ranks.GetAt(other);
+      return r1 == r2 ? 0 : r1 < r2 ?  - 1:  + 1;
+    }
+  }
+
+  return c4_FormatB::Compare(index_, buf_);
+}
+
+bool c4_FormatS::GetZone(int index_, int &limit_, c4_Bytes &min_, c4_Bytes
+  &max_) {
+  return _zones.Lookup(index_, limit_, min_, max_);
+}
+
 int c4_FormatS::DoCompare(const c4_Bytes &b1_, const c4_Bytes &b2_) {
   c4_String v1((const char*)b1_.Contents(), b1_.Size());
   c4_String v2((const char*)b2_.Contents(), b2_.Size());
@@ -875,6 +1908,11 @@ int c4_FormatS::DoCompare(const c4_Bytes &b1_, const c4_Bytes &b2_) {
 void c4_FormatS::Insert(int index_, const c4_Bytes &buf_, int count_) {
   d4_assert(count_ > 0);
 
+  if (_isDict)
+    Unpack();
+
+  _zones.Insert(index_, buf_, count_);
+
   int m = buf_.Size();
   if (--m >= 0) {
     d4_assert(buf_.Contents()[m] == 0);
@@ -887,6 +1925,48 @@ void c4_FormatS::Insert(int index_, const c4_Bytes &buf_, int count_) {
   c4_FormatB::Insert(index_, buf_, count_);
 }
 
+void c4_FormatS::InsertFrom(int index_, c4_Handler &src_, int count_, const
+  t4_i32 *rows_) {
+  if (_isDict)
+    Unpack();
+
+  _zones.Insert(index_, c4_Bytes(), count_);
+  _zones.Changed(index_);
+
+  InsertItems(index_, src_, count_, rows_, true);
+}
+
+void c4_FormatS::Remove(int index_, int count_) {
+  if (_isDict)
+    Unpack();
+
+  _zones.Remove(index_, count_);
+
+  c4_FormatB::Remove(index_, count_);
+}
+
+c4_Column *c4_FormatS::GetNthMemoCol(int index_, bool alloc_) {
+  if (_isDict)
+    Unpack();
+
+  return c4_FormatB::GetNthMemoCol(index_, alloc_);
+}
+
+void c4_FormatS::Unmapped() {
+  _dict.ReleaseAllSegments();
+  _codes.ReleaseAllSegments();
+  _zones.Unmapped();
+
+  c4_FormatB::Unmapped();
+}
+
+void c4_FormatS::Advise(int how_) {
+  _dict.Advise(how_);
+  _codes.Advise(how_);
+
+  c4_FormatB::Advise(how_);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 class c4_FormatV: public c4_FormatHandler {
@@ -914,7 +1994,7 @@ class c4_FormatV: public c4_FormatHandler {
 
   private:
     c4_HandlerSeq &At(int index_);
-    void Replace(int index_, c4_HandlerSeq *seq_);
+    void Replace(int index_, c4_Sequence *seq_);
     void SetupAllSubviews();
     void ForgetSubview(int index_);
 
@@ -1041,18 +2121,19 @@ void c4_FormatV::Set(int index_, const c4_Bytes &buf_) {
   if (!_inited)
     SetupAllSubviews();
 
-  c4_HandlerSeq *value = *(c4_HandlerSeq *const*)buf_.Contents();
+  // this can also be a derived view, so don't treat it as a c4_HandlerSeq
+  c4_Sequence *value = *(c4_Sequence *const*)buf_.Contents();
 
-  if (value !=  &At(index_))
+  if (value != (c4_Sequence*) &At(index_))
     Replace(index_, value);
 }
 
-void c4_FormatV::Replace(int index_, c4_HandlerSeq *seq_) {
+void c4_FormatV::Replace(int index_, c4_Sequence *seq_) {
   if (!_inited)
     SetupAllSubviews();
 
   c4_HandlerSeq * &curr = (c4_HandlerSeq * &)_subSeqs.ElementAt(index_);
-  if (seq_ == curr)
+  if (seq_ == (c4_Sequence*)curr)
     return ;
 
   if (curr != 0) {
@@ -1070,25 +2151,11 @@ void c4_FormatV::Replace(int index_, c4_HandlerSeq *seq_) {
     c4_HandlerSeq &t = At(index_);
     d4_assert(t.NumRows() == 0);
 
-    t.Resize(n);
-
-    c4_Bytes data;
-
     // this dest seq has only the persistent handlers
     // and maybe in a different order
-    // create any others we need as temporary properties
-    for (int i = 0; i < seq_->NumHandlers(); ++i) {
-      c4_Handler &h1 = seq_->NthHandler(i);
-
-      int j = t.PropIndex(h1.Property());
-      d4_assert(j >= 0);
-
-      c4_Handler &h2 = t.NthHandler(j);
-
-      for (int k = 0; k < n; ++k)
-        if (seq_->Get(k, h1.PropId(), data))
-          h2.Set(k, data);
-    }
+    // any others we need are created as temporary properties
+    if (n > 0)
+      t.InsertFrom(0,  *seq_);
   }
 }
 
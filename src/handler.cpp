@@ -54,6 +54,18 @@ void c4_Handler::GetBytes(int index_, c4_Bytes &buf_, bool copySmall_) {
   buf_ = c4_Bytes(p, n, copySmall_ && n <= 8);
 }
 
+void c4_Handler::InsertFrom(int index_, c4_Handler &src_, int count_, const
+  t4_i32 *rows_) {
+  c4_Bytes data;
+  ClearBytes(data);
+  Insert(index_, data, count_);
+
+  for (int i = 0; i < count_; ++i) {
+    src_.GetBytes(rows_ != 0 ? rows_[i] : i, data);
+    Set(index_ + i, data);
+  }
+}
+
 void c4_Handler::Move(int from_, int to_) {
   if (from_ != to_) {
     c4_Bytes data;
@@ -195,6 +207,65 @@ void c4_HandlerSeq::SetNumRows(int numRows_) {
   _numRows = numRows_;
 }
 
+/*
+ *  Copying a view in one column at a time is much faster than one row at
+ *  a time: each handler makes room once, and then fills it in sequence
+ *  (a string column used to shift the offsets of all following items, for
+ *  each row).  Views derived from this one would see their rows move while
+ *  being copied, so those, and changes which dependent views must hear
+ *  about right away, are still copied row by row.
+ */
+
+void c4_HandlerSeq::InsertFrom(int index_, c4_Sequence &seq_) {
+  int n = seq_.NumRows();
+  if (n <= 0)
+    return ;
+
+  int i;
+  for (i = 0; i < seq_.NumHandlers(); ++i)
+    if (seq_.HandlerContext(i) == this)
+      break;
+
+  if (&seq_ == this || i < seq_.NumHandlers() || (GetDependencies() &&
+    !DeferChange(index_))) {
+    c4_Sequence::InsertFrom(index_, seq_);
+    return ;
+  }
+
+  // add missing properties before the number of rows changes
+  for (i = 0; i < seq_.NumHandlers(); ++i)
+    PropIndex(seq_.NthHandler(i).Property());
+
+  SetNumRows(NumRows() + n);
+
+  c4_DWordArray rows;
+  const c4_Sequence *context = &seq_;
+
+  for (int j = 0; j < NumHandlers(); ++j) {
+    c4_Handler &h = NthHandler(j);
+
+    int k = seq_.PropIndex(h.PropId());
+    if (k < 0) {
+      c4_Bytes empty;
+      h.ClearBytes(empty);
+      h.Insert(index_, empty, n);
+      continue;
+    }
+
+    // rows of derived views are copied through their row map
+    const c4_Sequence *hc = seq_.HandlerContext(k);
+    if (hc != context) {
+      context = hc;
+      rows.SetSize(n);
+      for (int r = 0; r < n; ++r)
+        rows.SetAt(r, seq_.RemapIndex(r, hc));
+    }
+
+    h.InsertFrom(index_, seq_.NthHandler(k), n, hc != &seq_ ?  &rows.ElementAt
+      (0): 0);
+  }
+}
+
 int c4_HandlerSeq::AddHandler(c4_Handler *handler_) {
   d4_assert(handler_ != 0);
 
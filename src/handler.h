@@ -57,11 +57,17 @@ class c4_Handler {
     virtual void Set(int index_, const c4_Bytes &buf_) = 0;
     //: Stores a new data item at the specified index.
 
-    int Compare(int index_, const c4_Bytes &buf_);
+    virtual int Compare(int index_, const c4_Bytes &buf_);
     //: Compares an entry with a specified data item.
+    virtual bool GetZone(int index_, int &limit_, c4_Bytes &min_, c4_Bytes
+      &max_);
+    //: Returns the bounds of the block of rows containing an entry, if known.
 
     virtual void Insert(int index_, const c4_Bytes &buf_, int count_) = 0;
     //: Inserts 1 or more data items at the specified index.
+    virtual void InsertFrom(int index_, c4_Handler &src_, int count_, const
+      t4_i32 *rows_);
+    //: Inserts copies of items of another handler, mapped by rows_ if set.
     virtual void Remove(int index_, int count_) = 0;
     //: Removes 1 or more data items at the specified index.
     void Move(int from_, int to_);
@@ -75,6 +81,10 @@ class c4_Handler {
 
     virtual void Unmapped();
     //: Make sure this handler stops using file mappings
+    virtual void Advise(int how_);
+    //: Pass on a hint about how the data on file is going to be accessed
+    virtual const void *SharedData(int count_, int width_);
+    //: Return all items in place as a native array, if stored that way
 
     virtual bool HasSubview(int index_);
     //: True if this subview has materialized into an object
@@ -95,6 +105,7 @@ class c4_HandlerSeq: public c4_Sequence {
 
     virtual int NumRows()const;
     virtual void SetNumRows(int);
+    virtual void InsertFrom(int, c4_Sequence &);
 
     virtual int NumHandlers()const;
     virtual c4_Handler &NthHandler(int)const;
@@ -36,6 +36,11 @@ d4_inline int c4_Handler::PropId() const
   return _property.GetId();
 }
 
+d4_inline bool c4_Handler::GetZone(int, int&, c4_Bytes&, c4_Bytes&)
+{
+  return false;
+}
+
 d4_inline c4_Column* c4_Handler::GetNthMemoCol(int, bool alloc_)
 {
   return 0;
@@ -50,6 +55,15 @@ d4_inline void c4_Handler::Unmapped()
 {
 }
 
+d4_inline void c4_Handler::Advise(int)
+{
+}
+
+d4_inline const void* c4_Handler::SharedData(int, int)
+{
+  return 0;
+}
+
 d4_inline bool c4_Handler::HasSubview(int)
 {
   return false;
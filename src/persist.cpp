@@ -18,14 +18,15 @@
 class c4_FileMark {
     enum {
         kStorageFormat = 0x4C4A,  // b0 = 'J', b1 = <4C> (on Intel)
-        kReverseFormat = 0x4A4C  // b0 = <4C>, b1 = 'J'
+        kReverseFormat = 0x4A4C,  // b0 = <4C>, b1 = 'J'
+        kLayoutFlag = 0x40 // b3, set if any column uses a newer layout
     };
 
     t4_byte _data[8];
 
   public:
     c4_FileMark();
-    c4_FileMark(t4_i32 pos_, bool flipped_, bool extend_);
+    c4_FileMark(t4_i32 pos_, bool flipped_, bool extend_, bool layouts_);
     c4_FileMark(t4_i32 pos_, int len_);
 
     t4_i32 Offset()const;
@@ -42,11 +43,14 @@ c4_FileMark::c4_FileMark() {
   d4_assert(sizeof *this == 8);
 }
 
-c4_FileMark::c4_FileMark(t4_i32 pos_, bool flipped_, bool extend_) {
+// older readers reject a header with the layout flag, which is better than
+// misreading columns saved in a layout they don't know, without any error
+c4_FileMark::c4_FileMark(t4_i32 pos_, bool flipped_, bool extend_, bool
+  layouts_) {
   d4_assert(sizeof *this == 8);
   *(short*)_data = flipped_ ? kReverseFormat : kStorageFormat;
   _data[2] = extend_ ? 0x0A : 0x1A;
-  _data[3] = 0;
+  _data[3] = layouts_ ? kLayoutFlag : 0;
   t4_byte *p = _data + 4;
   for (int i = 24; i >= 0; i -= 8)
     *p++ = (t4_byte)(pos_ >> i);
@@ -102,7 +106,7 @@ class c4_Allocator: public c4_DWordArray {
 
     t4_i32 AllocationLimit()const;
 
-    t4_i32 Allocate(t4_i32 len_);
+    t4_i32 Allocate(t4_i32 len_, int align_ = 1);
     void Occupy(t4_i32 pos_, t4_i32 len_);
     void Release(t4_i32 pos_, t4_i32 len_);
     void Dump(const char *str_);
@@ -157,16 +161,22 @@ void c4_Allocator::Initialize(t4_i32 first_) {
   Add(kMaxInt); // ... there is no limit on file size
 }
 
-t4_i32 c4_Allocator::Allocate(t4_i32 len_) {
+t4_i32 c4_Allocator::Allocate(t4_i32 len_, int align_) {
+  d4_assert(align_ > 0 && (align_ &(align_ - 1)) == 0);
+
   // zero arg is ok, it simply returns first allocatable position   
-  for (int i = 2; i < GetSize(); i += 2)
-  if (GetAt(i + 1) >= GetAt(i) + len_) {
-    t4_i32 pos = GetAt(i);
-    if ((t4_i32)GetAt(i + 1) > pos + len_)
-      ElementAt(i) += len_;
-    else
-      RemoveAt(i, 2);
-    return pos;
+  for (int i = 2; i < GetSize(); i += 2) {
+    t4_i32 pos = (GetAt(i) + align_ - 1) &~(t4_i32)(align_ - 1);
+    if ((t4_i32)GetAt(i + 1) >= pos + len_) {
+      if (pos > (t4_i32)GetAt(i))
+        Occupy(pos, len_);
+      // leaves a few free bytes in front
+      else if ((t4_i32)GetAt(i + 1) > pos + len_)
+        ElementAt(i) += len_;
+      else
+        RemoveAt(i, 2);
+      return pos;
+    }
   }
 
   d4_assert(0);
@@ -489,8 +499,8 @@ void c4_Differ::GetRoot(c4_Bytes &buffer_) {
 c4_SaveContext::c4_SaveContext(c4_Strategy &strategy_, bool fullScan_, int
   mode_, c4_Differ *differ_, c4_Allocator *space_): _strategy(strategy_), _walk
   (0), _differ(differ_), _space(space_), _cleanup(0), _nextSpace(0), _preflight
-  (true), _fullScan(fullScan_), _mode(mode_), _nextPosIndex(0), _bufPtr(_buffer)
-  , _curr(_buffer), _limit(_buffer) {
+  (true), _fullScan(fullScan_), _layouts(false), _mode(mode_), _nextPosIndex(0),
+  _bufPtr(_buffer), _curr(_buffer), _limit(_buffer) {
   if (_space == 0)
     _space = _cleanup = d4_new c4_Allocator;
 
@@ -561,6 +571,14 @@ void c4_SaveContext::StoreValue(t4_i32 v_) {
   c4_Column::PushValue(_curr, v_);
 }
 
+void c4_SaveContext::StoreMarker(t4_i32 marker_) {
+  d4_assert(marker_ < 0);
+
+  // the file header gets flagged, see c4_FileMark
+  _layouts = true;
+  StoreValue(marker_);
+}
+
 void c4_SaveContext::SaveIt(c4_HandlerSeq &root_, c4_Allocator **spacePtr_,
   c4_Bytes &rootWalk_) {
   d4_assert(_space != 0);
@@ -666,7 +684,8 @@ void c4_SaveContext::SaveIt(c4_HandlerSeq &root_, c4_Allocator **spacePtr_,
         return ;
     }
 
-    c4_FileMark head(limit + 16-end, _strategy._bytesFlipped, end > 0);
+    c4_FileMark head(limit + 16-end, _strategy._bytesFlipped, end > 0,
+      _layouts);
     _strategy.DataWrite(end, &head, sizeof head);
 
     if (end0 < limit)
@@ -747,7 +766,7 @@ void c4_SaveContext::SaveIt(c4_HandlerSeq &root_, c4_Allocator **spacePtr_,
   if (!_fullScan && (_mode == 1 || end == 0)) {
     _strategy.DataCommit(0);
 
-    c4_FileMark head(end2, _strategy._bytesFlipped, false);
+    c4_FileMark head(end2, _strategy._bytesFlipped, false, _layouts);
     d4_assert(head.IsHeader());
     _strategy.DataWrite(0, &head, sizeof head);
 
@@ -788,7 +807,7 @@ void c4_SaveContext::SaveIt(c4_HandlerSeq &root_, c4_Allocator **spacePtr_,
   }
 }
 
-bool c4_SaveContext::CommitColumn(c4_Column &col_) {
+bool c4_SaveContext::CommitColumn(c4_Column &col_, int align_) {
   bool changed = col_.IsDirty() || _fullScan;
 
   t4_i32 sz = col_.ColSize();
@@ -806,7 +825,7 @@ bool c4_SaveContext::CommitColumn(c4_Column &col_) {
       }
     } else if (_preflight) {
       if (changed)
-        pos = _space->Allocate(sz);
+        pos = _space->Allocate(sz, align_);
 
       _nextSpace->Occupy(pos, sz);
       _newPositions.Add(pos);
@@ -853,7 +872,7 @@ t4_i32 _oldSeek;
 
 c4_Persist::c4_Persist(c4_Strategy &strategy_, bool owned_, int mode_): _space
   (0), _strategy(strategy_), _root(0), _differ(0), _fCommit(0), _mode(mode_),
-  _owned(owned_), _oldBuf(0), _oldCurr(0), _oldLimit(0), _oldSeek( - 1) {
+  _owned(owned_), _zoneMaps(false), _oldBuf(0), _oldCurr(0), _oldLimit(0), _oldSeek( - 1) {
   if (_mode == 1)
     _space = d4_new c4_Allocator;
 }
@@ -887,6 +906,10 @@ c4_Strategy &c4_Persist::Strategy()const {
   return _strategy;
 }
 
+bool c4_Persist::IsReadOnly()const {
+  return _mode == 0;
+}
+
 bool c4_Persist::AutoCommit(bool flag_) {
   bool prev = _fCommit != 0;
   if (flag_)
@@ -901,6 +924,16 @@ void c4_Persist::DoAutoCommit() {
     (this->*_fCommit)(false);
 }
 
+bool c4_Persist::SaveZoneMaps(bool flag_) {
+  bool prev = _zoneMaps;
+  _zoneMaps = flag_;
+  return prev;
+}
+
+bool c4_Persist::SavesZoneMaps()const {
+  return _zoneMaps;
+}
+
 bool c4_Persist::SetAside(c4_Storage &aside_) {
   delete _differ;
   _differ = d4_new c4_Differ(aside_);
@@ -35,6 +35,7 @@ class c4_SaveContext {
 
     bool _preflight;
     bool _fullScan;
+    bool _layouts; // true once a column is saved in a newer layout
     int _mode;
 
     c4_DWordArray _newPositions;
@@ -54,7 +55,9 @@ class c4_SaveContext {
       &rootWalk_);
 
     void StoreValue(t4_i32 v_);
-    bool CommitColumn(c4_Column &col_);
+    void StoreMarker(t4_i32 marker_);
+    //: Stores a negative layout marker, which older readers can't parse.
+    bool CommitColumn(c4_Column &col_, int align_ = 1);
     void CommitSequence(c4_HandlerSeq &seq_, bool selfDesc_);
 
     c4_Column *SetWalkBuffer(c4_Column *walk_);
@@ -79,6 +82,7 @@ class c4_Persist {
     bool(c4_Persist:: *_fCommit)(bool);
     int _mode;
     bool _owned;
+    bool _zoneMaps; // true if zone maps are saved on commit
 
     // used for on-the-fly conversion of old-format datafiles
     t4_byte *_oldBuf;
@@ -95,10 +99,14 @@ class c4_Persist {
     c4_HandlerSeq &Root()const;
     void SetRoot(c4_HandlerSeq *root_);
     c4_Strategy &Strategy()const;
+    bool IsReadOnly()const;
 
     bool AutoCommit(bool = true);
     void DoAutoCommit();
 
+    bool SaveZoneMaps(bool = true);
+    bool SavesZoneMaps()const;
+
     bool SetAside(c4_Storage &aside_);
     c4_Storage *GetAside()const;
 
@@ -121,9 +121,19 @@ c4_HashViewer::c4_HashViewer(c4_Sequence &seq_, int numKeys_, c4_Sequence *map_)
   int poly = GetPoly();
   if (poly == 0 || _map.GetSize() <= _base.GetSize())
     DictResize(_base.GetSize());
+
+  // lookups probe the map at random, reading ahead would only waste I/O
+  c4_Sequence *map = (&_map[0])._seq;
+  for (int i = 0; i < map->NumHandlers(); ++i)
+    map->NthHandler(i).Advise(c4_Strategy::kAdviseRandom);
 }
 
-c4_HashViewer::~c4_HashViewer(){}
+c4_HashViewer::~c4_HashViewer() {
+  // the random access hint sticks to the pages, so take it back
+  c4_Sequence *map = (&_map[0])._seq;
+  for (int i = 0; i < map->NumHandlers(); ++i)
+    map->NthHandler(i).Advise(c4_Strategy::kAdviseNormal);
+}
 
 bool c4_HashViewer::IsUnused(int row_)const {
   c4_RowRef r = _map[row_];
@@ -812,6 +822,7 @@ class c4_OrderedViewer: public c4_CustomViewer {
     virtual bool SetItem(int row_, int col_, const c4_Bytes &buf_);
     virtual bool InsertRows(int pos_, c4_Cursor value_, int count_ = 1);
     virtual bool RemoveRows(int pos_, int count_ = 1);
+    virtual int SelectRows(c4_Cursor low_, c4_Cursor high_, c4_Bytes &rows_);
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -914,6 +925,57 @@ bool c4_OrderedViewer::RemoveRows(int pos_, int count_) {
   return true;
 }
 
+int c4_OrderedViewer::SelectRows(c4_Cursor low_, c4_Cursor high_, c4_Bytes
+  &rows_) {
+  if (_numKeys <= 0)
+    return  - 1;
+
+  // rows are sorted on the first key, so a range on it is a run of rows
+  const int id = _base.NthProperty(0).GetId();
+  int lc = low_._seq->PropIndex(id);
+  int hc = high_._seq->PropIndex(id);
+  if (lc < 0 && hc < 0)
+    return  - 1;
+
+  c4_Bytes buffer;
+  int lo = 0, hi = _base.GetSize();
+
+  if (lc >= 0) {
+    // find the first row which is not below the low value
+    c4_Handler &h = low_._seq->NthHandler(lc);
+    int u = hi;
+    while (lo < u) {
+      int m = (lo + u) / 2;
+      _base.GetItem(m, 0, buffer);
+      if (h.Compare(low_._index, buffer) > 0)
+        lo = m + 1;
+      else
+        u = m;
+    }
+  }
+
+  if (hc >= 0) {
+    // find the first row which is above the high value
+    c4_Handler &h = high_._seq->NthHandler(hc);
+    int l = lo;
+    while (l < hi) {
+      int m = (l + hi) / 2;
+      _base.GetItem(m, 0, buffer);
+      if (h.Compare(high_._index, buffer) >= 0)
+        l = m + 1;
+      else
+        hi = m;
+    }
+  }
+
+  int n = hi > lo ? hi - lo : 0;
+  t4_i32 *p = (t4_i32*)rows_.SetBuffer(n *sizeof(t4_i32));
+  for (int i = 0; i < n; ++i)
+    p[i] = lo + i;
+
+  return 1; // only the first key was used, others must still be checked
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 class c4_IndexedViewer: public c4_CustomViewer {
@@ -1067,6 +1129,468 @@ bool c4_IndexedViewer::RemoveRows(int pos_, int count_) {
 
 /////////////////////////////////////////////////////////////////////////////
 
+class c4_BitmapViewer: public c4_CustomViewer {
+    enum {
+        kChunkBits = 12, kChunkSize = 1 << kChunkBits, kSetBytes = kChunkSize
+          / 8, kMaxArray = kSetBytes / 2
+    };
+
+    c4_View _base;
+    c4_View _map;
+    int _col;
+    c4_IntProp _chunkProp;
+    c4_BytesProp _bitsProp;
+
+    c4_PtrArray _keys; // c4_Bytes*, the distinct values present
+    c4_PtrArray _chunks; // c4_DWordArray*, per value: map row + 1 per chunk
+
+    int FindKey(const c4_Bytes &key_)const;
+    int AddKey(const c4_Bytes &key_);
+    void ClearKeys();
+    void BuildKeys();
+    void CollectRows(int key_, int chunk_, c4_DWordArray &rows_)const;
+    void StoreRows(const c4_Bytes &key_, const c4_DWordArray &rows_);
+    void SetBit(int row_, const c4_Bytes &key_, bool on_);
+    void Shift(int from_, int diff_);
+
+  public:
+    c4_BitmapViewer(c4_Sequence &seq_, c4_Sequence &map_);
+    virtual ~c4_BitmapViewer();
+
+    virtual c4_View GetTemplate();
+    virtual int GetSize();
+    virtual bool GetItem(int row_, int col_, c4_Bytes &buf_);
+    virtual bool SetItem(int row_, int col_, const c4_Bytes &buf_);
+    virtual bool InsertRows(int pos_, c4_Cursor value_, int count_ = 1);
+    virtual bool RemoveRows(int pos_, int count_ = 1);
+    virtual int SelectRows(c4_Cursor low_, c4_Cursor high_, c4_Bytes &rows_);
+};
+
+/////////////////////////////////////////////////////////////////////////////
+/*
+ * The map view holds one row per distinct value and chunk of 4096 rows,
+ * with a container of the rows in that chunk which have this value.  As in
+ * "roaring" bitmaps (Chambi et al, 2016), a container is either a 512-byte
+ * bitset, or a sorted array of 16-bit offsets when it has few entries, so
+ * that rare values stay small while common ones take at most 1/8th of a
+ * byte per row.  Empty containers are never stored.
+ */
+
+static void fDecodeSet(const c4_Bytes &in_, t4_byte *set_, int size_) {
+  memset(set_, 0, size_);
+
+  const t4_byte *p = in_.Contents();
+  if (in_.Size() == size_)
+    memcpy(set_, p, size_);
+  else
+    for (int i = 0; i + 1 < in_.Size(); i += 2) {
+      int n = p[i] | (p[i + 1] << 8);
+      set_[n >> 3] |= 1 << (n &7);
+    }
+}
+
+static void fEncodeSet(const t4_byte *set_, int size_, c4_Bytes &out_) {
+  int count = 0;
+  for (int i = 0; i < size_; ++i)
+    for (int b = set_[i]; b != 0; b &= b - 1)
+      ++count;
+
+  if (count * 2 >= size_) {
+    out_ = c4_Bytes(set_, size_, true);
+    return ;
+  }
+
+  t4_byte *p = out_.SetBuffer(count *2);
+  for (int j = 0; j < size_ *8; ++j)
+    if (set_[j >> 3] &(1 << (j &7))) {
+      *p++ = (t4_byte)j;
+      *p++ = (t4_byte)(j >> 8);
+    }
+}
+
+static void fCopyOtherProps(c4_Cursor cursor_, int id_, c4_Row &row_) {
+  c4_Sequence &seq = *cursor_._seq;
+  c4_Bytes data;
+
+  for (int i = 0; i < seq.NumHandlers(); ++i) {
+    const c4_Property &prop = seq.NthHandler(i).Property();
+    if (prop.GetId() != id_) {
+      seq.Get(cursor_._index, prop.GetId(), data);
+      prop(row_).SetData(data);
+    }
+  }
+}
+
+c4_BitmapViewer::c4_BitmapViewer(c4_Sequence &seq_, c4_Sequence &map_): _base
+  (&seq_), _map(&map_), _col( - 1), _chunkProp("_C"), _bitsProp("_B") {
+  _col = _base.FindProperty(_map.NthProperty(0).GetId());
+  d4_assert(_col >= 0);
+
+  int n = _base.GetSize();
+  if (_map.GetSize() == 0 && n > 0) {
+    // collect the rows of each value, then store them all in one pass
+    c4_PtrArray rows;
+    c4_Bytes buf;
+
+    for (int i = 0; i < n; ++i) {
+      _base.GetItem(i, _col, buf);
+      int k = FindKey(buf);
+      if (k < 0) {
+        k = AddKey(buf);
+        rows.Add(d4_new c4_DWordArray);
+      }
+      ((c4_DWordArray*)rows.GetAt(k))->Add(i);
+    }
+
+    for (int j = 0; j < rows.GetSize(); ++j) {
+      c4_DWordArray *v = (c4_DWordArray*)rows.GetAt(j);
+      StoreRows(*(c4_Bytes*)_keys.GetAt(j),  *v);
+      delete v;
+    }
+  }
+
+  BuildKeys();
+}
+
+c4_BitmapViewer::~c4_BitmapViewer() {
+  ClearKeys();
+}
+
+int c4_BitmapViewer::FindKey(const c4_Bytes &key_)const {
+  for (int k = 0; k < _keys.GetSize(); ++k)
+    if (*(c4_Bytes*)_keys.GetAt(k) == key_)
+      return k;
+
+  return  - 1;
+}
+
+int c4_BitmapViewer::AddKey(const c4_Bytes &key_) {
+  _chunks.Add(d4_new c4_DWordArray);
+  return _keys.Add(d4_new c4_Bytes(key_.Contents(), key_.Size(), key_.Size()
+    > 0));
+}
+
+void c4_BitmapViewer::ClearKeys() {
+  for (int k = 0; k < _keys.GetSize(); ++k) {
+    delete (c4_Bytes*)_keys.GetAt(k);
+    delete (c4_DWordArray*)_chunks.GetAt(k);
+  }
+
+  _keys.SetSize(0);
+  _chunks.SetSize(0);
+}
+
+void c4_BitmapViewer::BuildKeys() {
+  ClearKeys();
+
+  c4_Bytes buf;
+  for (int r = 0; r < _map.GetSize(); ++r) {
+    _map.GetItem(r, 0, buf);
+    int k = FindKey(buf);
+    if (k < 0)
+      k = AddKey(buf);
+
+    c4_DWordArray &a = *(c4_DWordArray*)_chunks.GetAt(k);
+    int c = _chunkProp(_map[r]);
+    if (c >= a.GetSize())
+      a.InsertAt(a.GetSize(), 0, c + 1-a.GetSize());
+    a.SetAt(c, r + 1);
+  }
+}
+
+void c4_BitmapViewer::CollectRows(int key_, int chunk_, c4_DWordArray &rows_)
+  const {
+  const c4_DWordArray &a = *(c4_DWordArray*)_chunks.GetAt(key_);
+  t4_byte set[kSetBytes];
+
+  for (int c = chunk_; c < a.GetSize(); ++c) {
+    int r = a.GetAt(c) - 1;
+    if (r >= 0) {
+      c4_Bytes bits = _bitsProp(_map[r]);
+      fDecodeSet(bits, set, kSetBytes);
+
+      for (int i = 0; i < kChunkSize; ++i)
+        if (set[i >> 3] &(1 << (i &7)))
+          rows_.Add((c << kChunkBits) + i);
+    }
+  }
+}
+
+void c4_BitmapViewer::StoreRows(const c4_Bytes &key_, const c4_DWordArray
+  &rows_) {
+  t4_byte set[kSetBytes];
+
+  int i = 0;
+  while (i < rows_.GetSize()) {
+    int c = rows_.GetAt(i) >> kChunkBits;
+
+    memset(set, 0, kSetBytes);
+    for (; i < rows_.GetSize() && (rows_.GetAt(i) >> kChunkBits) == c; ++i) {
+      int n = rows_.GetAt(i) &(kChunkSize - 1);
+      set[n >> 3] |= 1 << (n &7);
+    }
+
+    c4_Bytes bits;
+    fEncodeSet(set, kSetBytes, bits);
+
+    int r = _map.Add(c4_Row());
+    _map.SetItem(r, 0, key_);
+    _chunkProp(_map[r]) = c;
+    _bitsProp(_map[r]) = bits;
+  }
+}
+
+void c4_BitmapViewer::SetBit(int row_, const c4_Bytes &key_, bool on_) {
+  int k = FindKey(key_);
+  if (k < 0) {
+    if (!on_)
+      return ;
+    k = AddKey(key_);
+  }
+
+  c4_DWordArray &a = *(c4_DWordArray*)_chunks.GetAt(k);
+  int c = row_ >> kChunkBits;
+  int r = c < a.GetSize() ? (int)a.GetAt(c) - 1:  - 1;
+
+  t4_byte set[kSetBytes];
+  if (r >= 0) {
+    c4_Bytes bits = _bitsProp(_map[r]);
+    fDecodeSet(bits, set, kSetBytes);
+  } else
+    memset(set, 0, kSetBytes);
+
+  int n = row_ &(kChunkSize - 1);
+  if (on_)
+    set[n >> 3] |= 1 << (n &7);
+  else
+    set[n >> 3] &= ~(1 << (n &7));
+
+  c4_Bytes bits;
+  fEncodeSet(set, kSetBytes, bits);
+
+  if (bits.Size() == 0) {
+    if (r >= 0) {
+      _map.RemoveAt(r);
+      BuildKeys(); // map rows have been renumbered
+    }
+  } else if (r >= 0)
+    _bitsProp(_map[r]) = bits;
+  else {
+    r = _map.Add(c4_Row());
+    _map.SetItem(r, 0, *(c4_Bytes*)_keys.GetAt(k));
+    _chunkProp(_map[r]) = c;
+    _bitsProp(_map[r]) = bits;
+
+    if (c >= a.GetSize())
+      a.InsertAt(a.GetSize(), 0, c + 1-a.GetSize());
+    a.SetAt(c, r + 1);
+  }
+}
+
+void c4_BitmapViewer::Shift(int from_, int diff_) {
+  // renumber all rows at or past from_, rebuilding affected containers
+  // this touches every container past the change, since each of their bits
+  // moves, so inserts and deletes take O(n) time unless done at the end
+  int first = (diff_ < 0 ? from_ + diff_ : from_) >> kChunkBits;
+
+  c4_PtrArray rows;
+  for (int k = 0; k < _keys.GetSize(); ++k) {
+    c4_DWordArray *v = d4_new c4_DWordArray;
+    CollectRows(k, first, *v);
+
+    for (int i = 0; i < v->GetSize(); ++i)
+      if ((int)v->GetAt(i) >= from_)
+        v->SetAt(i, v->GetAt(i) + diff_);
+
+    rows.Add(v);
+  }
+
+  for (int r = _map.GetSize(); --r >= 0;)
+    if (_chunkProp(_map[r]) >= first)
+      _map.RemoveAt(r);
+
+  for (int j = 0; j < rows.GetSize(); ++j) {
+    c4_DWordArray *v = (c4_DWordArray*)rows.GetAt(j);
+    StoreRows(*(c4_Bytes*)_keys.GetAt(j),  *v);
+    delete v;
+  }
+
+  BuildKeys();
+}
+
+c4_View c4_BitmapViewer::GetTemplate() {
+  return _base.Clone();
+}
+
+int c4_BitmapViewer::GetSize() {
+  return _base.GetSize();
+}
+
+bool c4_BitmapViewer::GetItem(int row_, int col_, c4_Bytes &buf_) {
+  return _base.GetItem(row_, col_, buf_);
+}
+
+bool c4_BitmapViewer::SetItem(int row_, int col_, const c4_Bytes &buf_) {
+  if (col_ != _col) {
+    _base.SetItem(row_, col_, buf_);
+    return true;
+  }
+
+  c4_Bytes temp;
+  _base.GetItem(row_, col_, temp);
+  if (buf_ == temp)
+    return true;
+  // this call will have no effect, just ignore it
+
+  c4_Bytes old(temp.Contents(), temp.Size(), temp.Size() > 0);
+  SetBit(row_, old, false);
+
+  _base.SetItem(row_, col_, buf_);
+
+  _base.GetItem(row_, col_, temp);
+  SetBit(row_, temp, true);
+
+  return true;
+}
+
+bool c4_BitmapViewer::InsertRows(int pos_, c4_Cursor value_, int count_) {
+  d4_assert(count_ > 0);
+
+  bool atEnd = pos_ >= _base.GetSize();
+  _base.InsertAt(pos_,  *value_, count_);
+
+  if (!atEnd)
+    Shift(pos_, count_);
+
+  c4_Bytes buf;
+  _base.GetItem(pos_, _col, buf);
+  c4_Bytes key(buf.Contents(), buf.Size(), buf.Size() > 0);
+
+  for (int i = 0; i < count_; ++i)
+    SetBit(pos_ + i, key, true);
+
+  return true;
+}
+
+bool c4_BitmapViewer::RemoveRows(int pos_, int count_) {
+  d4_assert(count_ > 0);
+  d4_assert(pos_ + count_ <= _base.GetSize());
+
+  c4_Bytes buf;
+  for (int i = 0; i < count_; ++i) {
+    _base.GetItem(pos_ + i, _col, buf);
+    c4_Bytes key(buf.Contents(), buf.Size(), buf.Size() > 0);
+    SetBit(pos_ + i, key, false);
+  }
+
+  bool atEnd = pos_ + count_ >= _base.GetSize();
+  _base.RemoveAt(pos_, count_);
+
+  if (!atEnd)
+    Shift(pos_ + count_,  - count_);
+
+  return true;
+}
+
+int c4_BitmapViewer::SelectRows(c4_Cursor low_, c4_Cursor high_, c4_Bytes
+  &rows_) {
+  const int id = _base.NthProperty(_col).GetId();
+  int lc = low_._seq->PropIndex(id);
+  int hc = high_._seq->PropIndex(id);
+
+  // let stacked bitmap views narrow down the rows first, but leave this
+  // property out, so that another bitmap on it does not count it twice
+  c4_Bytes known;
+  c4_Row low, high;
+  fCopyOtherProps(low_, id, low);
+  fCopyOtherProps(high_, id, high);
+  int used = _base.RestrictSelect(low, high, known);
+
+  if (lc < 0 && hc < 0) {
+    rows_.Swap(known);
+    return used;
+  }
+
+  // flag each value which lies in range
+  int nk = _keys.GetSize(), hits = 0;
+  c4_Bytes flagBuf;
+  t4_byte *flags = flagBuf.SetBufferClear(nk + 1);
+
+  for (int k = 0; k < nk; ++k) {
+    const c4_Bytes &key = *(c4_Bytes*)_keys.GetAt(k);
+    if (lc >= 0 && low_._seq->NthHandler(lc).Compare(low_._index, key) > 0)
+      continue;
+    if (hc >= 0 && high_._seq->NthHandler(hc).Compare(high_._index, key) < 0)
+      continue;
+    flags[k] = 1;
+    ++hits;
+  }
+
+  // OR the containers of all values in range, or when that is most of
+  // them: OR the ones out of range and invert the result (every row has
+  // exactly one value, so this gives the same set with fewer containers)
+  const bool invert = hits *2 > nk;
+  const int n = _base.GetSize();
+  const int nc = (n + kChunkSize - 1) >> kChunkBits;
+
+  c4_DWordArray result;
+  t4_byte set[kSetBytes], temp[kSetBytes];
+
+  for (int c = 0; c < nc; ++c) {
+    memset(set, 0, kSetBytes);
+
+    for (int k = 0; k < nk; ++k)
+      if (flags[k] != invert) {
+        const c4_DWordArray &a = *(c4_DWordArray*)_chunks.GetAt(k);
+        int r = c < a.GetSize() ? (int)a.GetAt(c) - 1:  - 1;
+        if (r >= 0) {
+          c4_Bytes bits = _bitsProp(_map[r]);
+          fDecodeSet(bits, temp, kSetBytes);
+          for (int i = 0; i < kSetBytes; ++i)
+            set[i] |= temp[i];
+        }
+      }
+
+    int base = c << kChunkBits;
+    int limit = n - base < kChunkSize ? n - base : kChunkSize;
+
+    for (int i = 0; i < limit; i += 8) {
+      int b = invert ? (t4_byte)~set[i >> 3]: set[i >> 3];
+      for (int j = i; b != 0; ++j, b >>= 1)
+        if ((b &1) && j < limit)
+          result.Add(base + j);
+    }
+  }
+
+  // AND with whatever the underlying view already determined
+  int m = result.GetSize();
+  if (used >= 0) {
+    const t4_i32 *p = (const t4_i32*)known.Contents();
+    int np = known.Size() / sizeof(t4_i32);
+    int i = 0, j = 0;
+
+    m = 0;
+    while (i < result.GetSize() && j < np)
+      if ((t4_i32)result.GetAt(i) < p[j])
+        ++i;
+      else if ((t4_i32)result.GetAt(i) > p[j])
+        ++j;
+      else {
+        result.SetAt(m++, p[j]);
+        ++i;
+        ++j;
+      }
+  }
+
+  t4_i32 *out = (t4_i32*)rows_.SetBuffer(m *sizeof(t4_i32));
+  for (int r = 0; r < m; ++r)
+    out[r] = result.GetAt(r);
+
+  return (used >= 0 ? used : 0) + 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 c4_CustomViewer *f4_CreateReadOnly(c4_Sequence &seq_) {
   return d4_new c4_ReadOnlyViewer(seq_);
 }
@@ -1088,4 +1612,8 @@ c4_CustomViewer *f4_CreateIndexed(c4_Sequence &seq_, c4_Sequence &map_, const
   return d4_new c4_IndexedViewer(seq_, map_, props_, unique_);
 }
 
+c4_CustomViewer *f4_CreateBitmap(c4_Sequence &seq_, c4_Sequence &map_) {
+  return d4_new c4_BitmapViewer(seq_, map_);
+}
+
 /////////////////////////////////////////////////////////////////////////////
@@ -20,6 +20,7 @@ extern c4_CustomViewer *f4_CreateBlocked(c4_Sequence &);
 extern c4_CustomViewer *f4_CreateOrdered(c4_Sequence &, int);
 extern c4_CustomViewer *f4_CreateIndexed(c4_Sequence &, c4_Sequence &, const
   c4_View &, bool = false);
+extern c4_CustomViewer *f4_CreateBitmap(c4_Sequence &, c4_Sequence &);
 
 /////////////////////////////////////////////////////////////////////////////
 
@@ -11,6 +11,7 @@
 #include "store.h"
 #include "field.h"
 #include "persist.h"
+#include "column.h"   // c4_ColCache
 #include "format.h"   // 19990906
 
 #include "mk4io.h"    // 19991104
@@ -76,6 +77,10 @@ c4_Notifier::~c4_Notifier() {
   d4_assert(!_next);
 }
 
+c4_Sequence *c4_Notifier::Origin()const {
+  return _origin;
+}
+
 void c4_Notifier::StartSetAt(int index_, c4_Cursor &cursor_) {
   _type = kSetAt;
   _index = index_;
@@ -118,6 +123,13 @@ void c4_Notifier::StartSet(int i_, int propId_, const c4_Bytes &buf_) {
   Notify();
 }
 
+void c4_Notifier::StartBulk(int index_) {
+  _type = kBulk;
+  _index = index_;
+
+  Notify();
+}
+
 void c4_Notifier::Notify() {
   d4_assert(_origin->GetDependencies() != 0);
   c4_PtrArray &refs = _origin->GetDependencies()->_refs;
@@ -379,6 +391,17 @@ bool c4_Storage::AutoCommit(bool flag_) {
   return Persist()->AutoCommit(flag_);
 }
 
+/** Set storage up to also save zone maps on commit
+ *
+ * Zone maps are always maintained in memory, and existing ones are used
+ * when a file is opened.  But they are only written if this was set, since
+ * older releases of Metakit can't read files which contain them.
+ * @return the previous setting
+ */
+bool c4_Storage::SaveZoneMaps(bool flag_) {
+  return Persist()->SaveZoneMaps(flag_);
+}
+
 /// Load contents from the specified input stream
 bool c4_Storage::LoadFrom(c4_Stream &stream_) {
   c4_HandlerSeq *newRoot = c4_Persist::Load(&stream_);
@@ -398,6 +421,11 @@ bool c4_Storage::LoadFrom(c4_Stream &stream_) {
 
 /// Save contents to the specified output stream
 void c4_Storage::SaveTo(c4_Stream &stream_) {
+  // all data gets copied, so have it read in ahead of time if it's mapped
+  c4_Strategy &strat = Persist()->Strategy();
+  if (strat._mapStart != 0)
+    strat.DataAdvise(0, strat._dataSize, c4_Strategy::kAdviseWillNeed);
+
   c4_Persist::Save(&stream_, Persist()->Root());
 }
 
@@ -405,6 +433,42 @@ t4_i32 c4_Storage::FreeSpace(t4_i32 *bytes_) {
   return Persist()->FreeBytes(bytes_);
 }
 
+/** Limit the memory used for data of files which are not memory-mapped
+ *
+ * Normally, data which is not memory-mapped is read in one column at a
+ * time and kept in memory until the storage is closed.  With a limit set,
+ * unmodified columns opened from then on are read in 4 Kb segments as
+ * needed, and segments which have not been used recently are dropped
+ * again once the limit is reached.  This limit is shared by all storages,
+ * and it is set to at least 512 Kb.  Use zero to stop caching, which is
+ * the default.  Setting a new limit drops all segments now in the cache
+ * and resets its statistics.  This setting has no effect in builds which
+ * support multi-threading.
+ *
+ * String and bytes values of cached columns are always copied into a
+ * buffer of the view they are fetched from, so a pointer to such a value
+ * only stays valid until the next one is fetched from that same view, not
+ * until the next change as with other columns.
+ */
+void c4_Storage::SetSegmentCache(t4_i32 bytes_  ///< maximum size, or zero
+) {
+  c4_ColCache::SetLimit(bytes_);
+}
+
+/** Return statistics of the segment cache
+ *
+ * The hit rate is hits / (hits + misses).  Counts start from zero each
+ * time SetSegmentCache is called.
+ * @return the number of bytes currently held in the cache
+ */
+t4_i32 c4_Storage::SegmentCacheStats(t4_i64 *hits_,  
+  ///< set to the number of segment accesses which needed no file access
+t4_i64 *misses_,  ///< set to the number of segments read from file
+t4_i64 *evictions_  ///< set to the number of segments dropped again
+) {
+  return c4_ColCache::Stats(hits_, misses_, evictions_);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 c4_DerivedSeq::c4_DerivedSeq(c4_Sequence &seq_): _seq(seq_) {
@@ -470,6 +534,9 @@ c4_Notifier *c4_DerivedSeq::PreChange(c4_Notifier &nf_) {
 
     case c4_Notifier::kMove: chg->StartMove(nf_._index, nf_._count);
     break;
+
+    case c4_Notifier::kBulk: chg->StartBulk(nf_._index);
+    break;
   }
 
   return chg;
@@ -33,19 +33,21 @@ class c4_Notifier {
 
   public:
     enum {
-        kNone, kSetAt, kInsertAt, kRemoveAt, kMove, kSet, kLimit
+        kNone, kSetAt, kInsertAt, kRemoveAt, kMove, kSet, kBulk, kLimit
     };
 
     c4_Notifier(c4_Sequence *origin_);
     ~c4_Notifier();
 
     bool HasDependents()const;
+    c4_Sequence *Origin()const;
 
     void StartSetAt(int index_, c4_Cursor &cursor_);
     void StartInsertAt(int index_, c4_Cursor &cursor_, int count_);
     void StartRemoveAt(int index_, int count_);
     void StartMove(int from_, int to_);
     void StartSet(int index_, int propId_, const c4_Bytes &buf_);
+    void StartBulk(int index_);
 
     int _type;
     int _index;
@@ -14,6 +14,8 @@
 #include "persist.h"
 #include "remap.h"
 
+#include <ctype.h>    // tolower
+
 #if !q4_INLINE
 #include "mk4.inl"
 #endif 
@@ -259,6 +261,75 @@ c4_View c4_View::Duplicate()const {
   return result;
 }
 
+/** Returns a standalone copy of the rows of a derived view
+ *
+ * The results of Select, SortOn, Join, GroupBy, and so on are evaluated
+ * again on each access.  This copies all their values into plain columns,
+ * one column at a time, and the result no longer depends on the original
+ * views.  It can be added to a storage with InsertAt, as any other view.
+ */
+c4_View c4_View::Materialize()const {
+  c4_View result = Clone();
+  if (GetSize() > 0)
+    result._seq->InsertFrom(0,  *_seq);
+  return result;
+}
+
+/** Returns all values of a numeric property as one array
+ *
+ * Int, long, float, and double values are returned as an array of t4_i32,
+ * t4_i64, float, or double, in native byte order.  If they are stored
+ * exactly that way in a memory-mapped file opened read-only, the result
+ * points into the map, and stays valid as long as the storage is open.
+ * Otherwise the values are copied into the buffer.
+ * @return false if the property is absent or not a numeric one
+ */
+bool c4_View::GetColumn(const c4_Property &prop_,  
+  ///< the property to fetch
+c4_Bytes &buf_  ///< receives the values, may refer to the file map
+)const {
+  int width;
+  switch (prop_.Type()) {
+    case 'I':
+    case 'F':
+      width = 4;
+      break;
+    case 'L':
+    case 'D':
+      width = 8;
+      break;
+    default:
+      return false;
+  }
+
+  int col = _seq->PropIndex(prop_.GetId());
+  if (col < 0)
+    return false;
+
+  c4_Handler &h = _seq->NthHandler(col);
+  if (h.Property().Type() != prop_.Type())
+    return false;
+
+  int n = GetSize();
+  const c4_Sequence *context = _seq->HandlerContext(col);
+
+  const void *p = context == _seq ? h.SharedData(n, width): 0;
+  if (p != 0) {
+    buf_ = c4_Bytes(p, n *width);
+    return true;
+  }
+
+  t4_byte *q = buf_.SetBuffer(n *width);
+  for (int i = 0; i < n; ++i) {
+    int len;
+    const void *v = h.Get(_seq->RemapIndex(i, context), len);
+    d4_assert(len == width);
+    memcpy(q + i * width, v, width);
+  }
+
+  return true;
+}
+
 /** Constructs a new view with the same structure but no data
  *
  * Structural information can only be maintain for the top level,
@@ -289,6 +360,8 @@ const c4_Property &c4_View::NthProperty(int index_
   return _seq->NthHandler(index_).Property();
 }
 
+static int fPropIdByName(const char *name_); // see c4_Property
+
 /** Find the index of a property, given its name
  * @return 0-based column index
  * @retval -1 property not present in this view
@@ -296,14 +369,9 @@ const c4_Property &c4_View::NthProperty(int index_
 int c4_View::FindPropIndexByName(const char *name_  
   ///< property name (case insensitive)
 )const {
-  // use a slow linear scan to find the untyped property by name
-  for (int i = 0; i < NumProperties(); ++i) {
-    c4_String s = NthProperty(i).Name();
-    if (s.CompareNoCase(name_) == 0)
-      return i;
-  }
-
-  return  - 1;
+  // names are unique, so this is the same as looking up the property id
+  int id = fPropIdByName(name_);
+  return id >= 0 ? _seq->PropIndex(id):  - 1;
 }
 
 /** Defines a column for a property.
@@ -324,15 +392,43 @@ c4_View c4_View::operator, (const c4_Property &prop_)const {
 
 /// Insert copies of all rows of the specified view
 void c4_View::InsertAt(int index_, const c4_View &view_) {
-  int n = view_.GetSize();
-  if (n > 0) {
-    c4_Row empty;
+  if (view_.GetSize() > 0) {
+    BeginBulk();
+    _seq->InsertFrom(index_,  *view_._seq);
+    EndBulk();
+  }
+}
 
-    InsertAt(index_, empty, n);
+/** Start a batch of changes, deferring updates of dependent views
+ *
+ * Normally, each change to a view immediately adjusts all derived views
+ * which depend on it, such as selections and sorted views.  That is a
+ * lot of work per row when many changes are made in a row.  Between
+ * BeginBulk and EndBulk, these updates are postponed and then applied
+ * once, by re-matching and merging only the rows from the first changed
+ * one on (which for appends means: only the new rows).
+ *
+ * Calls may be nested, updates happen when the outermost EndBulk is
+ * called.  Dependent views must not be accessed before that time.
+ *
+ * Example of use:
+ * @code
+ *  c4_View sorted = data.SortOn(pName);
+ *  data.BeginBulk();
+ *  for (int i = 0; i < 10000; ++i)
+ *    data.Add(...);
+ *  data.EndBulk();
+ *  ... sorted is now up to date again ...
+ * @endcode
+ * @sa EndBulk
+ */
+void c4_View::BeginBulk() {
+  _seq->BeginBulk();
+}
 
-    for (int i = 0; i < n; ++i)
-      SetAt(index_ + i, view_[i]);
-  }
+/// End a batch of changes, and bring all dependent views up to date
+void c4_View::EndBulk() {
+  _seq->EndBulk();
 }
 
 bool c4_View::IsCompatibleWith(const c4_View &dest_)const {
@@ -447,6 +543,59 @@ const c4_View &down_  ///< subset of up_, defines reverse order
   return f4_CreateSort(*seq, down_._seq);
 }
 
+/** Create view with one window of rows in sorted order
+ *
+ * The result has the same rows as "SortOn(up_).Slice(offset_, offset_ +
+ * count_)", but without sorting the entire view first.  Rows are picked
+ * in a single pass when the window is near the start, and with partial
+ * selection for pages deep into the view.  Only the rows in the window
+ * are sorted.  Changes to the underlying view are tracked, and most of
+ * them do not require the window to be selected again.
+ */
+c4_View c4_View::SortTop(const c4_View &up_,  
+  ///< the view which defines the sort order
+int count_,  ///< the maximum number of rows in the result
+int offset_  ///< the number of leading rows to skip
+)const {
+  c4_Sequence *seq = f4_CreateProject(*_seq,  *up_._seq, true);
+
+  return f4_CreateSortTop(*seq, 0, count_, offset_);
+}
+
+/** Create window of sorted rows, with some properties sorted in reverse
+ *
+ * This is the windowed equivalent of SortOnReverse.
+ * @sa SortTop
+ */
+c4_View c4_View::SortTopReverse(const c4_View &up_,  
+  ///< the view which defines the sort order
+const c4_View &down_,  ///< subset of up_, defines reverse order
+int count_,  ///< the maximum number of rows in the result
+int offset_  ///< the number of leading rows to skip
+)const {
+  c4_Sequence *seq = f4_CreateProject(*_seq,  *up_._seq, true);
+
+  return f4_CreateSortTop(*seq, down_._seq, count_, offset_);
+}
+
+/** Create sorted view, using temporary files for views too large to sort
+ *
+ * The result has the same rows as SortOn(up_), but at most about budget_
+ * bytes of memory are used to sort them.  Larger views are sorted in runs
+ * which are merged on disk, and the final row order is read back from a
+ * temporary file as needed.  The sort is done on first access, and again
+ * on the first access after each change to the underlying view, so it is
+ * best to finish all changes before using the result.
+ */
+c4_View c4_View::SortOnExternal(const c4_View &up_,  
+  ///< the view which defines the sort order
+t4_i32 budget_  ///< the number of bytes to use for sorting
+)const {
+  c4_Sequence *seq = f4_CreateProject(*_seq,  *up_._seq, true);
+
+  return f4_CreateSortExternal(*seq, 0, budget_);
+}
+
 /** Create view with rows matching the specified value
  *
  * The result is virtual, it merely maintains a permutation to access the
@@ -474,6 +623,42 @@ const c4_RowRef &high_  ///< values of the upper bounds (inclusive)
   return f4_CreateFilter(*_seq, &low_, &high_);
 }
 
+/** Create view with the rows for which an expression holds
+ *
+ * Unlike the other selections, the criteria can be combined in any way,
+ * using "and", "or", and "not" - see c4_Expr for the comparisons which can
+ * be used.  The expression is evaluated one property at a time, looking
+ * only at rows which can still change the outcome.  Like the other
+ * selections, the result tracks changes to the underlying view.
+ */
+c4_View c4_View::Select(const c4_Expr &expr_  ///< the rows to include
+)const {
+  return f4_CreateExprFilter(*_seq, expr_);
+}
+
+/** Create view which reads through a stack of derived views in one step
+ *
+ * Each row access on a stack of selections, sorts, projections and slices
+ * walks through every layer in turn.  The fused view instead keeps one row
+ * map per underlying view, so that reads go straight to the data.  It has
+ * the same rows and properties as this view, and follows its changes,
+ * rebuilding the row maps on the next access.  Changes made to the fused
+ * view are passed on to this view.
+ */
+c4_View c4_View::Fuse()const {
+  return f4_CreateFused(*_seq);
+}
+
+/** Return a readable description of how this view is derived
+ *
+ * Lists each layer from this view down to the underlying data, with the
+ * number of rows at each step.  The result is stored in a temporary buffer,
+ * it must be copied before the next call.
+ */
+const char *c4_View::Describe()const {
+  return _seq->Describe();
+}
+
 /** Create view with the specified property arrangement
  *
  * The result is virtual, it merely maintains a permutation to access the
@@ -586,9 +771,10 @@ c4_View c4_View::Rename(const c4_Property &old_, const c4_Property &new_)const {
  */
 c4_View c4_View::GroupBy(const c4_View &keys_,  
   ///< properties in this view determine grouping
-const c4_ViewProp &result_  ///< name of new subview defined in result
+const c4_ViewProp &result_,  ///< name of new subview defined in result
+t4_i32 budget_  ///< if > 0, the memory to use for sorting, see SortOnExternal
 )const {
-  return f4_CustGroupBy(*_seq, keys_, result_);
+  return f4_CustGroupBy(*_seq, keys_, result_, budget_);
 }
 
 /** Create view with count of duplicates, when grouped by key
@@ -600,9 +786,10 @@ const c4_ViewProp &result_  ///< name of new subview defined in result
  */
 c4_View c4_View::Counts(const c4_View &keys_,  
   ///< properties in this view determine grouping
-const c4_IntProp &result_  ///< new count property defined in result
+const c4_IntProp &result_,  ///< new count property defined in result
+t4_i32 budget_  ///< if > 0, the memory to use for sorting, see SortOnExternal
 )const {
-  return f4_CustGroupBy(*_seq, keys_, result_); // third arg is c4_IntProp
+  return f4_CustGroupBy(*_seq, keys_, result_, budget_); // third arg is c4_IntProp
 }
 
 /** Create view with all duplicate rows omitted
@@ -795,6 +982,39 @@ c4_View c4_View::Indexed(const c4_View &map_, const c4_View &props_, bool
   return f4_CreateIndexed(*_seq,  *map_._seq, props_, unique_);
 }
 
+/** Create mapped view which maintains bitmap indexes on a property
+ *
+ * This is an identity view, which keeps a compressed bitmap of the rows
+ * holding each distinct value of one property in a secondary "map" view.
+ * Select and SelectRange on this view combine these bitmaps to find the
+ * matching rows without scanning, which works best for properties with
+ * few distinct values, such as a status or a category.  Bitmap views can
+ * be stacked to index several properties, their results are then AND-ed.
+ *
+ * Bitmaps refer to rows by position, so inserting or removing rows other
+ * than at the end renumbers all rows after that point, which takes time
+ * proportional to the size of the view.  Bitmap views are best suited for
+ * data which is mostly added to at the end.
+ *
+ * The map_ view must be empty the first time this bitmap view is used, so
+ * that Metakit can fill it based on whatever rows are already present in
+ * the underlying view.  After that, neither the underlying view nor the
+ * map view may be modified other than through this bitmap mapping layer.
+ * The defined structure of the map view must be "<prop>,_C:I,_B:B", where
+ * the first property is the one being indexed.
+ *
+ * Example of use:
+ * @code
+ *  c4_View data = storage.GetAs("orders[id:I,status:S]");
+ *  c4_View datab = storage.GetAs("orders_B[status:S,_C:I,_B:B]");
+ *  c4_View bitmap = data.Bitmap(datab);
+ *  ... bitmap.Select(status["open"]) ...
+ * @endcode
+ */
+c4_View c4_View::Bitmap(const c4_View &map_)const {
+  return f4_CreateBitmap(*_seq,  *map_._seq);
+}
+
 /** Return the index of the specified row in this view (or -1)
  *
  * This function can be used to "unmap" an index of a derived view back
@@ -811,6 +1031,12 @@ int c4_View::RestrictSearch(const c4_RowRef &c_, int &pos_, int &count_) {
   return _seq->RestrictSearch(&c_, pos_, count_) ? 0 : ~0;
 }
 
+/// Determine the rows in a selection range (see c4_CustomViewer::SelectRows)
+int c4_View::RestrictSelect(const c4_RowRef &low_, const c4_RowRef &high_,
+  c4_Bytes &rows_) {
+  return _seq->RestrictSelect(&low_, &high_, rows_);
+}
+
 /** Find index of the the next entry matching the specified key.
  *
  * Defaults to linear search, but hash- and ordered-views will use a better
@@ -832,11 +1058,48 @@ int start_  ///< the index to start with
     c4_Sequence *refSeq = refView._seq;
     d4_assert(refSeq != 0);
 
-    c4_Bytes data;
+    c4_Bytes data, zmin, zmax;
+    int limit = 0;
+
+    // a full scan reads each of these columns, so start reading ahead now
+    if (start_ == 0 && count == GetSize())
+      for (int k = 0; k < refSeq->NumHandlers(); ++k) {
+        int n = _seq->PropIndex(refSeq->NthHandler(k).PropId());
+        if (n >= 0 && _seq->HandlerContext(n) == _seq)
+          _seq->NthHandler(n).Advise(c4_Strategy::kAdviseWillNeed);
+      }
 
     for (int j = 0; j < count; ++j) {
       int i;
 
+      // skip blocks of rows where zone maps rule out all matches
+      if (start_ + j >= limit) {
+        limit = start_ + count;
+
+        for (i = 0; i < refSeq->NumHandlers(); ++i) {
+          c4_Handler &h = refSeq->NthHandler(i);
+
+          int n = _seq->PropIndex(h.PropId());
+          if (n < 0 || _seq->HandlerContext(n) != _seq)
+            continue;
+
+          int end = limit;
+          if (_seq->NthHandler(n).GetZone(start_ + j, end, zmin, zmax) && (h
+            .Compare(0, zmin) < 0 || h.Compare(0, zmax) > 0)) {
+            limit = end;
+            break;
+          }
+
+          if (end < limit)
+            limit = end;
+        }
+
+        if (i < refSeq->NumHandlers()) {
+          j = limit - start_ - 1;
+          continue;
+        }
+      }
+
       for (i = 0; i < refSeq->NumHandlers(); ++i) {
         c4_Handler &h = refSeq->NthHandler(i); // no context issues
 
@@ -856,6 +1119,26 @@ int start_  ///< the index to start with
   return  - 1;
 }
 
+/** Start reading the data of some properties from file in the background
+ *
+ * Data of memory-mapped files is normally brought in one page at a time,
+ * as it is first accessed.  Call this before working through most of the
+ * rows of a large view stored on file, to have the operating system read
+ * ahead all the column data for these properties instead.  Only an empty
+ * view as argument (the default) means: all properties of this view.
+ * This is merely a hint, it has no effect on views which are not stored
+ * on file, or on platforms without support for such hints.
+ */
+void c4_View::Prefetch(const c4_View &props_  ///< the properties to read
+)const {
+  int n = props_.NumProperties();
+  for (int i = 0; i < (n > 0 ? n : NumProperties()); ++i) {
+    int k = n > 0 ? _seq->PropIndex(props_.NthProperty(i)) : i;
+    if (k >= 0)
+      _seq->NthHandler(k).Advise(c4_Strategy::kAdviseWillNeed);
+  }
+}
+
 /** Search for a key, using the native sort order of the view
  * @return position where found, or where it may be inserted,
  *  this position can also be just past the last row
@@ -1072,6 +1355,7 @@ void c4_Row::Release(c4_Cursor row_) {
 static c4_ThreadLock *sThreadLock = 0;
 static c4_StringArray *sPropNames = 0;
 static c4_DWordArray *sPropCounts = 0;
+static c4_DWordArray *sPropHash = 0;
 
 /// Call this to get rid of some internal datastructues (on exit)
 void c4_Property::CleanupInternalData() {
@@ -1081,10 +1365,84 @@ void c4_Property::CleanupInternalData() {
   delete sPropCounts;
   sPropCounts = 0; // race
 
+  delete sPropHash;
+  sPropHash = 0; // race
+
   delete sThreadLock;
   sThreadLock = 0; // race
 }
 
+/*
+ *  Property names are looked up through a hash table of ids, ignoring case.
+ *  Each slot holds an id plus one, or zero if unused.  The table is rebuilt
+ *  when it gets half full, and when the id of an unused name is given to a
+ *  new name.  All these calls must be made with the lock held.
+ */
+
+static int fNameHash(const char *name_) {
+  unsigned int h = 0;
+  while (*name_)
+    h = h * 31 + (*(const t4_byte*)name_++ &~0x20); // case-insensitive
+  return (int)(h ^ (h >> 16));
+}
+
+// same test as c4_String::CompareNoCase, without copying either name
+static bool fNameEqual(const char *p1_, const char *p2_) {
+  int c1, c2;
+  do {
+    c1 = *(const t4_byte*)p1_++;
+    c2 = *(const t4_byte*)p2_++;
+  } while (c1 != 0 && (c1 == c2 || tolower(c1) == tolower(c2)));
+
+  return c1 == c2;
+}
+
+static int fPropIdLocked(const char *name_) {
+  int mask = sPropHash != 0 ? sPropHash->GetSize() - 1:  - 1;
+  if (mask < 0)
+    return  - 1;
+
+  for (int i = fNameHash(name_) &mask;; i = (i + 1) &mask) {
+    int id = sPropHash->GetAt(i) - 1;
+    if (id < 0 || fNameEqual(name_, sPropNames->GetAt(id)))
+      return id;
+  }
+}
+
+static void fAddPropId(int id_) {
+  int mask = sPropHash->GetSize() - 1;
+
+  int i = fNameHash(sPropNames->GetAt(id_)) &mask;
+  while (sPropHash->GetAt(i) != 0)
+    i = (i + 1) &mask;
+
+  sPropHash->SetAt(i, id_ + 1);
+}
+
+static void fRehashPropIds() {
+  int n = sPropNames->GetSize();
+
+  int size = 16;
+  while (size < 2 *n)
+    size <<= 1;
+
+  sPropHash->SetSize(0);
+  sPropHash->SetSize(size);
+
+  for (int id = 0; id < n; ++id)
+    fAddPropId(id);
+}
+
+static int fPropIdByName(const char *name_) {
+  if (sThreadLock == 0)
+    return  - 1;
+  // no property has ever been created
+
+  c4_ThreadLock::Hold lock;
+
+  return sPropNames != 0 ? fPropIdLocked(name_):  - 1;
+}
+
 c4_Property::c4_Property(char type_, const char *name_): _type(type_) {
   if (sThreadLock == 0)
     sThreadLock = d4_new c4_ThreadLock;
@@ -1097,15 +1455,10 @@ c4_Property::c4_Property(char type_, const char *name_): _type(type_) {
   if (sPropCounts == 0)
     sPropCounts = d4_new c4_DWordArray;
 
-  c4_String temp = name_;
+  if (sPropHash == 0)
+    sPropHash = d4_new c4_DWordArray;
 
-  _id = sPropNames->GetSize();
-  while (--_id >= 0) {
-    const char *p = sPropNames->GetAt(_id);
-    // optimize for first char case-insensitive match
-    if (((*p ^  *name_) &~0x20) == 0 && temp.CompareNoCase(p) == 0)
-      break;
-  }
+  _id = fPropIdLocked(name_);
 
   if (_id < 0) {
     int size = sPropCounts->GetSize();
@@ -1121,6 +1474,12 @@ c4_Property::c4_Property(char type_, const char *name_): _type(type_) {
 
     sPropCounts->SetAt(_id, 0);
     sPropNames->SetAt(_id, name_);
+
+    // a reused id may still be in the table under its old name
+    if (_id < size || 2 *(_id + 1) > sPropHash->GetSize())
+      fRehashPropIds();
+    else
+      fAddPropId(_id);
   }
 
   Refs( + 1);
@@ -11,10 +11,12 @@
 #include "store.h"
 #include "column.h"
 
+#include <stdio.h>    // sprintf
+
 /////////////////////////////////////////////////////////////////////////////
 
-c4_Sequence::c4_Sequence(): _refCount(0), _dependencies(0), _propertyLimit(0),
-  _tempBuf(0){}
+c4_Sequence::c4_Sequence(): _refCount(0), _dependencies(0), _bulkLevel(0),
+  _bulkFirst( - 1), _propertyLimit(0), _tempBuf(0){}
 
 c4_Sequence::~c4_Sequence() {
   d4_assert(_refCount == 0);
@@ -78,6 +80,16 @@ bool c4_Sequence::RestrictSearch(c4_Cursor, int &, int &) {
   return true;
 }
 
+/// Determine the rows in a selection range, returns -1 if not known
+int c4_Sequence::RestrictSelect(c4_Cursor, c4_Cursor, c4_Bytes &) {
+  return  - 1;
+}
+
+/// Determine which rows of another view this one consists of, if any
+bool c4_Sequence::PickRows(c4_View &, c4_Bytes &) {
+  return false;
+}
+
 /// Replace the contents of a specified row
 void c4_Sequence::SetAt(int index_, c4_Cursor newElem_) {
   d4_assert(newElem_._seq != 0);
@@ -85,7 +97,7 @@ void c4_Sequence::SetAt(int index_, c4_Cursor newElem_) {
   c4_Bytes data;
 
   c4_Notifier change(this);
-  if (GetDependencies())
+  if (GetDependencies() && !DeferChange(index_))
     change.StartSetAt(index_, newElem_);
 
   for (int i = 0; i < newElem_._seq->NumHandlers(); ++i) {
@@ -156,7 +168,7 @@ void c4_Sequence::InsertAt(int index_, c4_Cursor newElem_, int count_) {
   d4_assert(newElem_._seq != 0);
 
   c4_Notifier change(this);
-  if (GetDependencies())
+  if (GetDependencies() && !DeferChange(index_))
     change.StartInsertAt(index_, newElem_, count_);
 
   SetNumRows(NumRows() + count_);
@@ -209,10 +221,22 @@ void c4_Sequence::InsertAt(int index_, c4_Cursor newElem_, int count_) {
   }
 }
 
+/// Insert copies of all the rows of another sequence
+void c4_Sequence::InsertFrom(int index_, c4_Sequence &seq_) {
+  int n = seq_.NumRows();
+  if (n > 0) {
+    c4_Row empty;
+    InsertAt(index_, &empty, n);
+
+    for (int i = 0; i < n; ++i)
+      SetAt(index_ + i, c4_Cursor(seq_, i));
+  }
+}
+
 /// Remove one or more rows from this sequence
 void c4_Sequence::RemoveAt(int index_, int count_) {
   c4_Notifier change(this);
-  if (GetDependencies())
+  if (GetDependencies() && !DeferChange(index_))
     change.StartRemoveAt(index_, count_);
 
   SetNumRows(NumRows() - count_);
@@ -225,7 +249,7 @@ void c4_Sequence::RemoveAt(int index_, int count_) {
 /// Move a row to another position
 void c4_Sequence::Move(int from_, int to_) {
   c4_Notifier change(this);
-  if (GetDependencies())
+  if (GetDependencies() && !DeferChange(from_ < to_ ? from_ : to_))
     change.StartMove(from_, to_);
 
   //! careful, this does no index remapping, wrong for derived seq's
@@ -306,6 +330,14 @@ const char *c4_Sequence::Description() {
   return 0;
 }
 
+/// Describe how rows are obtained, for derived views this is a chain
+const char *c4_Sequence::Describe() {
+  char buf[50];
+  sprintf(buf, "view(%d rows)", NumRows());
+
+  return UseTempBuffer(buf);
+}
+
 int c4_Sequence::ItemSize(int index_, int propId_) {
   int colNum = PropIndex(propId_);
   return colNum >= 0 ? NthHandler(colNum).ItemSize(index_):  - 1;
@@ -328,7 +360,7 @@ void c4_Sequence::Set(int index_, const c4_Property &prop_, const c4_Bytes
   c4_Handler &h = NthHandler(colNum);
 
   c4_Notifier change(this);
-  if (GetDependencies())
+  if (GetDependencies() && !DeferChange(index_))
     change.StartSet(index_, prop_.GetId(), buf_);
 
   if (buf_.Size())
@@ -371,6 +403,41 @@ c4_Notifier *c4_Sequence::PreChange(c4_Notifier &) {
 /// Called after changes have been made to the sequence
 void c4_Sequence::PostChange(c4_Notifier &){}
 
+/// Start deferring change notifications to dependent sequences
+void c4_Sequence::BeginBulk() {
+  ++_bulkLevel;
+}
+
+/// Stop deferring, and bring all dependent sequences up to date at once
+void c4_Sequence::EndBulk() {
+  d4_assert(_bulkLevel > 0);
+
+  if (--_bulkLevel == 0 && _bulkFirst >= 0) {
+    int first = _bulkFirst;
+    _bulkFirst =  - 1;
+
+    c4_Notifier change(this);
+    if (GetDependencies())
+      change.StartBulk(first);
+  }
+}
+
+/*
+ *  While in bulk mode, all that is remembered is the lowest row touched.
+ *  Rows before it are unchanged and have not moved, so dependents only
+ *  need to drop and re-evaluate the rows from there on, once, in EndBulk.
+ *  For the common case of appending many rows, that is just the new ones.
+ */
+bool c4_Sequence::DeferChange(int index_) {
+  if (_bulkLevel == 0)
+    return false;
+
+  if (_bulkFirst < 0 || index_ < _bulkFirst)
+    _bulkFirst = index_;
+
+  return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 c4_Reference &c4_Reference::operator = (const c4_Reference &value_) {
@@ -644,6 +711,38 @@ t4_i32 c4_Strategy::FreshGeneration() {
   return 1;
 }
 
+/// Hint at how a range of bytes will be accessed, the default ignores it
+void c4_Strategy::DataAdvise(t4_i32, t4_i32, int){}
+
+/// Read consecutive bytes into several buffers, return the total read
+int c4_Strategy::DataReadv(t4_i32 pos_, void *const *bufs_, const t4_i32
+  *lens_, int count_) {
+  int total = 0;
+
+  for (int i = 0; i < count_; ++i) {
+    int n = DataRead(pos_, bufs_[i], lens_[i]);
+    if (n < 0)
+      return total > 0 ? total :  - 1;
+
+    total += n;
+    if (n < lens_[i])
+      break;
+
+    pos_ += n;
+  }
+
+  return total;
+}
+
+/// Write several buffers as consecutive bytes
+void c4_Strategy::DataWritev(t4_i32 pos_, const void *const *bufs_, const
+  t4_i32 *lens_, int count_) {
+  for (int i = 0; i < count_ && _failure == 0; ++i) {
+    DataWrite(pos_, bufs_[i], lens_[i]);
+    pos_ += lens_[i];
+  }
+}
+
 /// Define the base offset where data is stored
 void c4_Strategy::SetBase(t4_i32 base_) {
   t4_i32 off = base_ - _baseOffset;
@@ -696,8 +795,10 @@ t4_i32 c4_Strategy::EndOfData(t4_i32 end_) {
     const bool isSkipTail = ((mark[0] & 0xF0) == 0x90 /* 2006-11-11 */ ||
                              (mark[0] == 0x80 && count == 0)) && offset > 0;
     const bool isCommitTail = mark[0] == 0x80 && count > 0 && offset > 0;
+    // 0x40 in the last byte flags newer column layouts, see c4_FileMark
     const bool isHeader = (mark[0] == 'J' || mark[0] == 'L') && (mark[0] ^
-      mark[1]) == ('J' ^ 'L') && mark[2] == 0x1A && (mark[3] & 0x40) == 0;
+      mark[1]) == ('J' ^ 'L') && mark[2] == 0x1A && ((mark[3] &0x40) == 0 ||
+      mark[3] == 0x40);
       
     switch (state) {
       case kStateAtEnd:
@@ -44,65 +44,121 @@ class MkTcl;
 // inc'ed whenever a datafile is closed, forces relookup of all paths
 static int generation;
 
+TCL_DECLARE_MUTEX(infoMutex)  // protects generation and the shared item list
+
 #ifdef TCL_THREADS
 
-// There is a single monolithic mutex for protecting all of Mk4tcl, but it has
-// to be a bit more advanced than Tcl's one since it has to support recursion,
-// i.e. re-entering this code from the *same* thread needs to be allowed.  The
-// recursion can happen in Tcl's type callbacks, see "Tcl_ObjType mkCursorType".
+// Interpreters are tied to the thread which created them, and so are their
+// workspaces, paths, and Tcl objects.  Threads which only use datafiles they
+// opened themselves therefore need no locking at all, even when several of
+// them have the same file open: each gets its own storage object.
+//
+// Storages opened with "mk::file open -shared" are different, they can be
+// used from any thread.  The core keeps caches in each storage which are
+// updated while reading (reference counts, columns and subviews loaded on
+// demand), so such a storage can't be used by two threads at the same time,
+// not even for reading.  Once a thread touches a shared storage, all its Mk4tcl
+// calls are serialized through mkMutex, until then it never takes that mutex.
 //
-// We know the current interpreter in all cases, it can be used as mutex owner.
-// So we can be multiple times inside the mutex, but ONLY from a simgle interp.
-// No deadlock is possible, locking is always in the order mkMutex -> infoMutex.
+// The mutex has to support recursion, i.e. re-entering this code from the
+// *same* thread needs to be allowed.  The recursion can happen in Tcl's type
+// callbacks, see "Tcl_ObjType mkCursorType".  Locking is always in the order
+// mkMutex -> infoMutex, so no deadlock is possible.
 
-TCL_DECLARE_MUTEX(mkMutex)    // use a single monolithic mutex for now
-TCL_DECLARE_MUTEX(infoMutex)  // use a second mutex to manage the info below
+TCL_DECLARE_MUTEX(mkMutex)    // serializes all threads using shared storages
 
-// set to the interp holding the mutex, or to zero when not locked
-static Tcl_Interp *mutex_owner;
+typedef struct ThreadLock {
+  int level; // recursion level, > 1 means we've re-entered from this thread
+  int locked; // set while this thread holds mkMutex
+  int sharing; // set once this thread has used a shared storage
+} ThreadLock;
 
-// set to the reursion level, > 1 means we've re-entered from same interp
-static int mutex_level;
-  
-static void EnterMutex(Tcl_Interp *ip_) {
-    d4_assert(ip_ != 0);
-    Tcl_MutexLock(&infoMutex);
-    if (ip_ != mutex_owner) {
-        Tcl_MutexUnlock(&infoMutex);
-        Tcl_MutexLock(&mkMutex);
-        Tcl_MutexLock(&infoMutex);
-        d4_assert(mutex_owner == 0);
-        mutex_owner = ip_;
-    }
-    ++mutex_level;
-    Tcl_MutexUnlock(&infoMutex);
+static Tcl_ThreadDataKey lockKey;
+
+static ThreadLock *GetThreadLock() {
+  return (ThreadLock*)Tcl_GetThreadData(&lockKey, sizeof(ThreadLock));
+}
+
+static void EnterMutex() {
+  ThreadLock *tl = GetThreadLock();
+  if (tl->level++ == 0 && tl->sharing) {
+    Tcl_MutexLock(&mkMutex);
+    tl->locked = 1;
+  }
 }
 
 static void LeaveMutex() {
-    Tcl_MutexLock(&infoMutex);
-    d4_assert(mutex_owner != 0 && mutex_level > 0);
-    if (--mutex_level == 0) {
-      mutex_owner = 0;
-      Tcl_MutexUnlock(&mkMutex);
-    }
-    Tcl_MutexUnlock(&infoMutex);
+  ThreadLock *tl = GetThreadLock();
+  d4_assert(tl->level > 0);
+  if (--tl->level == 0 && tl->locked) {
+    tl->locked = 0;
+    Tcl_MutexUnlock(&mkMutex);
+  }
+}
+
+// called before using the shared item list, or any item on it
+static void ShareMutex() {
+  ThreadLock *tl = GetThreadLock();
+  tl->sharing = 1;
+  if (tl->level > 0 && !tl->locked) {
+    Tcl_MutexLock(&mkMutex);
+    tl->locked = 1;
+  }
 }
 
 #else
 
-#define EnterMutex(x)
+#define EnterMutex()
 #define LeaveMutex()
+#define ShareMutex()
 
 #endif
+
+static void NewGeneration() {
+  Tcl_MutexLock(&infoMutex);
+  ++generation;
+  Tcl_MutexUnlock(&infoMutex);
+}
+
+static int CurrGeneration() {
+  Tcl_MutexLock(&infoMutex);
+  int gen = generation;
+  Tcl_MutexUnlock(&infoMutex);
+  return gen;
+}
+
+static MkWorkspace::Item *SharedItem(const char *name_) {
+  MkWorkspace::Item *item = 0;
+
+  Tcl_MutexLock(&infoMutex);
+  c4_PtrArray *shared = MkWorkspace::Item::_shared;
+  if (shared != 0)
+    for (int i = 0; i < shared->GetSize() && item == 0; ++i) {
+      MkWorkspace::Item *ip = (MkWorkspace::Item*)shared->GetAt(i);
+      if (ip && ip->_name == name_)
+        item = ip;
+    }
+  Tcl_MutexUnlock(&infoMutex);
+
+  return item;
+}
  
 // put code in this file as a mutex is static in Windows
 int Mk_EvalObj(Tcl_Interp *ip_, Tcl_Obj *cmd_) {
     LeaveMutex();
     int e = Tcl_EvalObj(ip_, cmd_);
-    EnterMutex(ip_);
+    EnterMutex();
     return e;
 }
 
+void Mk_EnterMutex() {
+    EnterMutex();
+}
+
+void Mk_LeaveMutex() {
+    LeaveMutex();
+}
+
 // moved out of member func scope to please HP-UX's aCC:
 
 static const char *getCmds[] =  {
@@ -575,7 +631,7 @@ bool c4_TclStream::Write(const void *buffer_, int length_) {
 ///////////////////////////////////////////////////////////////////////////////
 
 MkPath::MkPath(MkWorkspace &ws_, const char * &path_, Tcl_Interp *interp):
-  _refs(1), _ws(&ws_), _path(path_), _currGen(generation) {
+  _refs(1), _ws(&ws_), _path(path_), _currGen(CurrGeneration()) {
   // if this view is not part of any storage, make a new temporary row
   if (_path.IsEmpty()) {
     ws_.AllocTempRow(_path);
@@ -712,8 +768,8 @@ c4_PtrArray *MkWorkspace::Item::_shared = 0;
 
 MkWorkspace::Item::Item(const char *name_, const char *fileName_, int mode_,
   c4_PtrArray &items_, int index_, bool share_): _name(name_), _fileName
-  (fileName_), _items(items_), _index(index_) {
-  ++generation; // make sure all cached paths refresh on next access
+  (fileName_), _items(items_), _index(index_), _share(share_) {
+  NewGeneration(); // make sure all cached paths refresh on next access
 
   if (*fileName_) {
     c4_Storage s(fileName_, mode_);
@@ -728,9 +784,12 @@ MkWorkspace::Item::Item(const char *name_, const char *fileName_, int mode_,
   _items.SetAt(_index, this);
 
   if (share_) {
+    ShareMutex();
+    Tcl_MutexLock(&infoMutex);
     if (_shared == 0)
       _shared = new c4_PtrArray;
     _shared->Add(this);
+    Tcl_MutexUnlock(&infoMutex);
   }
 }
 
@@ -745,24 +804,28 @@ MkWorkspace::Item::~Item() {
     path->_currGen = -1; // make sure lookup is retried on next use
     // TODO: get rid of generations, use a "_valid" flag instead
   }
-  ++generation; // make sure all cached paths refresh on next access
+  NewGeneration(); // make sure all cached paths refresh on next access
 
   if (_index < _items.GetSize()) {
     d4_assert(_items.GetAt(_index) == this || _items.GetAt(_index) == 0);
     _items.SetAt(_index, 0);
   }
 
-  if (_shared != 0) {
-    for (int i = 0; i < _shared->GetSize(); ++i)
-    if (_shared->GetAt(i) == this) {
-      _shared->RemoveAt(i);
-      break;
-    }
+  if (_share) {
+    Tcl_MutexLock(&infoMutex);
+    if (_shared != 0) {
+      for (int i = 0; i < _shared->GetSize(); ++i)
+      if (_shared->GetAt(i) == this) {
+        _shared->RemoveAt(i);
+        break;
+      }
 
-    if (_shared->GetSize() == 0) {
-      delete _shared;
-      _shared = 0;
+      if (_shared->GetSize() == 0) {
+        delete _shared;
+        _shared = 0;
+      }
     }
+    Tcl_MutexUnlock(&infoMutex);
   }
 }
 
@@ -773,7 +836,7 @@ void MkWorkspace::Item::ForceRefresh() {
     path->_view = c4_View();
   }
 
-  ++generation; // make sure all cached paths refresh on next access
+  NewGeneration(); // make sure all cached paths refresh on next access
 }
 
 MkWorkspace::MkWorkspace(Tcl_Interp *ip_): _interp(ip_), _chanList(0) {
@@ -789,8 +852,10 @@ MkWorkspace::~MkWorkspace() {
 
   d4_assert(_chanList == 0);
 
+  EnterMutex();
   for (int i = _items.GetSize(); --i >= 0;)
     delete Nth(i);
+  LeaveMutex();
 
   for (MkChannel *chan = _chanList; chan; chan = chan->_next) {
     Tcl_UnregisterChannel(_interp, chan->_chan);
@@ -833,16 +898,14 @@ MkWorkspace::Item *MkWorkspace::Find(const char *name_)const {
       return ip;
   }
 
-  if (Item::_shared != 0)
-   { // look in the shared pool, if there is one
-    for (int j = 0; j < Item::_shared->GetSize(); ++j) {
-      Item *ip = (Item*)Item::_shared->GetAt(j);
-      if (ip && ip->_name == name_)
-        return ip;
-    }
-  }
+  // look in the shared pool, only a thread which finds its item there
+  // needs to serialize through mkMutex, which can't be taken while holding
+  // infoMutex, so look again once it is held: the item may have been closed
+  if (SharedItem(name_) == 0)
+    return 0;
 
-  return 0;
+  ShareMutex();
+  return SharedItem(name_);
 }
 
 int MkWorkspace::NumItems()const {
@@ -855,6 +918,7 @@ MkWorkspace::Item *MkWorkspace::Nth(int index_)const {
 
 MkPath *MkWorkspace::AddPath(const char * &name_, Tcl_Interp *interp) {
   const char *p = name_;
+  int gen = CurrGeneration();
 
   Item *ip = Find(f4_GetToken(p));
   if (ip == 0) {
@@ -866,7 +930,7 @@ MkPath *MkWorkspace::AddPath(const char * &name_, Tcl_Interp *interp) {
     MkPath *path = (MkPath*)ip->_paths.GetAt(i);
     d4_assert(path != 0);
 
-    if (path->_path.CompareNoCase(name_) == 0 && path->_currGen == generation) {
+    if (path->_path.CompareNoCase(name_) == 0 && path->_currGen == gen) {
       path->Refs( + 1);
       return path;
     }
@@ -1109,14 +1173,14 @@ long &AsIndex(Tcl_Obj *obj_) {
 
 static void FreeCursorInternalRep(Tcl_Obj *cursorPtr) {
   MkPath &path = AsPath(cursorPtr);
-  EnterMutex(path._ws->_interp);
+  EnterMutex();
   path.Refs( - 1);
   LeaveMutex();
 }
 
 static void DupCursorInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *copyPtr) {
   MkPath &path = AsPath(srcPtr);
-  EnterMutex(path._ws->_interp);
+  EnterMutex();
   path.Refs( + 1);
   copyPtr->internalRep = srcPtr->internalRep;
   copyPtr->typePtr = &mkCursorType;
@@ -1125,11 +1189,11 @@ static void DupCursorInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *copyPtr) {
 
 int SetCursorFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr) {
   d4_assert(interp != 0);
-  EnterMutex(interp);
+  EnterMutex();
 
   // force a relookup if the this object is of the wrong generation
   if (objPtr->typePtr == &mkCursorType && AsPath(objPtr)._currGen !=
-    generation) {
+    CurrGeneration()) {
     // make sure we have a string representation around
     if (objPtr->bytes == 0)
       UpdateStringOfCursor(objPtr);
@@ -1164,7 +1228,7 @@ int SetCursorFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr) {
 
 static void UpdateStringOfCursor(Tcl_Obj *cursorPtr) {
   MkPath &path = AsPath(cursorPtr);
-  EnterMutex(path._ws->_interp);
+  EnterMutex();
   c4_String s = path._path;
 
   long index = AsIndex(cursorPtr);
@@ -1198,6 +1262,63 @@ static Tcl_Obj *AllocateNewTempRow(MkWorkspace &work_) {
 ///////////////////////////////////////////////////////////////////////////////
 // Helper class for the mk::select command, stores params and performs select
 
+TclSelector::Condition::Condition(int id_, const c4_View &view_, Tcl_Obj
+  *crit_): _id(id_), _view(view_), _crit(crit_), _valid(true), _pattern(0),
+  _regexp(0){}
+
+TclSelector::Condition::~Condition() {
+  for (int i = 0; i < _rows.GetSize(); ++i)
+    delete (c4_Row*)_rows.GetAt(i);
+
+  if (_pattern != 0)
+    Tcl_DecrRefCount(_pattern);
+}
+
+// convert the criterium once, instead of again for each row being compared
+int TclSelector::Condition::Compile(Tcl_Interp *interp_) {
+  if (_id <= 2)
+  for (int j = 0; j < _view.NumProperties(); ++j) {
+    const c4_Property &prop = _view.NthProperty(j);
+
+    c4_Row *row = new c4_Row;
+    _rows.Add(row);
+
+    // a criterium which can't be converted never matches a typed compare,
+    // no interp is passed in, since its result holds the list being built
+    switch (prop.Type()) {
+      case 'S':
+      case 'B':
+      case 'F':
+      case 'D':
+#ifdef TCL_WIDE_INT_TYPE
+      case 'L':
+#endif 
+      case 'I':
+        if (SetAsObj(0,  *row, prop, _crit) == TCL_OK)
+          break;
+        // else fall through
+      default:
+        _valid = false;
+    }
+  }
+
+  if (_id == 4) {
+    // -regexp: compile into a private copy, which can't be shimmered away
+    _pattern = Tcl_DuplicateObj(_crit);
+    Tcl_IncrRefCount(_pattern);
+
+    _regexp = Tcl_GetRegExpFromObj(interp_, _pattern, TCL_REG_ADVANCED);
+    if (_regexp == 0)
+      return TCL_ERROR;
+  }
+
+  return TCL_OK;
+}
+
+const c4_Row &TclSelector::Condition::Typed(int index_)const {
+  return *(const c4_Row*)_rows.GetAt(index_);
+}
+
 TclSelector::TclSelector(Tcl_Interp *interp_, const c4_View &view_): _interp
   (interp_), _view(view_), _temp(0), _first(0), _count( - 1){}
 
@@ -1227,28 +1348,30 @@ int TclSelector::AddCondition(int id_, Tcl_Obj *props_, Tcl_Obj *value_) {
   return TCL_OK;
 }
 
-bool TclSelector::MatchOneString(int id_, const char *value_, const char *crit_)
-  {
-  switch (id_) {
+bool TclSelector::MatchOneString(const Condition &cond_, const char *value_) {
+  const char *crit = Tcl_GetStringFromObj(cond_._crit, NULL);
+
+  switch (cond_._id) {
     case 2:
       // -exact prop value : exact case-sensitive match
-      return strcmp(value_, crit_) == 0;
+      return strcmp(value_, crit) == 0;
 
     case 3:
       // -glob prop pattern : match "glob" expression wildcard
-      return Tcl_StringMatch(value_, crit_) > 0;
+      return Tcl_StringMatch(value_, crit) > 0;
 
     case 4:
-      // -regexp prop pattern : match specified regular expression
-      return Tcl_RegExpMatch(_interp, (CONST84 char*)value_, (CONST84 char*)
-        crit_) > 0;
+      // -regexp prop pattern : match precompiled regular expression
+      return Tcl_RegExpExec(_interp, cond_._regexp, (CONST84 char*)value_,
+        (CONST84 char*)value_) > 0;
+
     case 5:
       // -keyword prop prefix : match keyword in given property
-      return MatchOneKeyword(value_, crit_);
+      return MatchOneKeyword(value_, crit);
 
     case 10:
       // -globnc prop pattern : match "glob", but not case sensitive
-      return Tcl_StringCaseMatch(value_, crit_, 1) > 0;
+      return Tcl_StringCaseMatch(value_, crit, 1) > 0;
   }
 
   return false;
@@ -1259,28 +1382,65 @@ bool TclSelector::Match(const c4_RowRef &row_) {
   for (int i = 0; i < _conditions.GetSize(); ++i) {
     const Condition &cond = *(const Condition*)_conditions.GetAt(i);
 
+    if (cond._id < 2 && !cond._valid)
+      return false;
+
     bool matched = false;
 
     // go through each property until one matches
-    for (int j = 0; j < cond._view.NumProperties(); ++j) {
+    for (int j = 0; j < cond._view.NumProperties() && !matched; ++j) {
       const c4_Property &prop = cond._view.NthProperty(j);
 
-      if (cond._id < 2)
-       { // use typed comparison as defined by Metakit
-        c4_Row data; // this is *very* slow in Metakit 1.8
-        if (SetAsObj(_interp, data, prop, cond._crit) != TCL_OK)
-          return false;
+      if (cond._id < 2) {
+        // use typed comparison as defined by Metakit, i.e. criterium vs item
+        const c4_Row &data = cond.Typed(j);
+        int f;
+
+        switch (prop.Type()) {
+          case 'I':
+             {
+              t4_i32 v1 = ((c4_IntProp &)prop)(data);
+              t4_i32 v2 = ((c4_IntProp &)prop)(row_);
+              f = v1 == v2 ? 0 : v1 < v2 ?  - 1:  + 1;
+            }
+            break;
 
-        // data is now a row with the criterium as single property
-        matched = cond._id < 0 && data == row_ || cond._id == 0 && data <= row_
-          || cond._id > 0 && data >= row_;
+          case 'L':
+             {
+              t4_i64 v1 = ((c4_LongProp &)prop)(data);
+              t4_i64 v2 = ((c4_LongProp &)prop)(row_);
+              f = v1 == v2 ? 0 : v1 < v2 ?  - 1:  + 1;
+            }
+            break;
+
+          case 'F':
+             {
+              float v1 = ((c4_FloatProp &)prop)(data);
+              float v2 = ((c4_FloatProp &)prop)(row_);
+              f = v1 == v2 ? 0 : v1 < v2 ?  - 1:  + 1;
+            }
+            break;
+
+          case 'D':
+             {
+              double v1 = ((c4_DoubleProp &)prop)(data);
+              double v2 = ((c4_DoubleProp &)prop)(row_);
+              f = v1 == v2 ? 0 : v1 < v2 ?  - 1:  + 1;
+            }
+            break;
+
+          default:
+            f = (&data)._seq->Compare((&data)._index, &row_);
+        }
+
+        matched = cond._id < 0 ? f == 0 : cond._id == 0 ? f <= 0 : f >= 0;
+      } else if (prop.Type() == 'S') {
+        // use string items in place, without going through a Tcl_Obj
+        matched = MatchOneString(cond, ((c4_StringProp &)prop)(row_));
       } else
        { // use item value as a string
         GetAsObj(row_, prop, _temp);
-        matched = MatchOneString(cond._id, Tcl_GetStringFromObj(_temp, NULL),
-          Tcl_GetStringFromObj(cond._crit, NULL));
-        if (matched)
-          break;
+        matched = MatchOneString(cond, Tcl_GetStringFromObj(_temp, NULL));
       }
     }
 
@@ -1291,15 +1451,39 @@ bool TclSelector::Match(const c4_RowRef &row_) {
   return true;
 }
 
+// copy the typed criterium of a single-property condition to another row
+static void CopyCriterium(const TclSelector::Condition &cond_, const c4_RowRef
+  &row_) {
+  const c4_Property &prop = cond_._view.NthProperty(0);
+
+  c4_Bytes data;
+  prop(cond_.Typed(0)).GetData(data);
+  prop(row_).SetData(data);
+}
+
 // pick out criteria which specify an exact match
 void TclSelector::ExactKeyProps(const c4_RowRef &row_) {
   for (int i = 0; i < _conditions.GetSize(); ++i) {
     const Condition &cond = *(const Condition*)_conditions.GetAt(i);
-    if (cond._id ==  - 1 || cond._id == 2) {
-      for (int j = 0; j < cond._view.NumProperties(); ++j) {
-        const c4_Property &prop = cond._view.NthProperty(j);
-        SetAsObj(_interp, row_, prop, cond._crit);
-      }
+
+    // with several properties, any one of them may match, so skip those
+    if ((cond._id ==  - 1 || cond._id == 2) && cond._valid &&
+      cond._view.NumProperties() == 1)
+      CopyCriterium(cond, row_);
+  }
+}
+
+// pick out criteria which limit the range of a property
+void TclSelector::RangeProps(const c4_RowRef &low_, const c4_RowRef &high_) {
+  for (int i = 0; i < _conditions.GetSize(); ++i) {
+    const Condition &cond = *(const Condition*)_conditions.GetAt(i);
+
+    if (cond._id <= 2 && cond._valid && cond._view.NumProperties() == 1) {
+      // an exact match is a range with the same low and high value
+      if (cond._id != 1)
+        CopyCriterium(cond, low_);
+      if (cond._id != 0)
+        CopyCriterium(cond, high_);
     }
   }
 }
@@ -1307,6 +1491,11 @@ void TclSelector::ExactKeyProps(const c4_RowRef &row_) {
 int TclSelector::DoSelect(Tcl_Obj *list_, c4_View *result_) {
   c4_IntProp pIndex("index");
 
+  // convert each criterium once, before going through all the rows
+  for (int i = 0; i < _conditions.GetSize(); ++i)
+    if (((Condition*)_conditions.GetAt(i))->Compile(_interp) != TCL_OK)
+      return TCL_ERROR;
+
   // normalize _first and _count to be in allowable range
   int n = _view.GetSize();
   if (_first < 0)
@@ -1318,29 +1507,60 @@ int TclSelector::DoSelect(Tcl_Obj *list_, c4_View *result_) {
   if (_first + _count > n)
     _count = n - _first;
 
-  c4_View result;
-  result.SetSize(_count); // upper bound
-
   // keep a temporary around during the comparison loop
   _temp = Tcl_NewObj();
   KeepRef keeper(_temp);
 
-  // try to take advantage of key lookup structures
+  // try to take advantage of key lookup structures, i.e. hash and ordered
+  // views, these narrow down the range of rows which need to be scanned
+  int limit = n;
+
   c4_Row exact;
   ExactKeyProps(exact);
-  if (exact.Container().NumProperties() > 0)
-    _view.RestrictSearch(exact, _first, _count);
+  if (exact.Container().NumProperties() > 0) {
+    int count = n - _first;
+    _view.RestrictSearch(exact, _first, count);
+    limit = _first + count;
+  }
+
+  // a bitmap index may already know which rows lie in the requested ranges
+  c4_Row low, high;
+  RangeProps(low, high);
+
+  c4_Bytes known;
+  int used =  - 1;
+  if (low.Container().NumProperties() > 0 || high.Container().NumProperties()
+    > 0)
+    used = _view.RestrictSelect(low, high, known);
 
-  // the matching loop where all the hard work is done
-  for (n = 0; _first < _view.GetSize() && n < _count; ++_first)
-    if (Match(_view[_first]))
-      pIndex(result[n++]) = _first;
+  // the matching loop where all the hard work is done, results are only
+  // collected as they are found, instead of allocating room for all rows
+  c4_DWordArray matches;
 
-  result.SetSize(n);
+  if (used >= 0) {
+    const t4_i32 *p = (const t4_i32*)known.Contents();
+    int np = known.Size() / sizeof(t4_i32);
+
+    for (int k = 0; k < np && matches.GetSize() < _count; ++k)
+      if (_first <= p[k] && p[k] < limit && Match(_view[p[k]]))
+        matches.Add(p[k]);
+  } else
+    for (int i = _first; i < limit && matches.GetSize() < _count; ++i)
+      if (Match(_view[i]))
+        matches.Add(i);
+
+  n = matches.GetSize();
 
   // set up sorting, this references/loads a lot of extra Metakit code
   const bool sorted = n > 0 && _sortProps.NumProperties() > 0;
 
+  c4_View result;
+  if (sorted || result_ != 0) {
+    result.SetSize(n);
+    for (int i = 0; i < n; ++i)
+      pIndex(result[i]) = matches.GetAt(i);
+  }
+
   c4_View mapView;
   c4_View sortResult;
   if (sorted) {
@@ -1357,7 +1577,7 @@ int TclSelector::DoSelect(Tcl_Obj *list_, c4_View *result_) {
       pos = mapView.GetIndexOf(sortResult[i]);
 
     // set up a Tcl integer which holds the selected row index
-    KeepRef o = Tcl_NewIntObj(pIndex(result[pos]));
+    KeepRef o = Tcl_NewIntObj(matches.GetAt(pos));
 
     if (Tcl_ListObjAppendElement(_interp, list_, o) != TCL_OK)
       return TCL_ERROR;
@@ -2212,7 +2432,7 @@ int MkTcl::LoopCmd() {
 
     LeaveMutex();
     _error = Tcl_EvalObj(interp, cmd);
-    EnterMutex(interp);
+    EnterMutex();
 
     if (_error == TCL_CONTINUE)
       _error = TCL_OK;
@@ -2516,7 +2736,7 @@ int MkTcl::Execute(int oc, Tcl_Obj *const * ov) {
     return Fail(msg);
   }
 
-  EnterMutex(interp);
+  EnterMutex();
   int result = 0;
   switch (id) {
     case 0:
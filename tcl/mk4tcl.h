@@ -131,6 +131,7 @@ class MkWorkspace {
         c4_PtrArray _paths; // the paths associated with this entry
         c4_PtrArray &_items; // array from which this item is referenced
         int _index; // position in the _items array
+        bool _share; // also listed in _shared, can be used by other threads
 
         //Item ();        // special first entry initializer
         Item(const char *name_, const char *fileName_, int mode_, c4_PtrArray
@@ -139,7 +140,7 @@ class MkWorkspace {
 
         void ForceRefresh(); // bump the generation to recreate views
 
-        static c4_PtrArray *_shared; // shared items are also listed here
+        static c4_PtrArray *_shared; // shared items, guarded by infoMutex
     };
 
     MkWorkspace(Tcl_Interp *ip_);
@@ -190,6 +191,10 @@ int SetCursorFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
 // 24nov02: added to support releasing mutex lock during loop eval's
 int Mk_EvalObj(Tcl_Interp *ip_, Tcl_Obj *cmd_);
 
+// for view objects, which may also refer to shared storages
+void Mk_EnterMutex();
+void Mk_LeaveMutex();
+
 ///////////////////////////////////////////////////////////////////////////////
 // Helper class for the mk::select command, stores params and performs select
 
@@ -205,9 +210,16 @@ class TclSelector {
         int _id;
         c4_View _view;
         Tcl_Obj *_crit; // no need to incref, original lifetime is guaranteed
+        c4_PtrArray _rows; // typed criterium as c4_Row, one per property
+        bool _valid; // false if the criterium could not be converted
+        Tcl_Obj *_pattern; // private copy of the -regexp criterium, or null
+        Tcl_RegExp _regexp; // compiled pattern, owned by _pattern
+
+        Condition(int id_, const c4_View &view_, Tcl_Obj *crit_);
+        ~Condition();
 
-        Condition(int id_, const c4_View &view_, Tcl_Obj *crit_): _id(id_),
-          _view(view_), _crit(crit_){}
+        int Compile(Tcl_Interp *interp_);
+        const c4_Row &Typed(int index_)const;
     };
 
     c4_View _sortProps;
@@ -220,9 +232,10 @@ class TclSelector {
 
     c4_View GetAsProps(Tcl_Obj *obj_);
     int AddCondition(int id_, Tcl_Obj *props_, Tcl_Obj *value_);
-    bool MatchOneString(int id_, const char *value_, const char *crit_);
+    bool MatchOneString(const Condition &cond_, const char *value_);
     bool Match(const c4_RowRef &row_);
     void ExactKeyProps(const c4_RowRef &row_);
+    void RangeProps(const c4_RowRef &low_, const c4_RowRef &high_);
     int DoSelect(Tcl_Obj *list_, c4_View *result_ = 0);
 };
 
@@ -350,6 +363,9 @@ class MkView: public Tcl {
     int SizeCmd(); // $obj size ?newsize?
     int LoopCmd(); // $obj loop cursor ?first? ?limit? ?step? {cmds}
     int ViewCmd(); // $obj view option ?args?
+    int WhereCmd(); // $obj where expr
+
+    int AsExpr(Tcl_Obj *obj_, c4_Expr &expr_);
 
     int CloneCmd(); // $obj view clone
     int ConcatCmd(); // $obj view concat view
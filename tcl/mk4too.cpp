@@ -128,7 +128,7 @@ int MkView::Execute(int oc, Tcl_Obj *const * ov) {
 
   static const char *subCmds[] =  {
     "close", "delete", "exists", "find", "get", "properties", "insert", "open",
-      "search", "select", "set", "size", "loop", "view", "info",  
+      "search", "select", "set", "size", "loop", "view", "where", "info",  
       // will be deprecated (use "properties" instead)
     0
   };
@@ -176,6 +176,9 @@ int MkView::Execute(int oc, Tcl_Obj *const * ov) {
     ,  {
        &MkView::ViewCmd, 3, 0, "view option ?args?"
     }
+    ,  {
+       &MkView::WhereCmd, 3, 3, "where expr"
+    }
     ,  {
        &MkView::InfoCmd, 2, 2, "info"
     }
@@ -204,7 +207,10 @@ int MkView::Execute(int oc, Tcl_Obj *const * ov) {
     return Fail(msg);
   }
 
-  return (this->*cd.proc)();
+  Mk_EnterMutex();
+  int result = (this->*cd.proc)();
+  Mk_LeaveMutex();
+  return result;
 }
 
 //
@@ -549,11 +555,133 @@ int MkView::SelectCmd() {
     return _error;
 
   c4_View nview;
-  sel.DoSelect(0, &nview);
+  _error = sel.DoSelect(0, &nview);
+  if (_error)
+    return _error;
+
   MkView *ncmd = new MkView(interp, nview);
   return tcl_SetObjResult(tcl_NewStringObj(ncmd->CmdName()));
 }
 
+// Converts a nested list, such as {and {> age 18} {glob name A*}}, into an
+// expression.  Comparisons take a property and a value, "in" takes a list
+// of values, and "cmp" compares two properties, as in {cmp < low high}.
+
+int MkView::AsExpr(Tcl_Obj *obj_, c4_Expr &expr_) {
+  static const char *ops[] =  {
+    "==", "!=", "<", "<=", ">", ">=", "prefix", "contains", "glob",  
+      // same order as in c4_Expr
+    "and", "or", "not", "in", "cmp", 0
+  };
+
+  int oc;
+  Tcl_Obj **ov;
+  if (Tcl_ListObjGetElements(interp, obj_, &oc, &ov) != TCL_OK)
+    return Fail();
+  if (oc == 0)
+    return Fail("empty expression");
+
+  int id = tcl_GetIndexFromObj(ov[0], ops, "operator");
+  if (id < 0)
+    return _error;
+
+  switch (id) {
+    case 9:
+      // and ?expr ...? : all expressions must match
+    case 10:
+       { // or ?expr ...? : at least one expression must match
+        expr_ = id == 9 ? c4_Expr(): !c4_Expr();
+
+        for (int i = 1; i < oc; ++i) {
+          c4_Expr sub;
+          if (AsExpr(ov[i], sub))
+            return _error;
+
+          if (i == 1)
+            expr_ = sub;
+          else if (id == 9)
+            expr_ = expr_ && sub;
+          else
+            expr_ = expr_ || sub;
+        }
+      }
+      break;
+
+    case 11:
+       { // not expr : the expression must not match
+        if (oc != 2)
+          return Fail("wrong # args: should be \"not expr\"");
+
+        c4_Expr sub;
+        if (AsExpr(ov[1], sub))
+          return _error;
+
+        expr_ = !sub;
+      }
+      break;
+
+    case 12:
+       { // in prop list : the value must be one of the list items
+        if (oc != 3)
+          return Fail("wrong # args: should be \"in prop list\"");
+
+        const c4_Property &prop = AsProperty(ov[1], view);
+
+        int nv;
+        Tcl_Obj **vv;
+        if (Tcl_ListObjGetElements(interp, ov[2], &nv, &vv) != TCL_OK)
+          return Fail();
+
+        c4_View list = prop;
+        c4_Row row;
+        for (int i = 0; i < nv && !_error; ++i) {
+          _error = SetAsObj(interp, row, prop, vv[i]);
+          list.Add(row);
+        }
+
+        expr_ = c4_Expr(list);
+      }
+      break;
+
+    case 13:
+       { // cmp op prop prop : compare two properties of each row
+        if (oc != 4)
+          return Fail("wrong # args: should be \"cmp op prop prop\"");
+
+        int op = tcl_GetIndexFromObj(ov[1], ops, "comparison");
+        if (op < 0)
+          return _error;
+        if (op > c4_Expr::kGE)
+          return Fail("comparison must be one of ==, !=, <, <=, >, or >=");
+
+        expr_ = c4_Expr(AsProperty(ov[2], view), op, AsProperty(ov[3], view));
+      }
+      break;
+
+    default:
+       { // op prop value : compare a property with a value
+        if (oc != 3)
+          return Fail("wrong # args: should be \"op prop value\"");
+
+        c4_Row row;
+        _error = SetAsObj(interp, row, AsProperty(ov[1], view), ov[2]);
+
+        expr_ = c4_Expr(row, id);
+      }
+  }
+
+  return _error;
+}
+
+int MkView::WhereCmd() {
+  c4_Expr expr;
+  if (AsExpr(objv[2], expr))
+    return _error;
+
+  MkView *ncmd = new MkView(interp, view.Select(expr));
+  return tcl_SetObjResult(tcl_NewStringObj(ncmd->CmdName()));
+}
+
 int MkView::SetCmd() {
   if (objc < 4)
     return GetCmd();
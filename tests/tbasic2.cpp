@@ -212,4 +212,37 @@ void TestBasics2() {
     A((c4_String)(const char*)(p1(v1[0])) == (c4_String)"abc");
   }
   E;
+
+  B(b28, Find property by name, 0) {
+    c4_View v1;
+    char buf[20];
+    for (int i = 0; i < 200; ++i) {
+      sprintf(buf, "col%d", i);
+      v1.AddProperty(c4_IntProp(buf));
+    }
+    A(v1.NumProperties() == 200);
+    A(v1.FindPropIndexByName("col0") == 0);
+    A(v1.FindPropIndexByName("COL150") == 150);
+    A(v1.FindPropIndexByName("Col199") == 199);
+    A(v1.FindPropIndexByName("col200") ==  - 1);
+    A(v1.FindPropIndexByName("") ==  - 1);
+
+    c4_IntProp p1("col7"), p2("COL3");
+    c4_View v2 = v1.Project((p1, p2));
+    A(v2.FindPropIndexByName("col3") == 1);
+    A(v2.FindPropIndexByName("col0") ==  - 1);
+     {
+      c4_StringProp p3("b28_temp");
+      v2 = (p3, p1);
+      A(v2.FindPropIndexByName("B28_TEMP") == 0);
+    }
+    v2 = p1;
+    // the unused name may be given to another property
+    c4_StringProp p4("b28_other");
+    v2.AddProperty(p4);
+    A(v2.FindPropIndexByName("b28_temp") ==  - 1);
+    A(v2.FindPropIndexByName("b28_Other") == 1);
+    A(v1.FindPropIndexByName("b28_other") ==  - 1);
+  }
+  E;
 }
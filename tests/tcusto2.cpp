@@ -438,4 +438,310 @@ void TestCustom2() {
 
   }
   E;
+
+  B(c23, Select with expressions, 0) {
+    c4_Storage s1;
+    c4_View v1 = s1.GetAs("v1[p1:I,p2:S,p3:I]");
+    c4_IntProp p1("p1"), p3("p3");
+    c4_StringProp p2("p2");
+
+    static const char *names[] =  {
+      "apple", "Apricot", "banana", "cherry", "grape"
+    };
+
+    for (int i = 0; i < 100; ++i)
+      v1.Add(p1[i % 7] + p2[names[i % 5]] + p3[i * 13 % 50]);
+
+    c4_View v2 = v1.Select(c4_Expr(p1[3], c4_Expr::kGT) || !c4_Expr
+      (p2["BANANA"]));
+    c4_View v3 = v1.Select(c4_Expr(p1, c4_Expr::kLT, p3));
+    c4_View v4 = v1.Select(c4_Expr(p2["ap"], c4_Expr::kPrefix) && c4_Expr
+      (p2["*e"], c4_Expr::kGlob));
+
+    c4_View v5 = p3;
+    v5.Add(p3[26]);
+    v5.Add(p3[0]);
+    v5.Add(p3[13]);
+    c4_View v6 = v1.Select(c4_Expr(v5) && c4_Expr(p2["a"], c4_Expr::kContains));
+
+    // text matches ignore case on strings, just like the comparisons
+    c4_View v7 = v1.Select(c4_Expr(p2["AP"], c4_Expr::kPrefix));
+    c4_View v8 = v1.Select(c4_Expr(p2["?P*T"], c4_Expr::kGlob));
+
+    for (int pass = 0; pass < 2; ++pass) {
+      int n2 = 0, n3 = 0, n4 = 0, n6 = 0, n7 = 0, n8 = 0;
+
+      for (int j = 0; j < v1.GetSize(); ++j) {
+        int a = p1(v1[j]), c = p3(v1[j]);
+        c4_String b = (const char*)p2(v1[j]);
+
+        if (a > 3 || b.CompareNoCase("banana") != 0)
+          ++n2;
+        if (a < c)
+          ++n3;
+        if (b == "apple")
+          ++n4;
+        if ((c == 0 || c == 13 || c == 26) && (b.Find('a') >= 0 || b.Find('A')
+          >= 0))
+          ++n6;
+        if (b.Left(2).CompareNoCase("ap") == 0)
+          ++n7;
+        if (b.CompareNoCase("apricot") == 0)
+          ++n8;
+      }
+
+      A(v2.GetSize() == n2);
+      A(v3.GetSize() == n3);
+      A(v4.GetSize() == n4);
+      A(v6.GetSize() == n6);
+      A(v7.GetSize() == n7);
+      A(v8.GetSize() == n8);
+      A(n8 > 0 && n7 > n8);
+
+      for (int k = 0; k < v4.GetSize(); ++k)
+        A(c4_String((const char*)p2(v4[k])) == "apple");
+
+      // the selections must follow changes to the underlying view
+      p1(v1[1]) = 6;
+      p2(v1[2]) = "apple";
+      p3(v1[3]) = 13;
+      v1.RemoveAt(10, 5);
+      v1.InsertAt(0, p1[1] + p2["apple"] + p3[13]);
+      v1.SetAt(20, p1[4] + p2["Banana"] + p3[0]);
+    }
+  }
+  E;
+
+  B(c24, Fused derived views, 0) {
+    c4_Storage s1;
+    c4_View v1 = s1.GetAs("v1[p1:I,p2:S,p3:I]");
+    c4_IntProp p1("p1"), p3("p3");
+    c4_StringProp p2("p2");
+
+    for (int i = 0; i < 200; ++i) {
+      char buf[10];
+      sprintf(buf, "s%d", i * 7 % 31);
+      v1.Add(p1[i % 23] + p2[buf] + p3[i]);
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+      c4_View v2 = v1.SelectRange(p1[5], p1[15]).SortOn(p2).Project((p3, p2))
+        .Slice(3,  - 1, 2);
+      c4_View v3 = v2.Fuse();
+
+      A(v3.GetSize() == v2.GetSize());
+      A(v3.NumProperties() == 2);
+      A(c4_String(v3.Describe()).Left(6) == "fused(");
+
+      for (int j = 0; j < v2.GetSize(); ++j) {
+        A(p3(v3[j]) == p3(v2[j]));
+        A(c4_String((const char*)p2(v3[j])) == (const char*)p2(v2[j]));
+      }
+
+      // a changed underlying view is picked up on the next access
+      p1(v1[0]) = 10;
+      v1.RemoveAt(50, 20);
+      p2(v1[7]) = "s99";
+
+      c4_View v4 = v1.SelectRange(p1[5], p1[15]).SortOn(p2).Project((p3, p2))
+        .Slice(3,  - 1, 2);
+      A(v3.GetSize() == v4.GetSize());
+
+      for (int k = 0; k < v4.GetSize(); ++k) {
+        A(p3(v3[k]) == p3(v4[k]));
+        A(c4_String((const char*)p2(v3[k])) == (const char*)p2(v4[k]));
+      }
+    }
+  }
+  E;
+
+  B(c25, Sorted windows, 0) {
+    c4_Storage s1;
+    c4_View v1 = s1.GetAs("v1[p1:I,p2:I,p3:I]");
+    c4_IntProp p1("p1"), p2("p2"), p3("p3");
+
+    for (int i = 0; i < 300; ++i)
+      v1.Add(p1[i * 37 % 101] + p2[i % 7] + p3[i]);
+
+    c4_View v2 = v1.SortTop(p1, 10);
+    c4_View v3 = v1.SortTop((p2, p1), 10, 5);
+    c4_View v4 = v1.SortTop(p1, 25, 280);
+    c4_View v5 = v1.SortTopReverse((p2, p1), p1, 150, 100);
+
+    for (int pass = 0; pass < 8; ++pass) {
+      c4_View w2 = v1.SortOn(p1);
+      c4_View w3 = v1.SortOn((p2, p1));
+      c4_View w5 = v1.SortOnReverse((p2, p1), p1);
+
+      A(v2.GetSize() == 10);
+      A(v3.GetSize() == 10);
+      A(v4.GetSize() == (w2.GetSize() > 305 ? 25 : w2.GetSize() - 280));
+      A(v5.GetSize() == 150);
+
+      for (int j = 0; j < 10; ++j) {
+        A(p3(v2[j]) == p3(w2[j]));
+        A(p3(v3[j]) == p3(w3[j + 5]));
+      }
+      for (int k = 0; k < v4.GetSize(); ++k)
+        A(p3(v4[k]) == p3(w2[k + 280]));
+      for (int l = 0; l < 150; ++l)
+        A(p3(v5[l]) == p3(w5[l + 100]));
+
+      // exercise each way in which the windows can be affected
+      switch (pass) {
+        case 0:
+          p1(v1[pass + 3]) = 0;
+          p1(v1[150]) = 100;
+          break;
+        case 1:
+          v1.InsertAt(0, p1[1] + p2[0] + p3[1000]);
+          v1.InsertAt(100, p1[99] + p2[6] + p3[1001], 3);
+          break;
+        case 2:
+          v1.RemoveAt(0, 2);
+          v1.RemoveAt(200);
+          break;
+        case 3:
+          p3(v1[7]) = 2000;
+          p2(v1[8]) = 3;
+          break;
+        case 4:
+          v1.SetAt(50, p1[50] + p2[2] + p3[3000]);
+          v1.Add(p1[0] + p2[0] + p3[3001]);
+          break;
+        case 5:
+          v1.BeginBulk();
+          for (int m = 0; m < 20; ++m)
+            v1.Add(p1[m * 5] + p2[m % 7] + p3[4000 + m]);
+          v1.EndBulk();
+          break;
+        case 6:
+          v1.RemoveAt(10, 40);
+          break;
+      }
+    }
+  }
+  E;
+
+  B(c26, Sorting on disk, 0) {
+    c4_Storage s1;
+    c4_View v1 = s1.GetAs("v1[p1:I,p2:S,p3:I]");
+    c4_IntProp p1("p1"), p3("p3");
+    c4_StringProp p2("p2");
+    c4_ViewProp p4("p4");
+
+    v1.SetSize(30000);
+    for (int i = 0; i < v1.GetSize(); ++i) {
+      char buf[10];
+      sprintf(buf, "s%d", i * 7 % 53);
+      p1(v1[i]) = (i * 7919) % 1009;
+      p2(v1[i]) = buf;
+      p3(v1[i]) = i;
+    }
+
+    // a tiny budget forces many runs and more than one merge pass
+    c4_View v2 = v1.SortOnExternal((p2, p1), 8192);
+    c4_View v3 = v1.GroupBy(p2, p4, 8192);
+    c4_View v4 = v1.Counts(p1, p3, 8192);
+    c4_View v5 = v2.SelectRange(p1[100], p1[200]);
+
+    for (int pass = 0; pass < 2; ++pass) {
+      c4_View w2 = v1.SortOn((p2, p1));
+      c4_View w3 = v1.GroupBy(p2, p4);
+      c4_View w4 = v1.Counts(p1, p3);
+      c4_View w5 = w2.SelectRange(p1[100], p1[200]);
+
+      A(v2.GetSize() == w2.GetSize());
+      A(c4_String(v2.Describe()).Left(12) == "sort on disk");
+
+      int j;
+      for (j = 0; j < w2.GetSize(); ++j)
+        A((t4_i32)p3(v2[j]) == p3(w2[j]));
+
+      A(v3.GetSize() == w3.GetSize());
+      for (j = 0; j < w3.GetSize(); ++j) {
+        A(c4_String((const char*)p2(v3[j])) == (const char*)p2(w3[j]));
+        A(p4(v3[j]).GetSize() == p4(w3[j]).GetSize());
+      }
+
+      A(v4.GetSize() == w4.GetSize());
+      for (j = 0; j < w4.GetSize(); ++j)
+        A((t4_i32)p3(v4[j]) == p3(w4[j]));
+
+      // views derived from the external sort follow its changes
+      A(v5.GetSize() == w5.GetSize());
+      for (j = 0; j < w5.GetSize(); ++j)
+        A((t4_i32)p3(v5[j]) == p3(w5[j]));
+
+      // the external sort is redone after changes, group-by is a snapshot
+      p1(v1[5]) = 2000;
+      v1.RemoveAt(100, 1000);
+      v3 = v1.GroupBy(p2, p4, 8192);
+      v4 = v1.Counts(p1, p3, 8192);
+    }
+  }
+  E;
+
+  B(c27, Materialize derived views, 0)W(c27a);
+   {
+    c4_IntProp p1("p1");
+    c4_StringProp p2("p2");
+    c4_ViewProp p3("p3");
+    c4_IntProp p4("p4");
+    char buf[50];
+
+    c4_View v1;
+    for (int i = 0; i < 1000; ++i) {
+      sprintf(buf, "s%d", i % 10);
+      // small values first, so the int column has to widen
+      v1.Add(p1[i < 500 ? i % 3 : i *1000-600000] + p2[buf]);
+    }
+
+    c4_View v2 = v1.Select(p2["s1"]).SortOnReverse(p1, p1).Materialize();
+    A(v2.GetSize() == 100);
+    A(p1(v2[0]) == 991000-600000);
+    A(p1(v2[39]) == 1000);
+    A(p1(v2[40]) == 2);
+    A(p1(v2[99]) ==  - 99000);
+    A(c4_String((const char*)p2(v2[99])) == "s1");
+
+    c4_View v3 = v1.GroupBy(p2, p3).Materialize();
+    A(v3.GetSize() == 10);
+    A(c4_String((const char*)p2(v3[3])) == "s3");
+    A(p3(v3[3]).GetSize() == 100);
+    A(p1(((c4_View)p3(v3[3]))[99]) == 993000-600000);
+
+    c4_View v4;
+    v4.Add(p2["s2"] + p4[22]);
+    v4.Add(p2["s4"] + p4[44]);
+    c4_View v5 = v1.Join(p2, v4).Materialize();
+    A(v5.GetSize() == 200);
+    A(p4(v5[199]) == 44);
+
+    // changes to the original views no longer show
+    v1.RemoveAt(0, 500);
+    v4.SetSize(0);
+    A(v2.GetSize() == 100);
+    A(p1(v2[89]) == 0);
+    A(p3(v3[0]).GetSize() == 100);
+    A(v5.GetSize() == 200);
+
+     {
+      c4_Storage s1("c27a", 1);
+      c4_View v6 = s1.GetAs("a[p2:S,p3[p1:I,p2:S]]");
+      v6.InsertAt(0, v3);
+      A(v6.GetSize() == 10);
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("c27a", 0);
+      c4_View v6 = s1.View("a");
+      A(v6.GetSize() == 10);
+      A(c4_String((const char*)p2(v6[9])) == "s9");
+      A(p1(((c4_View)p3(v6[2]))[0]) ==  - 98000);
+      A(p1(((c4_View)p3(v6[2]))[99]) == 992000-600000);
+    }
+  }
+  R(c27a);
+  E;
 }
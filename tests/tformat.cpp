@@ -332,4 +332,348 @@ void TestFormat() {
   D(f11a);
   R(f11a);
   E;
+
+  // block-encoded int columns, chosen on commit when they save enough space
+  B(f12, Packed int columns, 0)W(f12a);
+   {
+    c4_IntProp p1("p1"), p2("p2"), p3("p3");
+    c4_LongProp p4("p4");
+     {
+      c4_Storage s1("f12a", 1);
+      c4_View v1 = s1.GetAs("a[p1:I,p2:I,p3:I,p4:L]");
+      v1.SetSize(1500);
+
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        p1(v1[i]) = 1000000+1000 * i; // delta-of-delta
+        p2(v1[i]) = i / 500; // runs
+        p3(v1[i]) = (i *7919) % 100003; // no gain, stays plain
+        p4(v1[i]) = (t4_i64)1000000000 *1000+3 * i; // delta, 64-bit
+      }
+
+      s1.Commit();
+
+      A(p1(v1[1499]) == 1000000+1000 * 1499);
+      A(p2(v1[1499]) == 2);
+      A(p3(v1[1499]) == (1499 *7919) % 100003);
+      A(p4(v1[1499]) == (t4_i64)1000000000 *1000+3 * 1499);
+    }
+     {
+      FILE *fp = fopen("f12a", "rb");
+      A(fp != 0);
+      fseek(fp, 0, SEEK_END);
+      A(ftell(fp) < 10000); // unpacked, this would be over 25 Kb
+      fclose(fp);
+
+      c4_Storage s1("f12a", 0);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 1500);
+
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        A(p1(v1[i]) == 1000000+1000 * i);
+        A(p2(v1[i]) == i / 500);
+        A(p3(v1[i]) == (i *7919) % 100003);
+        A(p4(v1[i]) == (t4_i64)1000000000 *1000+3 * i);
+      }
+    }
+  }
+  D(f12a);
+  R(f12a);
+  E;
+
+  B(f13, Modify packed int columns, 0)W(f13a);
+   {
+    c4_IntProp p1("p1");
+     {
+      c4_Storage s1("f13a", 1);
+      c4_View v1 = s1.GetAs("a[p1:I]");
+      v1.SetSize(100);
+
+      for (int i = 0; i < v1.GetSize(); ++i)
+        p1(v1[i]) = 10 * i;
+
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("f13a", 1);
+      c4_View v1 = s1.View("a");
+      A(p1(v1[99]) == 990);
+
+      p1(v1[50]) =  - 7;
+      v1.InsertAt(10, p1[123456]);
+      v1.RemoveAt(0);
+
+      A(v1.GetSize() == 100);
+      A(p1(v1[0]) == 10);
+      A(p1(v1[9]) == 123456);
+      A(p1(v1[50]) ==  - 7);
+
+      s1.Commit();
+      s1.Commit();
+
+      A(p1(v1[99]) == 990);
+    }
+     {
+      c4_Storage s1("f13a", 1);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 100);
+      A(p1(v1[9]) == 123456);
+      A(p1(v1[50]) ==  - 7);
+
+      // no longer worth packing: every value needs 32 bits
+      for (int i = 0; i < v1.GetSize(); ++i)
+        p1(v1[i]) = (i *7919) % 1000 * 2000000+i;
+
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("f13a", 0);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 100);
+
+      for (int i = 0; i < v1.GetSize(); ++i)
+        A(p1(v1[i]) == (i *7919) % 1000 * 2000000+i);
+    }
+  }
+  D(f13a);
+  R(f13a);
+  E;
+
+  // dictionary-encoded string columns, chosen on commit for few values
+  B(f14, Dictionary string columns, 0)W(f14a);
+   {
+    static const char *codes[] =  {
+      "nl", "de", "fr", "NL", "", "be"
+    };
+    c4_StringProp p1("p1");
+    c4_IntProp p2("p2");
+     {
+      c4_Storage s1("f14a", 1);
+      c4_View v1 = s1.GetAs("a[p1:S,p2:I]");
+      v1.SetSize(1000);
+
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        p1(v1[i]) = codes[i % 6];
+        p2(v1[i]) = i;
+      }
+
+      s1.Commit();
+      A((c4_String)p1(v1[999]) == codes[999 % 6]);
+    }
+     {
+      FILE *fp = fopen("f14a", "rb");
+      A(fp != 0);
+      fseek(fp, 0, SEEK_END);
+      A(ftell(fp) < 1000); // the plain layout needs over 3 Kb
+      fclose(fp);
+
+      c4_Storage s1("f14a", 1);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 1000);
+
+      for (int i = 0; i < v1.GetSize(); ++i)
+        A((c4_String)p1(v1[i]) == codes[i % 6]);
+
+      // comparisons are case-insensitive, also when done on the codes
+      A(v1.Find(p1["DE"]) == 1);
+      A(v1.Find(p1["nl"]) == 0);
+      A(v1.Select(p1["nl"]).GetSize() == 334);
+      A(v1.Select(p1["xx"]).GetSize() == 0);
+
+      c4_View v2 = v1.SortOn(p1);
+      A((c4_String)p1(v2[0]) == "");
+      A((c4_String)p1(v2[999]) == "NL" || (c4_String)p1(v2[999]) == "nl");
+
+      c4_View v3 = v1.Counts(p1, p2);
+      A(v3.GetSize() == 5);
+
+      // any change expands the column again
+      p1(v1[0]) = "lu";
+      v1.RemoveAt(1);
+      A((c4_String)p1(v1[0]) == "lu");
+      A((c4_String)p1(v1[1]) == "fr");
+
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("f14a", 0);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 999);
+      A((c4_String)p1(v1[0]) == "lu");
+
+      for (int i = 1; i < v1.GetSize(); ++i)
+        A((c4_String)p1(v1[i]) == codes[(i + 1) % 6]);
+    }
+  }
+  D(f14a);
+  R(f14a);
+  E;
+
+  B(f15, Packed float columns, 0)W(f15a);
+   {
+    c4_DoubleProp p1("p1"), p3("p3");
+    c4_FloatProp p2("p2");
+     {
+      c4_Storage s1("f15a", 1);
+      c4_View v1 = s1.GetAs("a[p1:D,p2:F,p3:D]");
+      v1.SetSize(2000);
+
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        p1(v1[i]) = 20.0+0.5 *(i / 10); // slowly changing
+        p2(v1[i]) = 1.25f *(i % 8) - 5; // few distinct values
+        p3(v1[i]) = ((i *7919) % 100003) / 7.0; // no gain, stays plain
+      }
+
+      s1.Commit();
+
+      A(p1(v1[1999]) == 20.0+0.5 * 199);
+      A(p2(v1[1999]) == 1.25f * 7-5);
+    }
+     {
+      FILE *fp = fopen("f15a", "rb");
+      A(fp != 0);
+      fseek(fp, 0, SEEK_END);
+      A(ftell(fp) < 25000); // unpacked, this would be over 40 Kb
+      fclose(fp);
+
+      c4_Storage s1("f15a", 1);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 2000);
+
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        A(p1(v1[i]) == 20.0+0.5 *(i / 10));
+        A(p2(v1[i]) == 1.25f *(i % 8) - 5);
+        A(p3(v1[i]) == ((i *7919) % 100003) / 7.0);
+      }
+
+      // any change expands the column again
+      p1(v1[5]) = 1.0e300;
+      v1.RemoveAt(0);
+      p2(v1[1998]) = 3.5f;
+
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("f15a", 0);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 1999);
+      A(p1(v1[4]) == 1.0e300);
+      A(p2(v1[1998]) == 3.5f);
+
+      for (int i = 5; i < v1.GetSize(); ++i)
+        A(p1(v1[i]) == 20.0+0.5 *((i + 1) / 10));
+      for (int j = 0; j < v1.GetSize() - 1; ++j)
+        A(p2(v1[j]) == 1.25f *((j + 1) % 8) - 5);
+    }
+  }
+  D(f15a);
+  R(f15a);
+  E;
+
+  B(f16, Zone maps for range selections, 0)W(f16a);
+   {
+    c4_IntProp p1("p1");
+    c4_StringProp p2("p2");
+    c4_DoubleProp p3("p3");
+     {
+      c4_Storage s1("f16a", 1);
+      A(!s1.SaveZoneMaps()); // off by default, older readers lack them
+      c4_View v1 = s1.GetAs("a[p1:I,p2:S,p3:D]");
+      v1.SetSize(10000);
+
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        p1(v1[i]) = 1000+10 * i; // ascending, as with time stamps
+        p2(v1[i]) = i < 5000 ? "early" : "late";
+        p3(v1[i]) = i % 100;
+      }
+
+      c4_View v2 = v1.SelectRange(p1[25000], p1[25990]);
+      A(v2.GetSize() == 100);
+      A(p1(v2[0]) == 25000);
+
+      A(v1.Find(p1[50000]) == 4900);
+      A(v1.Find(p1[50005]) ==  - 1);
+      A(v1.Select(p2["late"]).GetSize() == 5000);
+
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("f16a", 1);
+      s1.SaveZoneMaps();
+      c4_View v1 = s1.View("a");
+
+      c4_View v2 = v1.SelectRange(p1[25000], p1[25990]);
+      A(v2.GetSize() == 100);
+      A(v1.Select(p2["LATE"]).GetSize() == 5000);
+      A(v1.SelectRange(p3[99.0], p3[1000.0]).GetSize() == 100);
+
+      // bounds must widen, or be recalculated after a shift
+      p1(v1[10]) = 200000;
+      p2(v1[20]) = "later";
+      v1.InsertAt(5000, p1[300000] + p2["extra"]);
+      v1.RemoveAt(0, 5);
+
+      A(v1.Find(p1[200000]) == 5);
+      A(v1.Find(p1[300000]) == 4995);
+      A(v1.SelectRange(p1[150000], p1[400000]).GetSize() == 2);
+      A(v1.SelectRange(p2["later"], p2["lates"]).GetSize() == 1);
+      A(v1.SelectRange(p1[1000], p1[1090]).GetSize() == 5);
+
+      // appending extends the last block
+      v1.Add(p1[1]);
+      A(v1.Find(p1[1]) == 9996);
+
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("f16a", 0);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 9997);
+
+      A(v1.Find(p1[200000]) == 5);
+      A(v1.Find(p1[300000]) == 4995);
+      A(v1.Find(p1[1]) == 9996);
+      A(v1.Find(p2["extra"]) == 4995);
+      A(v1.SelectRange(p1[150000], p1[400000]).GetSize() == 2);
+      A(v1.SelectRange(p1[0], p1[1000]).GetSize() == 1);
+      A(v1.Select(p2["early"]).GetSize() == 4994);
+    }
+  }
+  D(f16a);
+  R(f16a);
+  E;
+
+  // a block of equal values packs to zero bits, without any payload
+  B(f17, Packed blocks of equal ints, 0)W(f17a);
+   {
+    c4_IntProp p1("p1");
+     {
+      c4_Storage s1("f17a", 1);
+      c4_View v1 = s1.GetAs("a[p1:I]");
+      v1.SetSize(1024);
+
+      for (int i = 0; i < v1.GetSize(); ++i)
+        p1(v1[i]) = 12345;
+
+      s1.Commit();
+    }
+     {
+      // packed layouts are flagged in the header, so old readers reject them
+      t4_byte head[8];
+      FILE *fp = fopen("f17a", "rb");
+      A(fp != 0);
+      A(fread(head, 1, sizeof head, fp) == sizeof head);
+      A(head[3] == 0x40);
+      fclose(fp);
+
+      c4_Storage s1("f17a", 0);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 1024);
+
+      for (int i = 0; i < v1.GetSize(); ++i)
+        A(p1(v1[i]) == 12345);
+    }
+  }
+  D(f17a);
+  R(f17a);
+  E;
 }
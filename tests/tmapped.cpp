@@ -33,6 +33,35 @@ void TestBlockDel(int pos_, int len_) {
   A(v2.GetSize() == 2999-len_);
 }
 
+void TestOrderedSel(c4_View ordered_, c4_View data_, const c4_RowRef &low_,
+  const c4_RowRef &high_) {
+  c4_IntProp p1("p1");
+  c4_StringProp p2("p2");
+
+  c4_View v1 = ordered_.SelectRange(low_, high_);
+  c4_View v2 = data_.SelectRange(low_, high_);
+  printf("ordered select %d of %d\n", v1.GetSize(), data_.GetSize());
+
+  A(v1.GetSize() == v2.GetSize());
+  for (int i = 0; i < v1.GetSize(); ++i) {
+    A(p1(v1[i]) == p1(v2[i]));
+    A((c4_String)p2(v1[i]) == (c4_String)p2(v2[i]));
+  }
+}
+
+void TestBitmapSel(c4_View bitmap_, c4_View data_, const c4_RowRef &low_,
+  const c4_RowRef &high_) {
+  c4_IntProp pId("id");
+
+  c4_View v1 = bitmap_.SelectRange(low_, high_);
+  c4_View v2 = data_.SelectRange(low_, high_);
+  printf("bitmap select %d of %d\n", v1.GetSize(), data_.GetSize());
+
+  A(v1.GetSize() == v2.GetSize());
+  for (int i = 0; i < v1.GetSize(); ++i)
+    A((t4_i32)pId(v1[i]) == pId(v2[i]));
+}
+
 void TestMapped() {
   B(m01, Hash mapping, 0);
    {
@@ -259,4 +288,121 @@ void TestMapped() {
       TestBlockDel(2999-i, i);
   }
   E;
+
+  B(m08, Bitmap indexes, 0)W(m08a);
+   {
+    static const char *names[] =  {
+      "new", "open", "held", "done", "lost"
+    };
+
+    c4_IntProp pId("id"), pKind("kind");
+    c4_StringProp pStatus("status");
+
+     {
+      c4_Storage s1("m08a", true);
+      c4_View d1 = s1.GetAs("d1[id:I,status:S,kind:I]");
+      for (int i = 0; i < 10000; ++i)
+        d1.Add(pId[i] + pStatus[names[i % 11 % 5]] + pKind[i % 3]);
+
+      c4_View m1 = s1.GetAs("m1[status:S,_C:I,_B:B]");
+      c4_View m2 = s1.GetAs("m2[kind:I,_C:I,_B:B]");
+      c4_View b1 = d1.Bitmap(m1).Bitmap(m2);
+      A(m1.GetSize() == 5 * 3);
+      A(m2.GetSize() == 3 * 3);
+
+      TestBitmapSel(b1, d1, pStatus["open"], pStatus["open"]);
+      TestBitmapSel(b1, d1, pStatus["held"], pStatus["new"]);
+      TestBitmapSel(b1, d1, pStatus["a"], pStatus["lost"]);
+      TestBitmapSel(b1, d1, pStatus["x"], pStatus["z"]);
+      TestBitmapSel(b1, d1, pKind[1], pKind[2]);
+      TestBitmapSel(b1, d1, pStatus["open"] + pKind[2], pStatus["open"] +
+        pKind[2]);
+      TestBitmapSel(b1, d1, pStatus["done"] + pId[3000], pStatus["lost"] +
+        pId[6000]);
+
+      // changes must go through the bitmap view to keep it up to date
+      for (int j = 0; j < 10000; j += 7)
+        pStatus(b1[j]) = "lost";
+      pKind(b1[5]) = 7;
+      b1.InsertAt(4000, pId[-1] + pStatus["open"] + pKind[1], 300);
+      b1.RemoveAt(100, 4500);
+      b1.RemoveAt(b1.GetSize() - 10, 10);
+      b1.Add(pId[-2] + pStatus["gone"] + pKind[0]);
+
+      TestBitmapSel(b1, d1, pStatus["open"], pStatus["open"]);
+      TestBitmapSel(b1, d1, pStatus["held"], pStatus["new"]);
+      TestBitmapSel(b1, d1, pStatus["gone"], pStatus["gone"]);
+      TestBitmapSel(b1, d1, pKind[7], pKind[7]);
+      TestBitmapSel(b1, d1, pStatus["open"] + pKind[1], pStatus["open"] +
+        pKind[1]);
+      A(b1.Find(pStatus["gone"]) == b1.GetSize() - 1);
+
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("m08a", false);
+      c4_View d1 = s1.View("d1");
+      c4_View b1 = d1.Bitmap(s1.View("m1")).Bitmap(s1.View("m2"));
+
+      TestBitmapSel(b1, d1, pStatus["lost"], pStatus["lost"]);
+      TestBitmapSel(b1, d1, pStatus["open"] + pKind[1], pStatus["open"] +
+        pKind[1]);
+      TestBitmapSel(b1, d1, pStatus["gone"], pStatus["gone"]);
+    }
+  }
+  R(m08a);
+  E;
+
+  B(m09, Ordered range selection, 0);
+   {
+    c4_IntProp p1("p1");
+    c4_StringProp p2("p2");
+
+    c4_Storage s1;
+    c4_View d1 = s1.GetAs("d1[p1:I,p2:S]");
+    c4_View o1 = d1.Ordered();
+
+    for (int i = 0; i < 1000; ++i) {
+      char buf[10];
+      sprintf(buf, "s%03d", i * 7 % 100);
+      o1.Add(p1[i * 37 % 500] + p2[buf]);
+    }
+    A(d1.GetSize() == 500); // keys are unique, later adds replace rows
+
+    c4_Row none;
+    TestOrderedSel(o1, d1, p1[100], p1[199]);
+    TestOrderedSel(o1, d1, p1[250], p1[250]);
+    TestOrderedSel(o1, d1, p1[251], p1[250]);
+    TestOrderedSel(o1, d1, p1[480], none);
+    TestOrderedSel(o1, d1, none, p1[3]);
+    TestOrderedSel(o1, d1, p1[ - 5], p1[9999]);
+    TestOrderedSel(o1, d1, p1[100] + p2["s050"], p1[300] + p2["s080"]);
+    TestOrderedSel(o1, d1, p2["s010"], p2["s020"]);
+
+    A(o1.Select(p1[123]).GetSize() == 1);
+  }
+  E;
+
+  B(m10, Stacked bitmaps on the same property, 0);
+   {
+    c4_IntProp pId("id"), pKind("kind");
+
+    c4_Storage s1;
+    c4_View d1 = s1.GetAs("d1[id:I,kind:I]");
+    for (int i = 0; i < 1000; ++i)
+      d1.Add(pId[i] + pKind[i % 4]);
+
+    c4_View m1 = s1.GetAs("m1[kind:I,_C:I,_B:B]");
+    c4_View m2 = s1.GetAs("m2[kind:I,_C:I,_B:B]");
+    c4_View b1 = d1.Bitmap(m1).Bitmap(m2);
+
+    // the id range is not covered by any bitmap, so it must still be checked
+    TestBitmapSel(b1, d1, pKind[1], pKind[1]);
+    TestBitmapSel(b1, d1, pKind[1] + pId[100], pKind[2] + pId[199]);
+    TestBitmapSel(b1, d1, pId[500], pId[509]);
+
+    b1.InsertAt(10, pId[-1] + pKind[3], 5);
+    TestBitmapSel(b1, d1, pKind[3] + pId[-1], pKind[3] + pId[5]);
+  }
+  E;
 }
@@ -445,4 +445,116 @@ void TestNotify() {
   D(n14a);
   R(n14a);
   E;
+
+  B(n15, Bulk changes with dependents, 0) {
+    c4_IntProp p1("p1"), p2("p2");
+    c4_View v1;
+    for (int i = 0; i < 500; ++i)
+      v1.Add(p1[(i *37) % 500] + p2[i]);
+
+    c4_View v2 = v1.SelectRange(p1[200], p1[333]);
+    c4_View v3 = v1.SortOn(p1);
+    c4_View v4 = v2.SortOnReverse(p1, p1);
+    A(v2.GetSize() == 134);
+    A(v3.GetSize() == 500);
+
+    v1.BeginBulk();
+    for (int j = 0; j < 1000; ++j)
+      v1.Add(p1[(j *53) % 700] + p2[j]);
+    p1(v1[10]) = 250;
+    v1.BeginBulk();
+    v1.RemoveAt(300, 5);
+    v1.InsertAt(700, p1[300] + p2[-1], 3);
+    v1.EndBulk();
+    A(v2.GetSize() == 134); // not updated yet
+    v1.EndBulk();
+
+    c4_View w2 = v1.SelectRange(p1[200], p1[333]);
+    c4_View w3 = v1.SortOn(p1);
+    c4_View w4 = w2.SortOnReverse(p1, p1);
+    printf("bulk %d %d %d\n", v2.GetSize(), v3.GetSize(), v4.GetSize());
+
+    A(v2.GetSize() == w2.GetSize());
+    for (int k2 = 0; k2 < w2.GetSize(); ++k2)
+      A((t4_i32)p2(v2[k2]) == p2(w2[k2]));
+    A(v3.GetSize() == w3.GetSize());
+    for (int k3 = 0; k3 < w3.GetSize(); ++k3)
+      A((t4_i32)p2(v3[k3]) == p2(w3[k3]));
+    A(v4.GetSize() == w4.GetSize());
+    for (int k4 = 0; k4 < w4.GetSize(); ++k4)
+      A((t4_i32)p2(v4[k4]) == p2(w4[k4]));
+
+    // inserting a view is batched internally
+    c4_View v5 = w2.Clone();
+    v5.InsertAt(0, w2);
+    int n2 = v2.GetSize(), n3 = v3.GetSize();
+    v1.InsertAt(0, v5);
+    A(v2.GetSize() == n2 + v5.GetSize());
+    A(v3.GetSize() == n3 + v5.GetSize());
+    A((t4_i32)p1(v3[0]) == p1(w3[0]));
+  }
+  E;
+
+  B(n16, Many changes to sorted and selected, 0) {
+    c4_IntProp p1("p1"), p2("p2");
+    c4_View v1;
+    for (int i = 0; i < 300; ++i)
+      v1.Add(p1[(i *37) % 101] + p2[i]);
+
+    c4_View v2 = v1.SelectRange(p1[20], p1[60]);
+    c4_View v3 = v1.SortOn(p1);
+
+    for (int j = 0; j < 2000; ++j) {
+      int r = (j *7919) % v1.GetSize();
+      switch (j % 4) {
+        case 0:
+          v1.InsertAt(r, p1[(j *13) % 101] + p2[1000+j]);
+          break;
+        case 1:
+          v1.RemoveAt(r);
+          break;
+        default:
+          p1(v1[r]) = (j *31) % 101;
+      }
+    }
+
+    c4_View w2 = v1.SelectRange(p1[20], p1[60]);
+    c4_View w3 = v1.SortOn(p1);
+    printf("changed %d %d %d\n", v1.GetSize(), v2.GetSize(), v3.GetSize());
+
+    A(v2.GetSize() == w2.GetSize());
+    for (int k2 = 0; k2 < w2.GetSize(); ++k2)
+      A((t4_i32)p2(v2[k2]) == p2(w2[k2]));
+    A(v3.GetSize() == w3.GetSize());
+    for (int k3 = 0; k3 < w3.GetSize(); ++k3)
+      A((t4_i32)p1(v3[k3]) == p1(w3[k3]));
+    for (int k4 = 0; k4 < v3.GetSize(); k4 += 10)
+      A(v3.GetIndexOf(v3[k4]) == k4);
+  }
+  E;
+  B(n17, Move rows under a sorted view, 0) {
+    c4_IntProp p1("p1"), p2("p2");
+    c4_View v1;
+    for (int i = 0; i < 20; ++i)
+      v1.Add(p1[i % 3] + p2[i]);
+
+    c4_View v2 = v1.SortOn(p1);
+
+    // equal keys are kept in row order, which moves change
+    (&v1[0])._seq->Move(2, 15);
+    (&v1[0])._seq->Move(17, 1);
+    (&v1[0])._seq->Move(4, 4);
+    v1.RemoveAt(5);
+    for (int j = 0; j < v1.GetSize(); j += 3)
+      p1(v1[j]) = 1;
+    v1.RemoveAt(12);
+
+    c4_View w2 = v1.SortOn(p1);
+    A(v2.GetSize() == w2.GetSize());
+    for (int k = 0; k < w2.GetSize(); ++k)
+      A((t4_i32)p2(v2[k]) == p2(w2[k]));
+    for (int n = 0; n < v2.GetSize(); ++n)
+      A(v2.GetIndexOf(v2[n]) == n);
+  }
+  E;
 }
@@ -4,6 +4,12 @@
 
 #include "regress.h"
 
+// a file strategy which never uses memory-mapped files
+class NoMapStrategy: public c4_FileStrategy {
+  public:
+    virtual void ResetFileMapping(){}
+};
+
 void TestStores5() {
   B(s40, LoadFrom after commit, 0)W(s40a);
    {
@@ -356,4 +362,442 @@ void TestStores5() {
   D(s50a);
   R(s50a);
   E;
+
+  B(s51, Segment cache without memory map, 0)W(s51a);
+   {
+    c4_IntProp p1("p1");
+    c4_StringProp p2("p2");
+    char buf[50];
+
+     {
+      c4_Storage s1("s51a", true);
+      c4_View v1 = s1.GetAs("a[p1:I,p2:S]");
+      v1.SetSize(20000);
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        sprintf(buf, "row %d of a view with lots of text in it", i);
+        p1(v1[i]) = i * 3;
+        p2(v1[i]) = buf;
+      }
+      s1.Commit();
+    }
+
+    c4_Storage::SetSegmentCache(1);
+    t4_i64 hits, misses, evictions;
+
+     {
+      NoMapStrategy strat;
+      strat.DataOpen("s51a", 1);
+      A(strat._mapStart == 0);
+
+      c4_Storage s1(strat, false, 1);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 20000);
+
+      for (int pass = 0; pass < 2; ++pass)
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        sprintf(buf, "row %d of a view with lots of text in it", i);
+        A(p1(v1[i]) == i * 3);
+        A(c4_String((const char*)p2(v1[i])) == buf);
+      }
+
+      // a string stays valid while another view reads many other segments
+      const char *s = p2(v1[5]);
+       {
+        NoMapStrategy strat2;
+        strat2.DataOpen("s51a", 0);
+        c4_Storage s2(strat2, false, 0);
+        c4_View v2 = s2.View("a");
+        for (int j = 0; j < v2.GetSize(); j += 10)
+          A(*(const char*)p2(v2[j]) == 'r');
+      }
+      A(c4_String(s) == "row 5 of a view with lots of text in it");
+
+      t4_i32 bytes = c4_Storage::SegmentCacheStats(&hits, &misses, &evictions);
+      A(bytes <= 128 * 4096);
+      A(misses > 300);
+      A(evictions > 0);
+      A(hits > misses);
+
+      // changing a column takes it out of the cache
+      p2(v1[123]) = "changed";
+      p1(v1[19999]) = 1;
+      A(c4_String((const char*)p2(v1[123])) == "changed");
+      A(c4_String((const char*)p2(v1[19998])) == "row 19998 of a view with lots of text in it");
+      A(p1(v1[19999]) == 1);
+      s1.Commit();
+    }
+
+    c4_Storage::SetSegmentCache(0);
+    A(c4_Storage::SegmentCacheStats(&hits) == 0);
+    A(hits == 0);
+
+     {
+      c4_Storage s1("s51a", false);
+      c4_View v1 = s1.View("a");
+      A(c4_String((const char*)p2(v1[123])) == "changed");
+      A(p1(v1[19999]) == 1);
+      A(p1(v1[19998]) == 19998 * 3);
+    }
+  }
+  R(s51a);
+  E;
+
+  B(s52, Grow file mapping in place, 0)W(s52a);
+   {
+    c4_IntProp p1("p1");
+    c4_StringProp p2("p2");
+    char buf[50];
+
+    c4_FileStrategy strat;
+    strat.DataOpen("s52a", 1);
+     {
+      c4_Storage s1(strat, false, 1);
+      s1.SetStructure("a[p1:I,p2:S]");
+      c4_View v1 = s1.View("a");
+      int i;
+      for (i = 0; i < 100; ++i) {
+        sprintf(buf, "row %d", i);
+        v1.Add(p1[i] + p2[buf]);
+      }
+      s1.Commit();
+
+      const t4_byte *start = strat._mapStart;
+      t4_i32 size = strat.FileSize();
+
+      // committing without changes must not remap the file
+      s1.Commit();
+      A(strat._mapStart == start);
+
+      for (int pass = 0; pass < 3; ++pass) {
+        for (i = v1.GetSize(); i < 3000 * (pass + 1); ++i) {
+          sprintf(buf, "row %d", i);
+          v1.Add(p1[i] + p2[buf]);
+        }
+        s1.Commit();
+        A(strat.FileSize() > size);
+        size = strat.FileSize();
+#if q4_UNIX
+        // the map has been extended, not moved, this is only done where
+        // fileio.cpp can reserve address space (q4_GROWMAP), elsewhere,
+        // such as on Windows, the file gets mapped again after a commit
+        A(start != 0);
+        A(strat._mapStart == start);
+#endif 
+        A(strat._dataSize == size);
+      }
+
+      A(v1.GetSize() == 9000);
+      for (i = 0; i < v1.GetSize(); ++i) {
+        sprintf(buf, "row %d", i);
+        A(p1(v1[i]) == i);
+        A(c4_String((const char*)p2(v1[i])) == buf);
+      }
+    }
+     {
+      c4_Storage s1("s52a", false);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 9000);
+      A(p1(v1[8999]) == 8999);
+      A(c4_String((const char*)p2(v1[4321])) == "row 4321");
+    }
+  }
+  R(s52a);
+  E;
+
+  B(s53, Access hints on a mapped file, 0)W(s53a);
+   {
+    c4_IntProp p1("p1");
+    c4_StringProp p2("p2");
+    char buf[50];
+     {
+      c4_Storage s1("s53a", 1);
+      s1.SetStructure("a[p1:I,p2:S]");
+      c4_View v1 = s1.View("a");
+      v1.SetSize(20000);
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        sprintf(buf, "row %d", i);
+        p1(v1[i]) = 19999 - i;
+        p2(v1[i]) = buf;
+      }
+      s1.Commit();
+    }
+     {
+      c4_Storage s1("s53a", 0);
+      c4_View v1 = s1.View("a");
+      v1.Prefetch();
+      v1.Prefetch(p2);
+      v1.Prefetch((p1, p2));
+      A(v1.Find(p1[123]) == 19876);
+      A(v1.Find(p2["row 12345"]) == 12345);
+      A(v1.Find(p1[19999], 1) ==  - 1);
+
+      c4_View v2 = v1.SortOn(p1);
+      v2.Prefetch();
+      A(p1(v2[0]) == 0);
+      A(c4_String((const char*)p2(v2[0])) == "row 19999");
+
+      c4_View v3 = v1.Select(p1[5]);
+      v3.Prefetch(p1);
+      A(v3.GetSize() == 1);
+
+      c4_View v4 = v1.Slice(0, 10);
+      v4.Prefetch();
+      A(p1(v4[9]) == 19990);
+
+      c4_Storage s2;
+      c4_View m = s2.GetAs("m[_H:I,_R:I]");
+      c4_View v5 = v1.Hash(m, 1);
+      A(v5.Find(p1[4321]) == 15678);
+
+      FILE *fp = tmpfile();
+      c4_FileStream fs1(fp, true);
+      s1.SaveTo(fs1);
+      rewind(fp);
+
+      c4_Storage s3;
+      A(s3.LoadFrom(fs1));
+      c4_View v6 = s3.View("a");
+      A(v6.GetSize() == 20000);
+      A(c4_String((const char*)p2(v6[777])) == "row 777");
+    }
+  }
+  R(s53a);
+  E;
+
+  B(s54, Columns loaded and saved in one go, 0)W(s54a);
+   {
+    c4_IntProp p1("p1");
+    c4_StringProp p2("p2");
+    char buf[50];
+     {
+      c4_Storage s1("s54a", 1);
+      s1.SetStructure("a[p1:I,p2:S]");
+      c4_View v1 = s1.View("a");
+      v1.SetSize(10000);
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        sprintf(buf, "row %d", i);
+        p1(v1[i]) = i;
+        p2(v1[i]) = buf;
+      }
+      s1.Commit();
+    }
+     {
+      NoMapStrategy strat;
+      strat.DataOpen("s54a", 1);
+      A(strat._mapStart == 0);
+
+      c4_Storage s1(strat, false, 1);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 10000);
+      for (int i = 0; i < v1.GetSize(); ++i) {
+        sprintf(buf, "row %d", i);
+        A(p1(v1[i]) == i);
+        A(c4_String((const char*)p2(v1[i])) == buf);
+      }
+
+      // insert in the middle, so the saved columns have a gap
+      v1.InsertAt(5000, p1[ - 1] + p2["inserted"], 3);
+      s1.Commit();
+
+      A(p1(v1[5002]) ==  - 1);
+      A(p1(v1[5003]) == 5000);
+    }
+     {
+      c4_Storage s1("s54a", false);
+      c4_View v1 = s1.View("a");
+      A(v1.GetSize() == 10003);
+      A(p1(v1[4999]) == 4999);
+      A(c4_String((const char*)p2(v1[5001])) == "inserted");
+      A(c4_String((const char*)p2(v1[10002])) == "row 9999");
+    }
+  }
+  R(s54a);
+  E;
+
+  B(s55, Insert all rows of another view, 0)W(s55a);
+   {
+    c4_IntProp p1("p1");
+    c4_StringProp p2("p2");
+    c4_BytesProp p3("p3");
+    c4_ViewProp p4("p4");
+    c4_DoubleProp p5("p5");
+    char buf[50];
+
+    c4_Storage s1;
+    c4_View v1 = s1.GetAs("a[p1:I,p2:S,p3:B,p4[p1:I,p2:S]]");
+    for (int i = 0; i < 1000; ++i) {
+      sprintf(buf, "row %d", i);
+      c4_Row r;
+      p1(r) = i;
+      p2(r) = i % 7 ? buf : "";
+      p3(r) = c4_Bytes(buf, i % 5);
+      v1.Add(r);
+    }
+    c4_View v2 = p4(v1[10]);
+    v2.Add(p1[1] + p2["one"]);
+    v2.Add(p1[2] + p2["two"]);
+
+     {
+      c4_Storage s2("s55a", 1);
+      c4_View v3 = s2.GetAs("b[p2:S,p1:I,p5:D,p4[p2:S]]");
+      v3.Add(p1[ - 1] + p2["first"] + p5[1.5]);
+      v3.Add(p1[ - 2] + p2["last"] + p5[2.5]);
+      c4_View v4 = v3.SortOn(p1);
+      A(v4.GetSize() == 2);
+
+      v3.InsertAt(1, v1);
+      A(v3.GetSize() == 1002);
+      A(v4.GetSize() == 1002);
+      A(p1(v4[0]) ==  - 2);
+      A(p1(v4[2]) == 0);
+      A(p1(v3[0]) ==  - 1);
+      A(p1(v3[1001]) ==  - 2);
+      A(c4_String((const char*)p2(v3[1001])) == "last");
+      A(p5(v3[1001]) == 2.5);
+      A(p5(v3[500]) == 0);
+      A(p1(v3[1000]) == 999);
+      A(c4_String((const char*)p2(v3[1000])) == "row 999");
+      A(c4_String((const char*)p2(v3[8])) == "");
+      A(c4_String((const char*)p2(v3[9])) == "row 8");
+      A(c4_Bytes(p3(v3[6])).Size() == 0);
+      A(c4_Bytes(p3(v3[5])).Size() == 4);
+      c4_View v5 = p4(v3[11]);
+      A(v5.GetSize() == 2);
+      A(c4_String((const char*)p2(v5[1])) == "two");
+      A(p1(v5[1]) == 2);
+      s2.Commit();
+    }
+     {
+      c4_Storage s2("s55a", 1);
+      c4_View v3 = s2.View("b");
+      A(v3.GetSize() == 1002);
+      A(c4_String((const char*)p2(v3[501])) == "row 500");
+      A(c4_String((const char*)p2(((c4_View)p4(v3[11]))[0])) == "one");
+
+      // a derived view is copied in its own order
+      v3.InsertAt(0, v1.SortOnReverse(p1, p1));
+      A(v3.GetSize() == 2002);
+      A(p1(v3[0]) == 999);
+      A(p1(v3[999]) == 0);
+      A(p1(v3[1000]) ==  - 1);
+
+      // so is the view itself
+      c4_View v6 = v3.Slice(0, 3);
+      v3.InsertAt(2002, v3);
+      A(v3.GetSize() == 4004);
+      A(p1(v3[2002]) == 999);
+      A(c4_String((const char*)p2(v3[4003])) == "last");
+      A(v6.GetSize() == 3);
+      s2.Commit();
+    }
+     {
+      c4_Storage s2("s55a", 0);
+      c4_View v3 = s2.View("b");
+      A(v3.GetSize() == 4004);
+      A(c4_String((const char*)p2(v3[4002])) == "row 999");
+      A(p5(v3[4003]) == 2.5);
+      A(c4_String((const char*)p2(((c4_View)p4(v3[3013]))[1])) == "two");
+    }
+  }
+  R(s55a);
+  E;
+
+  B(s56, Numeric columns as arrays, 0)W(s56a);
+   {
+    c4_IntProp p1("p1"), p2("p2");
+    c4_LongProp p3("p3");
+    c4_DoubleProp p4("p4");
+    c4_StringProp p5("p5");
+     {
+      c4_Storage s1("s56a", 1);
+      c4_View v1 = s1.GetAs("a[p1:I,p2:I,p3:L,p4:D,p5:S]");
+      for (int i = 0; i < 5000; ++i)
+        v1.Add(p1[i *100000] + p2[i % 3] + p3[(t4_i64)i << 40] + p4[i *0.25]
+          + p5["abc"]);
+      s1.Commit();
+    }
+     {
+      c4_FileStrategy strat;
+      strat.DataOpen("s56a", 0);
+      c4_Storage s1(strat, false, 0);
+      c4_View v1 = s1.View("a");
+
+      c4_Bytes buf;
+      A(!v1.GetColumn(p5, buf));
+      A(!v1.GetColumn(c4_IntProp("p9"), buf));
+
+      A(v1.GetColumn(p1, buf));
+      A(buf.Size() == 5000 *4);
+      const t4_byte *p = buf.Contents();
+      bool mapped = strat._mapStart != 0 && p >= strat._mapStart && p <
+        strat._mapStart + strat._dataSize;
+      A(!mapped || ((size_t)p &3) == 0);
+      A(((const t4_i32*)p)[4999] == 499900000);
+
+      // narrow ints are widened
+      A(v1.GetColumn(p2, buf));
+      A(buf.Size() == 5000 *4);
+      A(((const t4_i32*)buf.Contents())[4999] == 1);
+
+      A(v1.GetColumn(p3, buf));
+      A(((const t4_i64*)buf.Contents())[3] == (t4_i64)3 << 40);
+      A(v1.GetColumn(p4, buf));
+      A(((const double*)buf.Contents())[4998] == 1249.5);
+
+      // derived views are copied in their own order
+      c4_View v2 = v1.SortOnReverse(p1, p1);
+      A(v2.GetColumn(p1, buf));
+      A(((const t4_i32*)buf.Contents())[0] == 499900000);
+      A(((const t4_i32*)buf.Contents())[4999] == 0);
+
+      // once changed, the data is no longer taken from the file
+      p1(v1[0]) = 7;
+      A(v1.GetColumn(p1, buf));
+      p = buf.Contents();
+      A(p < strat._mapStart || p >= strat._mapStart + strat._dataSize);
+      A(((const t4_i32*)p)[0] == 7);
+      A(((const t4_i32*)p)[1] == 100000);
+    }
+  }
+  R(s56a);
+  E;
+
+  B(s57, Insert ints of every width from another view, 0) {
+    c4_IntProp p1("p1");
+    static t4_i32 widths[] =  {
+      0, 1, 3, 15, 127,  - 128, 32767,  - 32768, 1 << 20,  - (1 << 30)
+    };
+
+    for (int i = 0; i < 10; ++i) {
+      c4_View v1;
+      for (int j = 0; j < 100; ++j)
+        v1.Add(p1[j % 7 == 3 ? widths[i]: j % 2]);
+
+      c4_Storage s1;
+      c4_View v2 = s1.GetAs("a[p1:I]");
+      v2.Add(p1[i > 1 ? 1: 0]);
+      v2.InsertAt(1, v1);
+      v2.InsertAt(0, v1);
+      A(v2.GetSize() == 201);
+      for (int k = 0; k < 100; ++k) {
+        t4_i32 v = k % 7 == 3 ? widths[i]: k % 2;
+        A(p1(v2[k]) == v);
+        A(p1(v2[k + 101]) == v);
+      }
+      A(p1(v2[100]) == (i > 1 ? 1 : 0));
+
+      // a wider value in the middle of a run
+      c4_View v3;
+      v3.Add(p1[1]);
+      v3.Add(p1[0x12345678]);
+      v2.InsertAt(5, v3);
+      A(p1(v2[4]) == 0);
+      A(p1(v2[5]) == 1);
+      A(p1(v2[6]) == 0x12345678);
+      A(p1(v2[7]) == 1);
+      A(p1(v2[102]) == (i > 1 ? 1 : 0));
+      A(p1(v2[202]) == 1);
+    }
+  }
+  E;
 }